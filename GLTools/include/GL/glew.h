@@ -15264,6 +15264,8 @@ GLEWAPI GLboolean glewContextIsSupported (GLEWContext* ctx, const char* name);
 #else /* GLEW_MX */
 
 GLEWAPI GLenum glewInit ();
+/* GL entry points only, no GLX/WGL: for contexts from EGL */
+GLEWAPI GLenum glewContextInit (void);
 GLEWAPI GLboolean glewIsSupported (const char* name);
 #define glewIsExtensionSupported(x) glewIsSupported(x)
 
@@ -277,6 +277,29 @@ class GLFrustum
             return true;
             }
 
+        // The same test for a whole array of spheres (x, y, z, radius) at once.
+        // bVisible[i] is set to 1 if sphere i intersects the frustum, 0 if not.
+        // Returns how many do.
+        int TestSpheres(const M3DVector4f *vSpheres, unsigned char *bVisible, int nCount)
+            {
+            M3DVector4f vPlanes[6];
+            GetPlanes(vPlanes);
+
+            return m3dTestSpheresBatch(bVisible, vSpheres, vPlanes, 6, nCount);
+            }
+
+        // The six transformed plane equations: near, far, left, right, bottom,
+        // top. Points inside are on the positive side of all of them.
+        void GetPlanes(M3DVector4f vPlanes[6])
+            {
+            m3dCopyVector4(vPlanes[0], nearPlane);
+            m3dCopyVector4(vPlanes[1], farPlane);
+            m3dCopyVector4(vPlanes[2], leftPlane);
+            m3dCopyVector4(vPlanes[3], rightPlane);
+            m3dCopyVector4(vPlanes[4], bottomPlane);
+            m3dCopyVector4(vPlanes[5], topPlane);
+            }
+
     protected:
 		// The projection matrix for this frustum
 		M3DMatrix44f projMatrix;	
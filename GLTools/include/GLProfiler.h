@@ -0,0 +1,111 @@
+// GLProfiler.h
+// Scoped CPU timing with Chrome trace-event export.
+//
+// Put GLT_PROFILE_SCOPE("name") or GLT_PROFILE_FUNCTION() at the top of a block.
+// Nested scopes show up nested in the trace viewer (chrome://tracing or
+// Perfetto). Each thread records into its own fixed-size ring, so recording
+// takes no locks and allocates nothing: a clock read on entry, one on exit
+// and a store. Nothing at all is recorded unless a capture is running (or
+// recent scopes are being kept, see gltProfileKeepRecent).
+//
+//		gltProfileBeginCapture();
+//		... frames ...
+//		gltProfileEndCapture("trace.json");
+//
+// Unless GLT_PROFILE is defined the macros expand to nothing and the
+// functions are empty, so release builds carry no trace of the profiler.
+
+#ifndef __GLT_PROFILER
+#define __GLT_PROFILER
+
+#include <StopWatch.h>
+
+#define GLT_PROFILE_RING_SIZE	65536		// Events kept per thread, a power of two
+
+// Start recording, dropping anything recorded before
+void gltProfileBeginCapture(void);
+
+// Stop recording and write everything captured as Chrome trace JSON.
+// Returns the number of events written, or -1 if the file cannot be written.
+// Without GLT_PROFILE nothing is written and the result is 0.
+int gltProfileEndCapture(const char *szFileName);
+
+bool gltProfileIsCapturing(void);
+
+// Label the calling thread in the trace
+void gltProfileSetThreadName(const char *szName);
+
+// Keep recording into the rings with no capture running, so the scopes of a
+// frame that has just gone wrong can still be looked up afterwards
+void gltProfileKeepRecent(bool bKeep);
+
+struct GLTProfileScope
+	{
+	const char	*szName;
+	const char	*szThread;
+	int64_t		nStart;
+	int64_t		nEnd;
+	};
+
+// Recorded scopes on any thread that overlap [nFrom, nTo], at most nMax.
+// Returns how many were stored. Without GLT_PROFILE there are none.
+int gltProfileGetScopes(int64_t nFrom, int64_t nTo, GLTProfileScope *pScopes, int nMax);
+
+// Draw statistics. The GLTools batches count their own draws and vertex array
+// binds; applications add their own state changes. Always on, it is only a
+// few increments per draw.
+struct GLTDrawStats
+	{
+	unsigned int	nDrawCalls;
+	unsigned int	nTriangles;
+	unsigned int	nStateChanges;
+	};
+
+extern GLTDrawStats gltDrawStats;
+
+void gltResetDrawStats(void);
+void gltCountDraw(unsigned int ePrimitive, unsigned int nVertices);
+inline void gltCountStateChange(void) { gltDrawStats.nStateChanges++; }
+
+#ifdef GLT_PROFILE
+
+#include <atomic>
+
+// Record one finished scope on the calling thread. szName must outlive the capture.
+void gltProfileRecord(const char *szName, int64_t nStart, int64_t nEnd);
+
+// Set while capturing or keeping recent scopes
+extern std::atomic<bool> gltProfileRecording;
+
+class GLProfileScope
+	{
+	public:
+		GLProfileScope(const char *szScopeName) : szName(szScopeName)
+			{
+			nStart = gltProfileRecording.load(std::memory_order_relaxed) ? CStopWatch::GetTimeNanoseconds() : 0;
+			}
+
+		~GLProfileScope(void)
+			{
+			if(nStart != 0)
+				gltProfileRecord(szName, nStart, CStopWatch::GetTimeNanoseconds());
+			}
+
+	protected:
+		const char	*szName;
+		int64_t		nStart;
+	};
+
+#define GLT_PROFILE_CONCAT2(a, b)	a##b
+#define GLT_PROFILE_CONCAT(a, b)	GLT_PROFILE_CONCAT2(a, b)
+#define GLT_PROFILE_SCOPE(name)		GLProfileScope GLT_PROFILE_CONCAT(gltProfileScope, __LINE__)(name)
+#define GLT_PROFILE_FUNCTION()		GLT_PROFILE_SCOPE(__FUNCTION__)
+
+#else
+
+#define GLT_PROFILE_SCOPE(name)
+#define GLT_PROFILE_FUNCTION()
+
+#endif
+
+#endif
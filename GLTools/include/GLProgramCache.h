@@ -0,0 +1,60 @@
+// GLProgramCache.h
+// Linked shader programs kept on disk between runs.
+//
+// Compiling and linking from source is most of what a program with many
+// shaders does at startup. Once a directory is set, the gltLoadShader*
+// functions look there first. A program's key is a hash of everything that
+// went into it (each source, each attribute binding) and of the driver's
+// vendor, renderer and version strings; the file named after the key holds
+// what glGetProgramBinary gave back the last time it was linked, and
+// glProgramBinary takes it in again. A binary the driver rejects (a new
+// driver, a damaged file) is compiled from source as before and replaced.
+//
+//		uint64_t nKey = gltProgramCacheHash(GLT_PROGRAM_CACHE_SEED, szVertexSrc);
+//		nKey = gltProgramCacheHash(nKey, szFragmentSrc);
+//		GLuint hProgram = glCreateProgram();
+//		if(!gltProgramCacheLoad(hProgram, nKey)) {
+//			... attach, link ...
+//			gltProgramCacheStore(hProgram, nKey);
+//			}
+//
+// Needs GL 4.1 or ARB_get_program_binary and a driver with at least one
+// binary format; without them nothing is loaded or stored.
+
+#ifndef __GLT_PROGRAM_CACHE
+#define __GLT_PROGRAM_CACHE
+
+#include <GLTools.h>
+
+#include <stdint.h>
+
+#define GLT_PROGRAM_CACHE_SEED		14695981039346656037ull		// FNV-1a offset basis
+
+// Where binaries are kept, a directory that must exist. NULL, the default,
+// turns the cache off.
+void gltSetProgramCache(const char *szDirectory);
+bool gltProgramCacheIsEnabled(void);
+
+// Fold a piece of the program into its key
+uint64_t gltProgramCacheHash(uint64_t nKey, const char *szText);
+uint64_t gltProgramCacheHash(uint64_t nKey, int nValue);
+
+// Fill hProgram, a new program object, from the binary kept under nKey.
+// False if there is none or the driver will not take it; hProgram is then
+// left to be built from source, marked so that its binary can be read back
+// for gltProgramCacheStore() once linked.
+bool gltProgramCacheLoad(GLuint hProgram, uint64_t nKey);
+
+// After hProgram has linked from source
+void gltProgramCacheStore(GLuint hProgram, uint64_t nKey);
+
+struct GLTProgramCacheStats
+	{
+	unsigned int	nLoaded;		// Programs taken from the cache
+	unsigned int	nRejected;		// Binaries found but refused by the driver
+	unsigned int	nStored;
+	};
+
+extern GLTProgramCacheStats gltProgramCacheStats;
+
+#endif
@@ -185,6 +185,16 @@ GLuint gltLoadShaderTripletSrc(const char *szVertexSrc,
 GLuint gltLoadShaderTripletWithAttributes(const char *szVertexShader,
                                           const char *szGeometryShader,
                                           const char *szFragmentShader, ...);
+
+// A compute shader on its own (GL 4.3). Returns 0 if it will not build.
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+GLuint gltLoadComputeShader(const char *szComputeProg);
+
+// Entry points newer than the bundled GLEW knows about. NULL if the driver
+// does not have it.
+void *gltGetProcAddress(const char *szName);
 #endif
 
 GLuint gltLoadShaderPairSrc(const char *szVertexSrc, const char *szFragmentSrc);
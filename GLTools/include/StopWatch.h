@@ -4,8 +4,8 @@
 // March 23, 1999
 // 
 // This function uses the High performance counter on Win32 and
-// gettimeofday on Mac OS X/Linux. gettimeofday is actually pretty
-// good on the Mac (about 10ms).
+// clock_gettime(CLOCK_MONOTONIC) everywhere else. Both are monotonic,
+// so NTP and the user setting the clock cannot make time run backwards.
 
 /* Copyright (c) 2005-2009, Richard S. Wright Jr.
 All rights reserved.
@@ -41,64 +41,113 @@ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF S
 #ifdef WIN32
 #include <windows.h>
 #else
-#include <sys/time.h>
+#include <time.h>
 #endif
 
+#include <stdint.h>
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // Simple Stopwatch class. Use this for high resolution timing 
 // purposes (or, even low resolution timings)
 // Pretty self-explanitory.... 
 // Reset(), or GetElapsedSeconds().
+// Time is kept as integer nanoseconds, so it does not lose resolution
+// however long the program has been running. Lap() reads and resets in one
+// go, so no time falls between the two.
 class CStopWatch
 	{
 	public:
 		CStopWatch(void)	// Constructor
 			{
-			#ifdef WIN32
-			QueryPerformanceFrequency(&m_CounterFrequency);
-			QueryPerformanceCounter(&m_LastCount);
-			#else
-            gettimeofday(&m_LastCount, 0);
-			#endif
+			m_nLastCount = GetTimeNanoseconds();
 			}
 
 		// Resets timer (difference) to zero
 		inline void Reset(void) 
 			{
-			#ifdef WIN32
-			QueryPerformanceCounter(&m_LastCount);
-			#else
-			gettimeofday(&m_LastCount, 0);
-			#endif
+			m_nLastCount = GetTimeNanoseconds();
 			}					
 		
 		// Get elapsed time in seconds
-		float GetElapsedSeconds(void)
+		double GetElapsedSeconds(void)
+			{
+			return double(GetElapsedNanoseconds()) * 1e-9;
+			}	
+
+		// Get elapsed time in nanoseconds
+		int64_t GetElapsedNanoseconds(void)
+			{
+			return GetTimeNanoseconds() - m_nLastCount;
+			}
+
+		// Elapsed time, and start over from the same instant
+		int64_t LapNanoseconds(void)
+			{
+			int64_t nNow = GetTimeNanoseconds();
+			int64_t nElapsed = nNow - m_nLastCount;
+			m_nLastCount = nNow;
+			return nElapsed;
+			}
+
+		double Lap(void)
+			{
+			return double(LapNanoseconds()) * 1e-9;
+			}
+
+		// The clock itself. Only differences mean anything.
+		static int64_t GetTimeNanoseconds(void)
 			{
-			// Get the current count
 			#ifdef WIN32
+			static LARGE_INTEGER frequency = { 0 };
+			if(frequency.QuadPart == 0)
+				QueryPerformanceFrequency(&frequency);
+
 			LARGE_INTEGER lCurrent;
 			QueryPerformanceCounter(&lCurrent);
 
-			return float((lCurrent.QuadPart - m_LastCount.QuadPart) /
-										double(m_CounterFrequency.QuadPart));
+			// Split to avoid overflowing the multiply
+			int64_t nSeconds = lCurrent.QuadPart / frequency.QuadPart;
+			int64_t nRemainder = lCurrent.QuadPart % frequency.QuadPart;
+			return nSeconds * 1000000000 + nRemainder * 1000000000 / frequency.QuadPart;
 			#else
-            timeval lcurrent;
-            gettimeofday(&lcurrent, 0);
-            float fSeconds = (float)(lcurrent.tv_sec - m_LastCount.tv_sec);
-            float fFraction = (float)(lcurrent.tv_usec - m_LastCount.tv_usec) * 0.000001f;
-            return fSeconds + fFraction;
+			timespec current;
+			clock_gettime(CLOCK_MONOTONIC, &current);
+			return int64_t(current.tv_sec) * 1000000000 + current.tv_nsec;
 			#endif
-			}	
+			}
 	
 	protected:
-	#ifdef WIN32
-		LARGE_INTEGER m_CounterFrequency;
-		LARGE_INTEGER m_LastCount;
-	#else
-        timeval m_LastCount;
-	#endif
+		int64_t m_nLastCount;
+	};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Adds the time between its construction and destruction to a running total.
+//		{
+//		CScopedTimer timer(nDrawNanoseconds);
+//		... code being timed ...
+//		}
+class CScopedTimer
+	{
+	public:
+		CScopedTimer(int64_t &nTotalNanoseconds) : m_nTotal(nTotalNanoseconds)
+			{
+			m_nStart = CStopWatch::GetTimeNanoseconds();
+			}
+
+		~CScopedTimer(void)
+			{
+			m_nTotal += CStopWatch::GetTimeNanoseconds() - m_nStart;
+			}
+
+	protected:
+		int64_t		&m_nTotal;
+		int64_t		m_nStart;
+
+	private:
+		CScopedTimer(const CScopedTimer &);
+		CScopedTimer &operator=(const CScopedTimer &);
 	};
 
 
@@ -412,6 +412,21 @@ void m3dMatrixMultiply44(M3DMatrix44d product, const M3DMatrix44d a, const M3DMa
 void m3dMatrixMultiply33(M3DMatrix33f product, const M3DMatrix33f a, const M3DMatrix33f b);
 void m3dMatrixMultiply33(M3DMatrix33d product, const M3DMatrix33d a, const M3DMatrix33d b);
 
+////////////////////////////////////////////////////////////////////////////////
+// Batch versions of the above, for whole arrays at a time. Implemented in Math.cpp
+// with SSE when the compiler targets it (every x86-64 build does), plain C otherwise.
+// No alignment is required, and a product may overwrite either of its inputs.
+// products[i] = a[i] * b[i]
+void m3dMatrixMultiply44Batch(M3DMatrix44f *products, const M3DMatrix44f *a, const M3DMatrix44f *b, int nCount);
+// products[i] = a * b[i], e.g. one view matrix times every model matrix
+void m3dMatrixMultiply44Batch(M3DMatrix44f *products, const M3DMatrix44f a, const M3DMatrix44f *b, int nCount);
+// vOut[i] = m * v[i]
+void m3dTransformVector4Batch(M3DVector4f *vOut, const M3DVector4f *v, const M3DMatrix44f m, int nCount);
+// Spheres (x, y, z, radius) against planes (a, b, c, d, normals pointing in): bVisible[i]
+// is 0 if sphere i lies wholly on the outer side of any plane, 1 otherwise. SSE tests four
+// spheres at once. Returns the number visible.
+int m3dTestSpheresBatch(unsigned char *bVisible, const M3DVector4f *vSpheres, const M3DVector4f *vPlanes, int nPlanes, int nCount);
+
 
 // Transform - Does rotation and translation via a 4x4 matrix. Transforms
 // a point or vector.
@@ -35,6 +35,7 @@ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF S
 
 #include <GLBatch.h>
 #include <GLShaderManager.h>
+#include <GLProfiler.h>
 
 
 //////////////////////// TEMPORARY TEMPORARY TEMPORARY - On SnowLeopard this is suppored, but GLEW doens't hook up properly
@@ -184,6 +185,7 @@ void GLBatch::CopyTexCoordData2f(M3DVector2f *vTexCoords, GLuint uiTextureLayer)
 // Bind everything up in a little package
 void GLBatch::End(void)
 	{
+	GLT_PROFILE_FUNCTION();
 #ifndef OPENGL_ES
 	// Check to see if items have been added one at a time
 	if(pVerts != NULL) {
@@ -497,6 +499,8 @@ void GLBatch::Draw(void)
 
 
 	glDrawArrays(primitiveType, 0, nNumVerts);
+	gltCountStateChange();
+	gltCountDraw(primitiveType, nNumVerts);
 	
     #ifndef OPENGL_ES
 	glBindVertexArray(0);
@@ -0,0 +1,221 @@
+// GLProfiler.cpp
+// Scoped CPU timing with Chrome trace-event export.
+
+#include <GLTools.h>
+#include <GLProfiler.h>
+
+
+GLTDrawStats gltDrawStats = { 0, 0, 0 };
+
+void gltResetDrawStats(void)
+	{
+	gltDrawStats.nDrawCalls = 0;
+	gltDrawStats.nTriangles = 0;
+	gltDrawStats.nStateChanges = 0;
+	}
+
+void gltCountDraw(unsigned int ePrimitive, unsigned int nVertices)
+	{
+	gltDrawStats.nDrawCalls++;
+
+	switch(ePrimitive) {
+		case GL_TRIANGLES:
+			gltDrawStats.nTriangles += nVertices / 3;
+			break;
+		case GL_TRIANGLE_STRIP:
+		case GL_TRIANGLE_FAN:
+			if(nVertices > 2)
+				gltDrawStats.nTriangles += nVertices - 2;
+			break;
+		}
+	}
+
+#ifdef GLT_PROFILE
+
+#include <stdio.h>
+#include <string.h>
+
+struct GLProfileEvent
+	{
+	const char	*szName;
+	int64_t		nStart;
+	int64_t		nEnd;
+	};
+
+// One per thread. Only the owning thread writes events; nHead is published
+// with release so the exporter sees whole events.
+struct GLProfileRing
+	{
+	GLProfileEvent			events[GLT_PROFILE_RING_SIZE];
+	std::atomic<uint32_t>	nHead;			// Events ever written, wraps around
+	int						nThreadId;
+	char					szThreadName[32];
+	GLProfileRing			*pNext;
+	};
+
+std::atomic<bool>					gltProfileRecording(false);
+
+static std::atomic<bool>			profileCapturing(false);
+static std::atomic<bool>			profileKeepRecent(false);
+
+static std::atomic<GLProfileRing *>	ringList(NULL);
+static std::atomic<int>				nextThreadId(1);
+static thread_local GLProfileRing	*pThreadRing = NULL;
+static int64_t						nCaptureStart = 0;
+
+
+// The calling thread's ring, created and linked in on first use. Rings are
+// never freed so events from threads that have exited still export.
+static GLProfileRing *gltProfileGetRing(void)
+	{
+	if(pThreadRing != NULL)
+		return pThreadRing;
+
+	GLProfileRing *pRing = new GLProfileRing;
+	pRing->nHead.store(0, std::memory_order_relaxed);
+	pRing->nThreadId = nextThreadId.fetch_add(1);
+	snprintf(pRing->szThreadName, sizeof(pRing->szThreadName), "thread %d", pRing->nThreadId);
+
+	pRing->pNext = ringList.load(std::memory_order_relaxed);
+	while(!ringList.compare_exchange_weak(pRing->pNext, pRing, std::memory_order_release, std::memory_order_relaxed))
+		;
+
+	pThreadRing = pRing;
+	return pRing;
+	}
+
+void gltProfileRecord(const char *szName, int64_t nStart, int64_t nEnd)
+	{
+	GLProfileRing *pRing = gltProfileGetRing();
+	uint32_t nHead = pRing->nHead.load(std::memory_order_relaxed);
+
+	GLProfileEvent &event = pRing->events[nHead & (GLT_PROFILE_RING_SIZE - 1)];
+	event.szName = szName;
+	event.nStart = nStart;
+	event.nEnd = nEnd;
+
+	pRing->nHead.store(nHead + 1, std::memory_order_release);
+	}
+
+void gltProfileSetThreadName(const char *szName)
+	{
+	GLProfileRing *pRing = gltProfileGetRing();
+	strncpy(pRing->szThreadName, szName, sizeof(pRing->szThreadName) - 1);
+	pRing->szThreadName[sizeof(pRing->szThreadName) - 1] = '\0';
+	}
+
+void gltProfileBeginCapture(void)
+	{
+	// Older events stay in the rings but fall before the start and are skipped
+	nCaptureStart = CStopWatch::GetTimeNanoseconds();
+	profileCapturing.store(true);
+	gltProfileRecording.store(true);
+	}
+
+bool gltProfileIsCapturing(void)
+	{
+	return profileCapturing.load(std::memory_order_relaxed);
+	}
+
+void gltProfileKeepRecent(bool bKeep)
+	{
+	profileKeepRecent.store(bKeep);
+	gltProfileRecording.store(bKeep || profileCapturing.load());
+	}
+
+int gltProfileGetScopes(int64_t nFrom, int64_t nTo, GLTProfileScope *pScopes, int nMax)
+	{
+	int nFound = 0;
+
+	for(GLProfileRing *pRing = ringList.load(std::memory_order_acquire); pRing != NULL; pRing = pRing->pNext) {
+		// Events are stored as scopes end, so walk back from the newest until
+		// they end before nFrom. The oldest part of the ring may be overwritten
+		// while this reads it, so stay well clear of it.
+		uint32_t nHead = pRing->nHead.load(std::memory_order_acquire);
+		uint32_t nSafe = GLT_PROFILE_RING_SIZE - GLT_PROFILE_RING_SIZE / 8;
+		uint32_t nCount = nHead < nSafe ? nHead : nSafe;
+
+		for(uint32_t i = 0; i < nCount && nFound < nMax; i++) {
+			const GLProfileEvent &event = pRing->events[(nHead - 1 - i) & (GLT_PROFILE_RING_SIZE - 1)];
+			if(event.nEnd < nFrom)
+				break;
+			if(event.nStart > nTo)
+				continue;
+
+			GLTProfileScope &scope = pScopes[nFound++];
+			scope.szName = event.szName;
+			scope.szThread = pRing->szThreadName;
+			scope.nStart = event.nStart;
+			scope.nEnd = event.nEnd;
+			}
+		}
+
+	return nFound;
+	}
+
+// Names are string literals and function names, but keep the JSON valid regardless
+static void gltProfileWriteName(FILE *pFile, const char *szName)
+	{
+	for(const char *p = szName; *p != '\0'; p++) {
+		if(*p == '"' || *p == '\\')
+			fputc('\\', pFile);
+		if((unsigned char)*p >= 0x20)
+			fputc(*p, pFile);
+		}
+	}
+
+int gltProfileEndCapture(const char *szFileName)
+	{
+	profileCapturing.store(false);
+	gltProfileRecording.store(profileKeepRecent.load());
+	int64_t nCaptureEnd = CStopWatch::GetTimeNanoseconds();
+
+	FILE *pFile = fopen(szFileName, "w");
+	if(pFile == NULL)
+		return -1;
+
+	fprintf(pFile, "{\"traceEvents\":[\n");
+	int nEvents = 0;
+	bool bFirst = true;
+
+	for(GLProfileRing *pRing = ringList.load(std::memory_order_acquire); pRing != NULL; pRing = pRing->pNext) {
+		fprintf(pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"",
+				bFirst ? "" : ",\n", pRing->nThreadId);
+		gltProfileWriteName(pFile, pRing->szThreadName);
+		fprintf(pFile, "\"}}");
+		bFirst = false;
+
+		uint32_t nHead = pRing->nHead.load(std::memory_order_acquire);
+		uint32_t nCount = nHead < GLT_PROFILE_RING_SIZE ? nHead : GLT_PROFILE_RING_SIZE;
+
+		for(uint32_t i = nHead - nCount; i != nHead; i++) {
+			const GLProfileEvent &event = pRing->events[i & (GLT_PROFILE_RING_SIZE - 1)];
+			if(event.nStart < nCaptureStart || event.nEnd > nCaptureEnd)
+				continue;
+
+			// Chrome wants microseconds
+			fprintf(pFile, ",\n{\"name\":\"");
+			gltProfileWriteName(pFile, event.szName);
+			fprintf(pFile, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					pRing->nThreadId, double(event.nStart - nCaptureStart) * 1e-3, double(event.nEnd - event.nStart) * 1e-3);
+			nEvents++;
+			}
+		}
+
+	fprintf(pFile, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	if(fclose(pFile) != 0)
+		return -1;
+
+	return nEvents;
+	}
+
+#else
+
+void gltProfileBeginCapture(void) {}
+int gltProfileEndCapture(const char *) { return 0; }
+bool gltProfileIsCapturing(void) { return false; }
+void gltProfileSetThreadName(const char *) {}
+void gltProfileKeepRecent(bool) {}
+int gltProfileGetScopes(int64_t, int64_t, GLTProfileScope *, int) { return 0; }
+
+#endif
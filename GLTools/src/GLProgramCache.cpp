@@ -0,0 +1,228 @@
+// GLProgramCache.cpp
+// Linked shader programs kept on disk between runs.
+
+#include <GLTools.h>
+#include <GLProgramCache.h>
+#include <GLProfiler.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+
+GLTProgramCacheStats gltProgramCacheStats = { 0, 0, 0 };
+
+static std::string	cacheDirectory;
+static bool			cacheEnabled = false;
+static int			cacheSupport = -1;		// Unknown until there is a context
+static uint64_t		driverKey = 0;			// Hash of the driver strings
+static std::vector<GLint>	binaryFormats;
+
+// The file header, then the binary
+struct GLTProgramFile
+	{
+	char		szMagic[4];
+	uint32_t	nFormat;
+	uint32_t	nLength;
+	uint32_t	nPad;
+	uint64_t	nKey;
+	};
+
+static const char programMagic[4] = { 'G', 'L', 'T', 'B' };
+
+void gltSetProgramCache(const char *szDirectory)
+	{
+	cacheEnabled = (szDirectory != NULL);
+	cacheDirectory = cacheEnabled ? szDirectory : "";
+	}
+
+bool gltProgramCacheIsEnabled(void)
+	{
+	return cacheEnabled;
+	}
+
+uint64_t gltProgramCacheHash(uint64_t nKey, const char *szText)
+	{
+	if(szText == NULL)
+		szText = "";
+	for(const unsigned char *p = (const unsigned char *)szText; *p != 0; p++)
+		nKey = (nKey ^ *p) * 1099511628211ull;
+
+	// Ended, so that "ab" then "c" differs from "a" then "bc"
+	return (nKey ^ 0xff) * 1099511628211ull;
+	}
+
+uint64_t gltProgramCacheHash(uint64_t nKey, int nValue)
+	{
+	char szValue[16];
+	sprintf(szValue, "%d", nValue);
+	return gltProgramCacheHash(nKey, szValue);
+	}
+
+#ifndef OPENGL_ES
+
+// Whether the current context can hand out binaries. Decided on first use,
+// when the driver strings go into every key as well.
+static bool CacheSupported(void)
+	{
+	if(cacheSupport < 0)
+		{
+		GLint nFormats = 0;
+		if((GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) && glProgramBinary != NULL && glGetProgramBinary != NULL)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats);
+		cacheSupport = (nFormats > 0) ? 1 : 0;
+		if(nFormats > 0)
+			{
+			binaryFormats.resize(nFormats);
+			glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, &binaryFormats[0]);
+			}
+
+		driverKey = GLT_PROGRAM_CACHE_SEED;
+		const GLenum eStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+		for(int i = 0; i < 4; i++)
+			driverKey = gltProgramCacheHash(driverKey, (const char *)glGetString(eStrings[i]));
+		}
+	return cacheSupport == 1;
+	}
+
+static std::string ProgramFileName(uint64_t nKey)
+	{
+	char szName[32];
+	sprintf(szName, "%016llx.bin", (unsigned long long)nKey);
+	return cacheDirectory + "/" + szName;
+	}
+
+// The program and driver together
+static uint64_t FileKey(uint64_t nKey)
+	{
+	return (nKey ^ driverKey) * 1099511628211ull;
+	}
+
+bool gltProgramCacheLoad(GLuint hProgram, uint64_t nKey)
+	{
+	if(!cacheEnabled || !CacheSupported())
+		return false;
+	GLT_PROFILE_FUNCTION();
+
+	// Without this some drivers have nothing to give back after linking
+	glProgramParameteri(hProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	nKey = FileKey(nKey);
+	FILE *pFile = fopen(ProgramFileName(nKey).c_str(), "rb");
+	if(pFile == NULL)
+		return false;
+
+	GLTProgramFile header;
+	std::vector<unsigned char> binary;
+	bool bRead = fread(&header, sizeof(header), 1, pFile) == 1 &&
+				 memcmp(header.szMagic, programMagic, sizeof(programMagic)) == 0 &&
+				 header.nKey == nKey && header.nLength > 0;
+
+	// The length has to be what is left of the file, or a damaged header
+	// could ask for gigabytes
+	if(bRead)
+		{
+		long nStart = ftell(pFile);
+		bRead = nStart >= 0 && fseek(pFile, 0, SEEK_END) == 0 &&
+				ftell(pFile) - nStart == long(header.nLength) &&
+				fseek(pFile, nStart, SEEK_SET) == 0;
+		}
+	if(bRead)
+		{
+		binary.resize(header.nLength);
+		bRead = fread(&binary[0], 1, header.nLength, pFile) == header.nLength;
+		}
+	fclose(pFile);
+
+	// A format this driver does not list would only raise GL_INVALID_ENUM
+	bool bFormat = false;
+	for(size_t i = 0; bRead && i < binaryFormats.size(); i++)
+		bFormat = bFormat || GLenum(binaryFormats[i]) == header.nFormat;
+
+	GLint testVal = GL_FALSE;
+	if(bRead && bFormat)
+		{
+		glProgramBinary(hProgram, header.nFormat, &binary[0], header.nLength);
+		glGetProgramiv(hProgram, GL_LINK_STATUS, &testVal);
+		}
+	if(testVal == GL_FALSE)
+		{
+		gltProgramCacheStats.nRejected++;
+		return false;
+		}
+
+	gltProgramCacheStats.nLoaded++;
+	return true;
+	}
+
+void gltProgramCacheStore(GLuint hProgram, uint64_t nKey)
+	{
+	if(!cacheEnabled || !CacheSupported())
+		return;
+	GLT_PROFILE_FUNCTION();
+
+	GLint nLength = 0;
+	glGetProgramiv(hProgram, GL_PROGRAM_BINARY_LENGTH, &nLength);
+	if(nLength <= 0)
+		return;
+
+	std::vector<unsigned char> binary(nLength);
+	GLenum eFormat = 0;
+	GLsizei nWritten = 0;
+	glGetProgramBinary(hProgram, nLength, &nWritten, &eFormat, &binary[0]);
+	if(nWritten <= 0)
+		return;
+
+	GLTProgramFile header;
+	memcpy(header.szMagic, programMagic, sizeof(programMagic));
+	header.nFormat = eFormat;
+	header.nLength = uint32_t(nWritten);
+	header.nPad = 0;
+	header.nKey = FileKey(nKey);
+
+	// Written aside and renamed, so another run never reads half a file. The
+	// temporary is this process's own: two runs storing the same program at
+	// once would otherwise write into one file
+	std::string name = ProgramFileName(header.nKey);
+	char szSuffix[32];
+	sprintf(szSuffix, ".%d.tmp", int(getpid()));
+	std::string temporary = name + szSuffix;
+	FILE *pFile = fopen(temporary.c_str(), "wb");
+	if(pFile == NULL)
+		return;
+	bool bWritten = fwrite(&header, sizeof(header), 1, pFile) == 1 &&
+					fwrite(&binary[0], 1, nWritten, pFile) == size_t(nWritten);
+	bWritten = (fclose(pFile) == 0) && bWritten;
+#ifdef _WIN32
+	remove(name.c_str());
+#endif
+	if(!bWritten || rename(temporary.c_str(), name.c_str()) != 0)
+		{
+		remove(temporary.c_str());
+		return;
+		}
+
+	gltProgramCacheStats.nStored++;
+	}
+
+#else
+
+// No program binaries in OpenGL ES 2
+bool gltProgramCacheLoad(GLuint hProgram, uint64_t nKey)
+	{
+	return false;
+	}
+
+void gltProgramCacheStore(GLuint hProgram, uint64_t nKey)
+	{
+	}
+
+#endif
@@ -36,6 +36,8 @@ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF S
 #include <GLTools.h>
 #include <math3d.h>
 #include <GLTriangleBatch.h>
+#include <GLProfiler.h>
+#include <GLProgramCache.h>
 #include <stdio.h>
 #include <assert.h>
 #include <stdarg.h>
@@ -152,6 +154,7 @@ void gltSetWorkingDirectory(const char *szArgv)
 // Draw a torus (doughnut)  at z = fZVal... torus is in xy plane
 void gltMakeTorus(GLTriangleBatch& torusBatch, GLfloat majorRadius, GLfloat minorRadius, GLint numMajor, GLint numMinor)
 	{
+	GLT_PROFILE_FUNCTION();
     double majorStep = 2.0f*M3D_PI / numMajor;
     double minorStep = 2.0f*M3D_PI / numMinor;
     int i, j;
@@ -248,6 +251,7 @@ void gltMakeTorus(GLTriangleBatch& torusBatch, GLfloat majorRadius, GLfloat mino
 // Make a sphere
 void gltMakeSphere(GLTriangleBatch& sphereBatch, GLfloat fRadius, GLint iSlices, GLint iStacks)
 	{
+	GLT_PROFILE_FUNCTION();
     GLfloat drho = (GLfloat)(3.141592653589) / (GLfloat) iStacks;
     GLfloat dtheta = 2.0f * (GLfloat)(3.141592653589) / (GLfloat) iSlices;
 	GLfloat ds = 1.0f / (GLfloat) iSlices;
@@ -359,6 +363,7 @@ void gltMakeSphere(GLTriangleBatch& sphereBatch, GLfloat fRadius, GLint iSlices,
 ////////////////////////////////////////////////////////////////////////////////////////
 void gltMakeDisk(GLTriangleBatch& diskBatch, GLfloat innerRadius, GLfloat outerRadius, GLint nSlices, GLint nStacks)
 	{
+	GLT_PROFILE_FUNCTION();
 	// How much to step out each stack
 	GLfloat fStepSizeRadial = outerRadius - innerRadius;
 	if(fStepSizeRadial < 0.0f)			// Dum dum...
@@ -462,6 +467,7 @@ void gltMakeDisk(GLTriangleBatch& diskBatch, GLfloat innerRadius, GLfloat outerR
 void gltMakeCylinder(GLTriangleBatch& cylinderBatch, GLfloat baseRadius, GLfloat topRadius, 
 			GLfloat fLength, GLint numSlices, GLint numStacks)
 	{	
+	GLT_PROFILE_FUNCTION();
     float fRadiusStep = (topRadius - baseRadius) / float(numStacks);
 
 	GLfloat fStepSizeSlice = (3.1415926536f * 2.0f) / float(numSlices);
@@ -823,10 +829,14 @@ GLint gltGrabScreenTGA(const char *szFileName)
 	glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
     
     // Get the current read buffer setting and save it. Switch to
-    // the front buffer and do the read operation. Finally, restore
+    // the front buffer (or the first color attachment when a framebuffer
+    // object is bound) and do the read operation. Finally, restore
     // the read buffer state
+    GLint iFramebuffer = 0;
+    if(GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object)
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &iFramebuffer);
     glGetIntegerv(GL_READ_BUFFER, (GLint *)&lastBuffer);
-    glReadBuffer(GL_FRONT);
+    glReadBuffer(iFramebuffer != 0 ? GL_COLOR_ATTACHMENT0 : GL_FRONT);
     glReadPixels(0, 0, iViewport[2], iViewport[3], GL_BGR_EXT, GL_UNSIGNED_BYTE, pBits);
     glReadBuffer(lastBuffer);
     
@@ -1179,29 +1189,20 @@ GLuint gltLoadShaderTripletWithAttributes(const char *szVertexShader,
     va_list attributeList;
     char *szNextArg = NULL;
     char infoLog[1024];
+    uint64_t nKey = GLT_PROGRAM_CACHE_SEED;
 
-    // Create shader objects
+    // Create shader objects and load them
     hVertexShader = glCreateShader(GL_VERTEX_SHADER);
     if (gltLoadShaderFile(szVertexShader, hVertexShader) == false)
         goto failed;
-    glCompileShader(hVertexShader);
-    glGetShaderiv(hVertexShader, GL_COMPILE_STATUS, &testVal);
-    if  (testVal == GL_FALSE) {
-        glGetShaderInfoLog(hVertexShader, 1024, NULL, infoLog);
-        goto failed;
-    }
+    nKey = gltProgramCacheHash(nKey, (const char *)shaderText);
 
     // Geometry shader is optional
     if (szGeometryShader) {
         hGeometryShader = glCreateShader(GL_GEOMETRY_SHADER);
         if(gltLoadShaderFile(szGeometryShader, hGeometryShader) == false)
             goto failed;
-        glCompileShader(hGeometryShader);
-        glGetShaderiv(hGeometryShader, GL_COMPILE_STATUS, &testVal);
-        if  (testVal == GL_FALSE) {
-            glGetShaderInfoLog(hGeometryShader, 1024, NULL, infoLog);
-            goto failed;
-        }
+        nKey = gltProgramCacheHash(nKey, (const char *)shaderText);
     }
 
     // Fragment shader is optional (transform feedback only)
@@ -1209,21 +1210,11 @@ GLuint gltLoadShaderTripletWithAttributes(const char *szVertexShader,
         hFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
         if (gltLoadShaderFile(szFragmentShader, hFragmentShader) == false)
             goto failed;
-        glCompileShader(hFragmentShader);
-        glGetShaderiv(hFragmentShader, GL_COMPILE_STATUS, &testVal);
-        if  (testVal == GL_FALSE) {
-            glGetShaderInfoLog(hFragmentShader, 1024, NULL, infoLog);
-            goto failed;
-        }
+        nKey = gltProgramCacheHash(nKey, (const char *)shaderText);
     }
 
-    // Create the final program object, and attach the shaders
+    // Create the final program object
     hReturn = glCreateProgram();
-    glAttachShader(hReturn, hVertexShader);
-    if (szGeometryShader)
-        glAttachShader(hReturn, hGeometryShader);
-    if (szFragmentShader)
-        glAttachShader(hReturn, hFragmentShader);
 
     // Now, we need to bind the attribute names to their specific locations
     // List of attributes
@@ -1236,9 +1227,47 @@ GLuint gltLoadShaderTripletWithAttributes(const char *szVertexShader,
         int index = va_arg(attributeList, int);
         szNextArg = va_arg(attributeList, char*);
         glBindAttribLocation(hReturn, index, szNextArg);
+        nKey = gltProgramCacheHash(gltProgramCacheHash(nKey, index), szNextArg);
     }
     va_end(attributeList);
 
+    // Linked on an earlier run, nothing to compile
+    if (gltProgramCacheLoad(hReturn, nKey)) {
+        glDeleteShader(hVertexShader);
+        glDeleteShader(hGeometryShader);
+        glDeleteShader(hFragmentShader);
+        return hReturn;
+    }
+
+    // Compile them and attach them
+    glCompileShader(hVertexShader);
+    glGetShaderiv(hVertexShader, GL_COMPILE_STATUS, &testVal);
+    if  (testVal == GL_FALSE) {
+        glGetShaderInfoLog(hVertexShader, 1024, NULL, infoLog);
+        goto failed;
+    }
+    glAttachShader(hReturn, hVertexShader);
+
+    if (szGeometryShader) {
+        glCompileShader(hGeometryShader);
+        glGetShaderiv(hGeometryShader, GL_COMPILE_STATUS, &testVal);
+        if  (testVal == GL_FALSE) {
+            glGetShaderInfoLog(hGeometryShader, 1024, NULL, infoLog);
+            goto failed;
+        }
+        glAttachShader(hReturn, hGeometryShader);
+    }
+
+    if (szFragmentShader) {
+        glCompileShader(hFragmentShader);
+        glGetShaderiv(hFragmentShader, GL_COMPILE_STATUS, &testVal);
+        if  (testVal == GL_FALSE) {
+            glGetShaderInfoLog(hFragmentShader, 1024, NULL, infoLog);
+            goto failed;
+        }
+        glAttachShader(hReturn, hFragmentShader);
+    }
+
     // Attempt to link    
     glLinkProgram(hReturn);
 
@@ -1246,6 +1275,7 @@ GLuint gltLoadShaderTripletWithAttributes(const char *szVertexShader,
     glDeleteShader(hVertexShader);
     glDeleteShader(hGeometryShader);
     glDeleteShader(hFragmentShader);
+    hVertexShader = hGeometryShader = hFragmentShader = 0;
 
     // Make sure link worked too
     glGetProgramiv(hReturn, GL_LINK_STATUS, &testVal);
@@ -1256,6 +1286,9 @@ GLuint gltLoadShaderTripletWithAttributes(const char *szVertexShader,
         goto failed;
     }
 
+    // Kept for the next run
+    gltProgramCacheStore(hReturn, nKey);
+
     // All done, return our ready to use shader program
     return hReturn;
 
@@ -1268,6 +1301,79 @@ failed:
 
     return 0;
 }
+
+/////////////////////////////////////////////////////////////////
+// Load a compute shader, compile, and link it into a program of its own.
+// Specify the complete file path.
+GLuint gltLoadComputeShader(const char *szComputeProg)
+	{
+	GLT_PROFILE_FUNCTION();
+    GLuint hComputeShader = glCreateShader(GL_COMPUTE_SHADER);
+    GLuint hReturn = 0;
+    GLint testVal;
+
+    if(gltLoadShaderFile(szComputeProg, hComputeShader) == false)
+		{
+        glDeleteShader(hComputeShader);
+		fprintf(stderr, "The shader at %s could not be found.\n", szComputeProg);
+        return (GLuint)NULL;
+		}
+
+    // Linked on an earlier run, nothing to compile
+    uint64_t nKey = gltProgramCacheHash(GLT_PROGRAM_CACHE_SEED, (const char *)shaderText);
+    hReturn = glCreateProgram();
+    if(gltProgramCacheLoad(hReturn, nKey))
+		{
+        glDeleteShader(hComputeShader);
+        return hReturn;
+		}
+
+    glCompileShader(hComputeShader);
+    glGetShaderiv(hComputeShader, GL_COMPILE_STATUS, &testVal);
+    if(testVal == GL_FALSE)
+		{
+		char infoLog[1024];
+		glGetShaderInfoLog(hComputeShader, 1024, NULL, infoLog);
+		fprintf(stderr, "The shader at %s failed to compile with the following error:\n%s\n", szComputeProg, infoLog);
+        glDeleteShader(hComputeShader);
+        glDeleteProgram(hReturn);
+        return (GLuint)NULL;
+		}
+
+    glAttachShader(hReturn, hComputeShader);
+    glLinkProgram(hReturn);
+    glDeleteShader(hComputeShader);
+
+    glGetProgramiv(hReturn, GL_LINK_STATUS, &testVal);
+    if(testVal == GL_FALSE)
+		{
+		char infoLog[1024];
+		glGetProgramInfoLog(hReturn, 1024, NULL, infoLog);
+		fprintf(stderr, "The program %s failed to link with the following errors:\n%s\n", szComputeProg, infoLog);
+		glDeleteProgram(hReturn);
+		return (GLuint)NULL;
+		}
+
+    gltProgramCacheStore(hReturn, nKey);
+    return hReturn;
+	}
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+extern "C" void (*glXGetProcAddressARB(const GLubyte *szName))(void);
+#endif
+
+/////////////////////////////////////////////////////////////////
+// Look up an entry point by name, for those the bundled GLEW predates
+void *gltGetProcAddress(const char *szName)
+	{
+#if defined(_WIN32)
+	return (void *)wglGetProcAddress(szName);
+#elif defined(__APPLE__)
+	return NULL;		// Core profile stops at 4.1, GLEW has all of it
+#else
+	return (void *)glXGetProcAddressARB((const GLubyte *)szName);
+#endif
+	}
 #endif
 
 /////////////////////////////////////////////////////////////////
@@ -1276,11 +1382,13 @@ failed:
 // of attributes, followed by the index and attribute name of each attribute
 GLuint gltLoadShaderPairWithAttributes(const char *szVertexProg, const char *szFragmentProg, ...)
 	{
+	GLT_PROFILE_FUNCTION();
     // Temporary Shader objects
     GLuint hVertexShader;
     GLuint hFragmentShader; 
     GLuint hReturn = 0;   
     GLint testVal;
+    uint64_t nKey = GLT_PROGRAM_CACHE_SEED;
 	
     // Create shader objects
     hVertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -1295,6 +1403,7 @@ GLuint gltLoadShaderPairWithAttributes(const char *szVertexProg, const char *szF
 		fprintf(stderr, "The shader at %s could ot be found.\n", szVertexProg);
         return (GLuint)NULL;
 		}
+    nKey = gltProgramCacheHash(nKey, (const char *)shaderText);
 	
     // Fragment Program
     if(gltLoadShaderFile(szFragmentProg, hFragmentShader) == false)
@@ -1304,6 +1413,35 @@ GLuint gltLoadShaderPairWithAttributes(const char *szVertexProg, const char *szF
 		fprintf(stderr,"The shader at %s  could not be found.\n", szFragmentProg);
         return (GLuint)NULL;
 		}
+    nKey = gltProgramCacheHash(nKey, (const char *)shaderText);
+
+    // Create the final program object
+    hReturn = glCreateProgram();
+
+    // Now, we need to bind the attribute names to their specific locations
+	// List of attributes
+	va_list attributeList;
+	va_start(attributeList, szFragmentProg);
+
+    // Iterate over this argument list
+	char *szNextArg;
+	int iArgCount = va_arg(attributeList, int);	// Number of attributes
+	for(int i = 0; i < iArgCount; i++)
+		{
+		int index = va_arg(attributeList, int);
+		szNextArg = va_arg(attributeList, char*);
+		glBindAttribLocation(hReturn, index, szNextArg);
+		nKey = gltProgramCacheHash(gltProgramCacheHash(nKey, index), szNextArg);
+		}
+	va_end(attributeList);
+
+    // Linked on an earlier run, nothing to compile
+    if(gltProgramCacheLoad(hReturn, nKey))
+		{
+        glDeleteShader(hVertexShader);
+        glDeleteShader(hFragmentShader);
+        return hReturn;
+		}
     
     // Compile them both
     glCompileShader(hVertexShader);
@@ -1318,6 +1456,7 @@ GLuint gltLoadShaderPairWithAttributes(const char *szVertexProg, const char *szF
 		fprintf(stderr, "The shader at %s failed to compile with the following error:\n%s\n", szVertexProg, infoLog);
         glDeleteShader(hVertexShader);
         glDeleteShader(hFragmentShader);
+        glDeleteProgram(hReturn);
         return (GLuint)NULL;
 		}
     
@@ -1330,31 +1469,14 @@ GLuint gltLoadShaderPairWithAttributes(const char *szVertexProg, const char *szF
 		fprintf(stderr, "The shader at %s failed to compile with the following error:\n%s\n", szFragmentProg, infoLog);
         glDeleteShader(hVertexShader);
         glDeleteShader(hFragmentShader);
+        glDeleteProgram(hReturn);
         return (GLuint)NULL;
 		}
     
-    // Create the final program object, and attach the shaders
-    hReturn = glCreateProgram();
+    // Attach the shaders
     glAttachShader(hReturn, hVertexShader);
     glAttachShader(hReturn, hFragmentShader);
 
-
-    // Now, we need to bind the attribute names to their specific locations
-	// List of attributes
-	va_list attributeList;
-	va_start(attributeList, szFragmentProg);
-
-    // Iterate over this argument list
-	char *szNextArg;
-	int iArgCount = va_arg(attributeList, int);	// Number of attributes
-	for(int i = 0; i < iArgCount; i++)
-		{
-		int index = va_arg(attributeList, int);
-		szNextArg = va_arg(attributeList, char*);
-		glBindAttribLocation(hReturn, index, szNextArg);
-		}
-	va_end(attributeList);
-
     // Attempt to link    
     glLinkProgram(hReturn);
 	
@@ -1374,6 +1496,9 @@ GLuint gltLoadShaderPairWithAttributes(const char *szVertexProg, const char *szF
 		return (GLuint)NULL;
 		}
     
+    // Kept for the next run
+    gltProgramCacheStore(hReturn, nKey);
+
     // All done, return our ready to use shader program
     return hReturn;  
 	}   
@@ -1604,7 +1729,30 @@ GLuint gltLoadShaderPairSrcWithAttributes(const char *szVertexSrc, const char *s
     GLuint hFragmentShader; 
     GLuint hReturn = 0;   
     GLint testVal;
+    uint64_t nKey = gltProgramCacheHash(gltProgramCacheHash(GLT_PROGRAM_CACHE_SEED, szVertexSrc), szFragmentSrc);
 	
+    // The program, with its attributes bound
+    hReturn = glCreateProgram();
+
+	// List of attributes
+	va_list attributeList;
+	va_start(attributeList, szFragmentSrc);
+
+	char *szNextArg;
+	int iArgCount = va_arg(attributeList, int);	// Number of attributes
+	for(int i = 0; i < iArgCount; i++)
+		{
+		int index = va_arg(attributeList, int);
+		szNextArg = va_arg(attributeList, char*);
+		glBindAttribLocation(hReturn, index, szNextArg);
+		nKey = gltProgramCacheHash(gltProgramCacheHash(nKey, index), szNextArg);
+		}
+	va_end(attributeList);
+
+    // Linked on an earlier run, nothing to compile
+    if(gltProgramCacheLoad(hReturn, nKey))
+        return hReturn;
+
     // Create shader objects
     hVertexShader = glCreateShader(GL_VERTEX_SHADER);
     hFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -1623,6 +1771,7 @@ GLuint gltLoadShaderPairSrcWithAttributes(const char *szVertexSrc, const char *s
 		{
         glDeleteShader(hVertexShader);
         glDeleteShader(hFragmentShader);
+        glDeleteProgram(hReturn);
         return (GLuint)NULL;
 		}
     
@@ -1631,29 +1780,13 @@ GLuint gltLoadShaderPairSrcWithAttributes(const char *szVertexSrc, const char *s
 		{
         glDeleteShader(hVertexShader);
         glDeleteShader(hFragmentShader);
+        glDeleteProgram(hReturn);
         return (GLuint)NULL;
 		}
     
     // Link them - assuming it works...
-    hReturn = glCreateProgram();
     glAttachShader(hReturn, hVertexShader);
     glAttachShader(hReturn, hFragmentShader);
-
-	// List of attributes
-	va_list attributeList;
-	va_start(attributeList, szFragmentSrc);
-
-	char *szNextArg;
-	int iArgCount = va_arg(attributeList, int);	// Number of attributes
-	for(int i = 0; i < iArgCount; i++)
-		{
-		int index = va_arg(attributeList, int);
-		szNextArg = va_arg(attributeList, char*);
-		glBindAttribLocation(hReturn, index, szNextArg);
-		}
-	va_end(attributeList);
-
-
     glLinkProgram(hReturn);
 	
     // These are no longer needed
@@ -1668,6 +1801,7 @@ GLuint gltLoadShaderPairSrcWithAttributes(const char *szVertexSrc, const char *s
 		return (GLuint)NULL;
 		}
     
+    gltProgramCacheStore(hReturn, nKey);
     return hReturn;  
 	}   
 
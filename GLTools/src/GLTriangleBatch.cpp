@@ -45,6 +45,7 @@ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF S
 
 #include <GLTriangleBatch.h>
 #include <GLShaderManager.h>
+#include <GLProfiler.h>
 
 //////////////////////// TEMPORARY TEMPORARY TEMPORARY - On SnowLeopard this is suppored, but GLEW doens't hook up properly
 //////////////////////// Fixed probably in 10.6.3
@@ -177,6 +178,7 @@ void GLTriangleBatch::AddTriangle(M3DVector3f verts[3], M3DVector3f vNorms[3], M
 // is static (doesn't change).
 void GLTriangleBatch::End(void)
     {
+	GLT_PROFILE_FUNCTION();
     #ifndef OPENGL_ES
 	// Create the master vertex array object
 	glGenVertexArrays(1, &vertexArrayBufferObject);
@@ -261,6 +263,8 @@ void GLTriangleBatch::Draw(void)
 
 
     glDrawElements(GL_TRIANGLES, nNumIndexes, GL_UNSIGNED_SHORT, 0);
+    gltCountStateChange();
+    gltCountDraw(GL_TRIANGLES, nNumIndexes);
     
     #ifndef OPENGL_ES
     // Unbind to anybody
@@ -158,6 +158,170 @@ void m3dMatrixMultiply44(M3DMatrix44d product, const M3DMatrix44d a, const M3DMa
 #undef B
 #undef P
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+
+// One product, column by column: each column of the result is the columns of
+// a weighted by one column of b. Everything is loaded before anything is
+// stored, so the product may alias either input.
+static inline void m3dMatrixMultiply44SSE(float *product, const float *a, const float *b)
+{
+	__m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+	__m128 p[4];
+
+	for (int j = 0; j < 4; j++) {
+		__m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[j * 4 + 0]));
+		r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[j * 4 + 1])));
+		r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[j * 4 + 2])));
+		r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[j * 4 + 3])));
+		p[j] = r;
+	}
+
+	_mm_storeu_ps(product, p[0]);
+	_mm_storeu_ps(product + 4, p[1]);
+	_mm_storeu_ps(product + 8, p[2]);
+	_mm_storeu_ps(product + 12, p[3]);
+}
+
+void m3dMatrixMultiply44Batch(M3DMatrix44f *products, const M3DMatrix44f *a, const M3DMatrix44f *b, int nCount)
+{
+	for (int i = 0; i < nCount; i++)
+		m3dMatrixMultiply44SSE(products[i], a[i], b[i]);
+}
+
+void m3dMatrixMultiply44Batch(M3DMatrix44f *products, const M3DMatrix44f a, const M3DMatrix44f *b, int nCount)
+{
+	// a stays in registers for the whole batch
+	__m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+
+	for (int i = 0; i < nCount; i++) {
+		const float *bi = b[i];
+		__m128 p[4];
+
+		for (int j = 0; j < 4; j++) {
+			__m128 r = _mm_mul_ps(a0, _mm_set1_ps(bi[j * 4 + 0]));
+			r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(bi[j * 4 + 1])));
+			r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(bi[j * 4 + 2])));
+			r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(bi[j * 4 + 3])));
+			p[j] = r;
+		}
+
+		_mm_storeu_ps(products[i], p[0]);
+		_mm_storeu_ps(products[i] + 4, p[1]);
+		_mm_storeu_ps(products[i] + 8, p[2]);
+		_mm_storeu_ps(products[i] + 12, p[3]);
+	}
+}
+
+void m3dTransformVector4Batch(M3DVector4f *vOut, const M3DVector4f *v, const M3DMatrix44f m, int nCount)
+{
+	__m128 m0 = _mm_loadu_ps(m), m1 = _mm_loadu_ps(m + 4), m2 = _mm_loadu_ps(m + 8), m3 = _mm_loadu_ps(m + 12);
+
+	for (int i = 0; i < nCount; i++) {
+		__m128 r = _mm_mul_ps(m0, _mm_set1_ps(v[i][0]));
+		r = _mm_add_ps(r, _mm_mul_ps(m1, _mm_set1_ps(v[i][1])));
+		r = _mm_add_ps(r, _mm_mul_ps(m2, _mm_set1_ps(v[i][2])));
+		r = _mm_add_ps(r, _mm_mul_ps(m3, _mm_set1_ps(v[i][3])));
+		_mm_storeu_ps(vOut[i], r);
+	}
+}
+
+// Four spheres at a time, transposed so each register holds one component of
+// all four. A sphere survives a plane while its center is less than its radius
+// behind it, the same test as GLFrustum::TestSphere.
+int m3dTestSpheresBatch(unsigned char *bVisible, const M3DVector4f *vSpheres, const M3DVector4f *vPlanes, int nPlanes, int nCount)
+{
+	int nVisible = 0;
+	int i = 0;
+
+	// Planes splatted once, for up to the six a frustum has
+	__m128 planes[6][4];
+	int nSplat = nPlanes < 6 ? nPlanes : 6;
+	for (int j = 0; j < nSplat; j++)
+		for (int k = 0; k < 4; k++)
+			planes[j][k] = _mm_set1_ps(vPlanes[j][k]);
+
+	for (; i + 4 <= nCount && nSplat == nPlanes; i += 4) {
+		__m128 x = _mm_loadu_ps(vSpheres[i]), y = _mm_loadu_ps(vSpheres[i + 1]);
+		__m128 z = _mm_loadu_ps(vSpheres[i + 2]), r = _mm_loadu_ps(vSpheres[i + 3]);
+		_MM_TRANSPOSE4_PS(x, y, z, r);
+
+		__m128 inside = _mm_cmpeq_ps(x, x);			// All ones; a NaN sphere is culled
+		for (int j = 0; j < nPlanes; j++) {
+			__m128 d = _mm_add_ps(_mm_mul_ps(x, planes[j][0]), _mm_mul_ps(y, planes[j][1]));
+			d = _mm_add_ps(d, _mm_mul_ps(z, planes[j][2]));
+			d = _mm_add_ps(d, _mm_add_ps(r, planes[j][3]));
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(d, _mm_setzero_ps()));
+		}
+
+		int nMask = _mm_movemask_ps(inside);
+		for (int k = 0; k < 4; k++) {
+			bVisible[i + k] = (unsigned char)((nMask >> k) & 1);
+			nVisible += bVisible[i + k];
+		}
+	}
+
+	// The last few one at a time, or all of them past six planes
+	for (; i < nCount; i++) {
+		bVisible[i] = 1;
+		for (int j = 0; j < nPlanes; j++)
+			if (m3dGetDistanceToPlane(vSpheres[i], vPlanes[j]) + vSpheres[i][3] <= 0.0f) {
+				bVisible[i] = 0;
+				break;
+			}
+		nVisible += bVisible[i];
+	}
+
+	return nVisible;
+}
+
+#else
+
+// No SSE. The scalar routines do not allow aliasing, so go through a temporary.
+void m3dMatrixMultiply44Batch(M3DMatrix44f *products, const M3DMatrix44f *a, const M3DMatrix44f *b, int nCount)
+{
+	M3DMatrix44f temp;
+	for (int i = 0; i < nCount; i++) {
+		m3dMatrixMultiply44(temp, a[i], b[i]);
+		m3dCopyMatrix44(products[i], temp);
+	}
+}
+
+void m3dMatrixMultiply44Batch(M3DMatrix44f *products, const M3DMatrix44f a, const M3DMatrix44f *b, int nCount)
+{
+	M3DMatrix44f temp;
+	for (int i = 0; i < nCount; i++) {
+		m3dMatrixMultiply44(temp, a, b[i]);
+		m3dCopyMatrix44(products[i], temp);
+	}
+}
+
+void m3dTransformVector4Batch(M3DVector4f *vOut, const M3DVector4f *v, const M3DMatrix44f m, int nCount)
+{
+	M3DVector4f temp;
+	for (int i = 0; i < nCount; i++) {
+		m3dTransformVector4(temp, v[i], m);
+		m3dCopyVector4(vOut[i], temp);
+	}
+}
+
+int m3dTestSpheresBatch(unsigned char *bVisible, const M3DVector4f *vSpheres, const M3DVector4f *vPlanes, int nPlanes, int nCount)
+{
+	int nVisible = 0;
+	for (int i = 0; i < nCount; i++) {
+		bVisible[i] = 1;
+		for (int j = 0; j < nPlanes; j++)
+			if (m3dGetDistanceToPlane(vSpheres[i], vPlanes[j]) + vSpheres[i][3] <= 0.0f) {
+				bVisible[i] = 0;
+				break;
+			}
+		nVisible += bVisible[i];
+	}
+	return nVisible;
+}
+
+#endif
+
 
 #define A33(row,col)  a[(col*3)+row]
 #define B33(row,col)  b[(col*3)+row]
@@ -0,0 +1,124 @@
+// CameraController.cpp
+// Flies the camera from key input, in real time rather than per frame.
+
+#include "CameraController.h"
+
+#include <StopWatch.h>
+
+CameraController::CameraController(void) : iHead(0), iTail(0)
+{
+    for(int i = 0; i < CAMERA_CONTROL_LAST; i++)
+        bHeld[i] = false;
+
+    // Already cruising, as the camera always has
+    motion.fPitchRate = 0.0f;
+    motion.fRollRate = 0.0f;
+    motion.fSpeed = CAMERA_CRUISE_SPEED;
+}
+
+void CameraController::Press(CAMERA_CONTROL eControl, bool bDown)
+{
+    int iSlot = iHead.load(std::memory_order_relaxed);
+    if(iSlot - iTail.load(std::memory_order_acquire) >= CAMERA_QUEUE_SIZE)
+        return;     // Full. Hundreds of unread key changes means nothing is reading.
+
+    Event &event = events[iSlot & (CAMERA_QUEUE_SIZE - 1)];
+    event.nTime = CStopWatch::GetTimeNanoseconds();
+    event.eControl = eControl;
+    event.bDown = bDown;
+    iHead.store(iSlot + 1, std::memory_order_release);
+}
+
+void CameraController::Integrate(GLFrame &frame, int64_t nFrom, int64_t nTo)
+{
+    int64_t nTime = nFrom;
+    int iSlot = iTail.load(std::memory_order_relaxed);
+
+    while(iSlot != iHead.load(std::memory_order_acquire)) {
+        const Event &event = events[iSlot & (CAMERA_QUEUE_SIZE - 1)];
+        if(event.nTime > nTo)
+            break;      // Belongs to the next step
+
+        // An event stamped before nFrom arrived late; it takes effect now
+        if(event.nTime > nTime) {
+            Advance(frame, float(double(event.nTime - nTime) * 1e-9));
+            nTime = event.nTime;
+        }
+        bHeld[event.eControl] = event.bDown;
+
+        iSlot++;
+        iTail.store(iSlot, std::memory_order_release);
+    }
+
+    if(nTo > nTime)
+        Advance(frame, float(double(nTo - nTime) * 1e-9));
+}
+
+bool CameraController::IsMoving(void) const
+{
+    for(int i = 0; i < CAMERA_BOOST; i++)
+        if(bHeld[i])
+            return true;
+
+    return motion.fPitchRate != 0.0f || motion.fRollRate != 0.0f || motion.fSpeed != 0.0f || !bHeld[CAMERA_STOP];
+}
+
+void CameraController::Predict(GLFrame &frame, const CameraMotion &motion, float fSeconds)
+{
+    Move(frame, motion.fPitchRate * fSeconds, motion.fRollRate * fSeconds, motion.fSpeed * fSeconds);
+}
+
+// Step fValue toward fTarget by at most fStep
+float CameraController::Approach(float fValue, float fTarget, float fStep)
+{
+    if(fValue < fTarget)
+        return (fValue + fStep < fTarget) ? fValue + fStep : fTarget;
+    return (fValue - fStep > fTarget) ? fValue - fStep : fTarget;
+}
+
+// Keys are steady over fSeconds. Rates ramp at a constant acceleration, and
+// each substep moves by the average of its start and end rates.
+void CameraController::Advance(GLFrame &frame, float fSeconds)
+{
+    float fPitchTarget = CAMERA_PITCH_RATE * ((bHeld[CAMERA_PITCH_UP] ? 1.0f : 0.0f) - (bHeld[CAMERA_PITCH_DOWN] ? 1.0f : 0.0f));
+    float fRollTarget = CAMERA_ROLL_RATE * ((bHeld[CAMERA_ROLL_RIGHT] ? 1.0f : 0.0f) - (bHeld[CAMERA_ROLL_LEFT] ? 1.0f : 0.0f));
+    float fSpeedTarget = bHeld[CAMERA_STOP] ? 0.0f : (bHeld[CAMERA_BOOST] ? CAMERA_BOOST_SPEED : CAMERA_CRUISE_SPEED);
+
+    while(fSeconds > 0.0f) {
+        float dt = fSeconds < CAMERA_MAX_SUBSTEP ? fSeconds : CAMERA_MAX_SUBSTEP;
+        fSeconds -= dt;
+
+        CameraMotion start = motion;
+        motion.fPitchRate = Approach(motion.fPitchRate, fPitchTarget, CAMERA_PITCH_RATE / CAMERA_TURN_RAMP * dt);
+        motion.fRollRate = Approach(motion.fRollRate, fRollTarget, CAMERA_ROLL_RATE / CAMERA_TURN_RAMP * dt);
+        motion.fSpeed = Approach(motion.fSpeed, fSpeedTarget, CAMERA_ACCELERATION * dt);
+
+        Move(frame, 0.5f * (start.fPitchRate + motion.fPitchRate) * dt,
+                    0.5f * (start.fRollRate + motion.fRollRate) * dt,
+                    0.5f * (start.fSpeed + motion.fSpeed) * dt);
+    }
+}
+
+// Pitch and roll in degrees about the camera's own axes, then fly forward
+void CameraController::Move(GLFrame &frame, float fPitch, float fRoll, float fDistance)
+{
+    M3DVector3f vLocal, vWorld;
+
+    if(fPitch != 0.0f) {
+        m3dLoadVector3(vLocal, 1.0f, 0.0f, 0.0f);
+        frame.LocalToWorld(vLocal, vWorld, true);
+        frame.RotateWorld(float(m3dDegToRad(fPitch)), vWorld[0], vWorld[1], vWorld[2]);
+    }
+
+    if(fRoll != 0.0f) {
+        m3dLoadVector3(vLocal, 0.0f, 0.0f, 1.0f);
+        frame.LocalToWorld(vLocal, vWorld, true);
+        frame.RotateWorld(float(m3dDegToRad(fRoll)), vWorld[0], vWorld[1], vWorld[2]);
+    }
+
+    if(fDistance != 0.0f) {
+        m3dLoadVector3(vLocal, 0.0f, 0.0f, fDistance);
+        frame.LocalToWorld(vLocal, vWorld, true);
+        frame.TranslateWorld(vWorld[0], vWorld[1], vWorld[2]);
+    }
+}
@@ -0,0 +1,84 @@
+// CameraController.h
+// Flies the camera from key input, in real time rather than per frame.
+//
+// The GLUT callbacks only record what happened and when: Press() stamps each
+// key change with the monotonic clock and queues it. The simulation then
+// calls Integrate() for the stretch of time it is stepping. Events inside the
+// stretch split it, so a key held for 30 ms turns the camera 30 ms worth
+// whatever the frame or step rate. Turn rates and forward speed ramp toward
+// their targets at a fixed acceleration instead of jumping.
+//
+// The queue is single producer (the input thread), single consumer (the
+// simulation) and takes no locks.
+
+#ifndef __SOLAR_CAMERA_CONTROLLER
+#define __SOLAR_CAMERA_CONTROLLER
+
+#include <GLFrame.h>
+
+#include <atomic>
+#include <stdint.h>
+
+enum CAMERA_CONTROL { CAMERA_PITCH_UP = 0, CAMERA_PITCH_DOWN, CAMERA_ROLL_LEFT, CAMERA_ROLL_RIGHT,
+                      CAMERA_BOOST, CAMERA_STOP, CAMERA_CONTROL_LAST };
+
+#define CAMERA_PITCH_RATE       60.0f       // Degrees per second
+#define CAMERA_ROLL_RATE        180.0f
+#define CAMERA_TURN_RAMP        0.1f        // Seconds from still to full turn rate
+#define CAMERA_CRUISE_SPEED     0.3f        // Units per second
+#define CAMERA_BOOST_SPEED      3.0f
+#define CAMERA_ACCELERATION     6.0f        // Units per second squared
+#define CAMERA_MAX_SUBSTEP      0.004f      // Longest stretch integrated in one go, seconds
+#define CAMERA_QUEUE_SIZE       256         // Key events in flight, a power of two
+#define CAMERA_MAX_PREDICTION   0.05        // Furthest Predict() is trusted ahead, seconds
+
+// Turn rates and speed, everything needed to carry the camera forward in time
+struct CameraMotion
+    {
+    float   fPitchRate;     // Degrees per second about the camera's X axis
+    float   fRollRate;      // Degrees per second about its Z axis
+    float   fSpeed;         // Units per second along its forward vector
+    };
+
+class CameraController
+    {
+    public:
+        CameraController(void);
+
+        // Input thread. The event is stamped with the current time.
+        void Press(CAMERA_CONTROL eControl, bool bDown);
+
+        // Simulation thread. Moves frame through (nFrom, nTo], clock nanoseconds,
+        // applying every event queued up to nTo at the time it happened.
+        void Integrate(GLFrame &frame, int64_t nFrom, int64_t nTo);
+
+        const CameraMotion &GetMotion(void) const { return motion; }
+
+        // Would the camera move without further input?
+        bool IsMoving(void) const;
+
+        // Carry frame dSeconds further at a constant motion. For drawing
+        // between simulation steps.
+        static void Predict(GLFrame &frame, const CameraMotion &motion, float fSeconds);
+
+    protected:
+        struct Event
+            {
+            int64_t     nTime;
+            int         eControl;
+            bool        bDown;
+            };
+
+        void Advance(GLFrame &frame, float fSeconds);
+        static void Move(GLFrame &frame, float fPitch, float fRoll, float fDistance);
+        static float Approach(float fValue, float fTarget, float fStep);
+
+        Event               events[CAMERA_QUEUE_SIZE];
+        std::atomic<int>    iHead;      // Next slot Press() fills
+        std::atomic<int>    iTail;      // Next slot Integrate() reads
+
+        bool                bHeld[CAMERA_CONTROL_LAST];
+        CameraMotion        motion;
+    };
+
+#endif
@@ -0,0 +1,112 @@
+// CameraPath.cpp
+// A camera flight through time-stamped keys, smoothed with Catmull-Rom splines.
+
+#include "CameraPath.h"
+
+#include <math.h>
+
+void CameraPath::AddKey(double dTime, const M3DVector3f vOrigin, const M3DVector3f vForward, const M3DVector3f vUp)
+{
+    Key key;
+    key.dTime = dTime;
+    m3dCopyVector3(key.vOrigin, vOrigin);
+    m3dCopyVector3(key.vForward, vForward);
+    m3dCopyVector3(key.vUp, vUp);
+    keys.push_back(key);
+}
+
+bool CameraPath::Load(const char *szFileName)
+{
+    FILE *pFile = fopen(szFileName, "r");
+    if(pFile == NULL)
+        return false;
+
+    keys.clear();
+    char szLine[512];
+    while(fgets(szLine, sizeof(szLine), pFile) != NULL) {
+        Key key;
+        if(szLine[0] == '#')
+            continue;
+        if(sscanf(szLine, "%lf %f %f %f %f %f %f %f %f %f", &key.dTime,
+                  &key.vOrigin[0], &key.vOrigin[1], &key.vOrigin[2],
+                  &key.vForward[0], &key.vForward[1], &key.vForward[2],
+                  &key.vUp[0], &key.vUp[1], &key.vUp[2]) != 10)
+            continue;
+        if(!keys.empty() && key.dTime <= keys.back().dTime)
+            continue;   // Out of order, or a duplicate from a frame that took no time
+        keys.push_back(key);
+    }
+
+    fclose(pFile);
+    return !keys.empty();
+}
+
+void CameraPath::MakeDefault(void)
+{
+    // The Sun is 11 units straight ahead of the starting camera
+    const float fCenterZ = -11.0f;
+    const float fRadii[9]  = { 11.0f, 9.0f, 6.5f, 4.0f, 3.0f, 4.5f, 7.0f, 9.5f, 11.0f };
+    const float fHeights[9] = { 0.0f, 1.5f, 3.0f, 2.0f, 0.5f, -1.0f, 1.0f, 2.5f, 0.0f };
+
+    keys.clear();
+    for(int i = 0; i < 9; i++) {
+        float fAngle = float(i) * float(M3D_2PI) / 8.0f;
+        M3DVector3f vOrigin = { fRadii[i] * sinf(fAngle), fHeights[i], fCenterZ + fRadii[i] * cosf(fAngle) };
+        M3DVector3f vForward = { -vOrigin[0], -vOrigin[1], fCenterZ - vOrigin[2] };
+        M3DVector3f vUp = { 0.0f, 1.0f, 0.0f };
+        m3dNormalizeVector3(vForward);
+        AddKey(2.5 * i, vOrigin, vForward, vUp);
+    }
+}
+
+void CameraPath::Apply(GLFrame &frame, double dTime) const
+{
+    if(keys.empty())
+        return;
+
+    // Segment [i, i + 1] holds dTime; the ends repeat so the spline stops there
+    int n = int(keys.size());
+    int i = 0;
+    while(i < n - 1 && keys[i + 1].dTime <= dTime)
+        i++;
+
+    const Key &k1 = keys[i];
+    if(i == n - 1 || dTime <= k1.dTime) {
+        frame.SetOrigin(k1.vOrigin);
+        frame.SetForwardVector(k1.vForward);
+        frame.SetUpVector(k1.vUp);
+        return;
+    }
+
+    const Key &k0 = keys[i > 0 ? i - 1 : i];
+    const Key &k2 = keys[i + 1];
+    const Key &k3 = keys[i + 2 < n ? i + 2 : i + 1];
+    float t = float((dTime - k1.dTime) / (k2.dTime - k1.dTime));
+
+    M3DVector3f vOrigin, vForward, vUp;
+    m3dCatmullRom(vOrigin, k0.vOrigin, k1.vOrigin, k2.vOrigin, k3.vOrigin, t);
+    m3dCatmullRom(vForward, k0.vForward, k1.vForward, k2.vForward, k3.vForward, t);
+    m3dCatmullRom(vUp, k0.vUp, k1.vUp, k2.vUp, k3.vUp, t);
+
+    // Splined axes are neither unit length nor square to each other
+    m3dNormalizeVector3(vForward);
+    float fDot = m3dDotProduct3(vUp, vForward);
+    vUp[0] -= fDot * vForward[0];
+    vUp[1] -= fDot * vForward[1];
+    vUp[2] -= fDot * vForward[2];
+    m3dNormalizeVector3(vUp);
+
+    frame.SetOrigin(vOrigin);
+    frame.SetForwardVector(vForward);
+    frame.SetUpVector(vUp);
+}
+
+void CameraPath::WriteKey(FILE *pFile, double dTime, GLFrame &frame)
+{
+    M3DVector3f vOrigin, vForward, vUp;
+    frame.GetOrigin(vOrigin);
+    frame.GetForwardVector(vForward);
+    frame.GetUpVector(vUp);
+    fprintf(pFile, "%.4f  %.6f %.6f %.6f  %.6f %.6f %.6f  %.6f %.6f %.6f\n", dTime,
+            vOrigin[0], vOrigin[1], vOrigin[2], vForward[0], vForward[1], vForward[2], vUp[0], vUp[1], vUp[2]);
+}
@@ -0,0 +1,56 @@
+// CameraPath.h
+// A camera flight through time-stamped keys, smoothed with Catmull-Rom splines.
+//
+// Each key holds a time in seconds, the camera origin and its forward and up
+// vectors. Between keys all three are splined and the axes re-orthonormalized.
+// Before the first key and after the last the camera holds still.
+//
+// Files are text, one key per line:
+//     t  ox oy oz  fx fy fz  ux uy uz
+// Blank lines and lines starting with # are skipped. solar --record-camera
+// writes the same format.
+
+#ifndef __SOLAR_CAMERA_PATH
+#define __SOLAR_CAMERA_PATH
+
+#include <GLFrame.h>
+
+#include <stdio.h>
+#include <vector>
+
+class CameraPath
+    {
+    public:
+        void Clear(void) { keys.clear(); }
+
+        // Keys must be added in time order
+        void AddKey(double dTime, const M3DVector3f vOrigin, const M3DVector3f vForward, const M3DVector3f vUp);
+
+        // Replaces the keys. False if the file cannot be read or has no keys.
+        bool Load(const char *szFileName);
+
+        // A loop around the Sun that takes in the inner planets and Saturn
+        void MakeDefault(void);
+
+        int GetKeyCount(void) const { return int(keys.size()); }
+        double GetDuration(void) const { return keys.empty() ? 0.0 : keys.back().dTime; }
+
+        // Put the camera where the path is at dTime
+        void Apply(GLFrame &frame, double dTime) const;
+
+        // One line of the file format
+        static void WriteKey(FILE *pFile, double dTime, GLFrame &frame);
+
+    protected:
+        struct Key
+            {
+            double      dTime;
+            M3DVector3f vOrigin;
+            M3DVector3f vForward;
+            M3DVector3f vUp;
+            };
+
+        std::vector<Key> keys;
+    };
+
+#endif
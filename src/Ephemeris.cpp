@@ -0,0 +1,237 @@
+// Ephemeris.cpp
+// Precomputed planetary ephemeris, Chebyshev evaluation and fitting.
+
+#include "Ephemeris.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+Ephemeris::Ephemeris(void) : pData(NULL), nDataSize(0), bMapped(false), pHeader(NULL), pBodies(NULL)
+{
+}
+
+Ephemeris::~Ephemeris(void)
+{
+    Close();
+}
+
+bool Ephemeris::Open(const char *szFileName)
+{
+    Close();
+
+#ifndef WIN32
+    int fd = open(szFileName, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat fileInfo;
+    if(fstat(fd, &fileInfo) != 0 || fileInfo.st_size < (off_t)sizeof(EphemerisHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void *pMap = mmap(NULL, size_t(fileInfo.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(pMap == MAP_FAILED)
+        return false;
+
+    pData = (const unsigned char *)pMap;
+    nDataSize = size_t(fileInfo.st_size);
+    bMapped = true;
+#else
+    // No mmap here, just read it in. The tables are small.
+    FILE *pFile = fopen(szFileName, "rb");
+    if(pFile == NULL)
+        return false;
+
+    fseek(pFile, 0, SEEK_END);
+    long lSize = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    unsigned char *pBuffer = (unsigned char *)malloc(lSize > 0 ? lSize : 1);
+    if(lSize < (long)sizeof(EphemerisHeader) || fread(pBuffer, 1, lSize, pFile) != size_t(lSize)) {
+        free(pBuffer);
+        fclose(pFile);
+        return false;
+    }
+    fclose(pFile);
+
+    pData = pBuffer;
+    nDataSize = size_t(lSize);
+    bMapped = false;
+#endif
+
+    // Validate everything up front so evaluation never has to
+    pHeader = (const EphemerisHeader *)pData;
+    bool bValid = memcmp(pHeader->szMagic, EPHEMERIS_MAGIC, sizeof(EPHEMERIS_MAGIC)) == 0 &&
+                  pHeader->nVersion == EPHEMERIS_VERSION &&
+                  pHeader->nDegree <= EPHEMERIS_MAX_DEGREE &&
+                  sizeof(EphemerisHeader) + pHeader->nBodies * sizeof(EphemerisBody) <= nDataSize;
+
+    if(bValid) {
+        pBodies = (const EphemerisBody *)(pData + sizeof(EphemerisHeader));
+        size_t nSegmentSize = sizeof(double) * 3 * (pHeader->nDegree + 1);
+
+        for(uint32_t i = 0; i < pHeader->nBodies && bValid; i++) {
+            const EphemerisBody &body = pBodies[i];
+            bValid = body.nSegments > 0 && body.dSegmentDays > 0.0 &&
+                     body.nCoeffOffset % sizeof(double) == 0 &&
+                     body.nCoeffOffset + body.nSegments * nSegmentSize <= nDataSize;
+        }
+    }
+
+    if(!bValid) {
+        fprintf(stderr, "%s is not a valid ephemeris file\n", szFileName);
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void Ephemeris::Close(void)
+{
+    if(pData != NULL) {
+#ifndef WIN32
+        if(bMapped)
+            munmap((void *)pData, nDataSize);
+        else
+#endif
+            free((void *)pData);
+    }
+
+    pData = NULL;
+    nDataSize = 0;
+    bMapped = false;
+    pHeader = NULL;
+    pBodies = NULL;
+}
+
+int Ephemeris::FindBody(const char *szName) const
+{
+    for(int i = 0; i < GetBodyCount(); i++)
+        if(strncmp(pBodies[i].szName, szName, EPHEMERIS_NAME_LENGTH) == 0)
+            return i;
+
+    return -1;
+}
+
+double Ephemeris::GetStartJD(int iBody) const
+{
+    return pBodies[iBody].dStartJD;
+}
+
+double Ephemeris::GetEndJD(int iBody) const
+{
+    return pBodies[iBody].dStartJD + pBodies[iBody].dSegmentDays * pBodies[iBody].nSegments;
+}
+
+void Ephemeris::GetPosition(int iBody, double dJulianDate, double vPosition[3]) const
+{
+    const EphemerisBody &body = pBodies[iBody];
+    int nDegree = int(pHeader->nDegree);
+
+    // O(1) segment lookup, the segments are evenly spaced
+    double dOffset = (dJulianDate - body.dStartJD) / body.dSegmentDays;
+    int iSegment = int(floor(dOffset));
+    if(iSegment < 0)
+        iSegment = 0;
+    if(iSegment >= int(body.nSegments))
+        iSegment = int(body.nSegments) - 1;
+
+    double t = 2.0 * (dOffset - iSegment) - 1.0;
+    if(t < -1.0) t = -1.0;
+    if(t > 1.0) t = 1.0;
+
+    const double *pCoeffs = (const double *)(pData + body.nCoeffOffset) + iSegment * 3 * (nDegree + 1);
+    for(int axis = 0; axis < 3; axis++)
+        vPosition[axis] = ephemEvalChebyshev(pCoeffs + axis * (nDegree + 1), nDegree, t);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Clenshaw recurrence for sum(c[k] * T_k(t))
+double ephemEvalChebyshev(const double *pCoeffs, int nDegree, double t)
+{
+    double b1 = 0.0, b2 = 0.0;
+    double t2 = 2.0 * t;
+
+    for(int k = nDegree; k >= 1; k--) {
+        double b0 = pCoeffs[k] + t2 * b1 - b2;
+        b2 = b1;
+        b1 = b0;
+    }
+
+    return pCoeffs[0] + t * b1 - b2;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Least squares fit through the normal equations. The systems are tiny
+// (degree 20 at most) and the basis is well conditioned on [-1, 1], so plain
+// Gaussian elimination with partial pivoting is plenty.
+bool ephemFitChebyshev(const double *pTimes, const double *pValues, int nSamples, int nDegree, double *pCoeffs)
+{
+    int n = nDegree + 1;
+    if(nSamples < n || nDegree > EPHEMERIS_MAX_DEGREE)
+        return false;
+
+    double A[EPHEMERIS_MAX_DEGREE + 1][EPHEMERIS_MAX_DEGREE + 2];
+    memset(A, 0, sizeof(A));
+
+    double T[EPHEMERIS_MAX_DEGREE + 1];
+    for(int s = 0; s < nSamples; s++) {
+        // T_0 .. T_n at this sample
+        T[0] = 1.0;
+        if(n > 1)
+            T[1] = pTimes[s];
+        for(int k = 2; k < n; k++)
+            T[k] = 2.0 * pTimes[s] * T[k-1] - T[k-2];
+
+        for(int i = 0; i < n; i++) {
+            for(int j = 0; j < n; j++)
+                A[i][j] += T[i] * T[j];
+            A[i][n] += T[i] * pValues[s];
+        }
+    }
+
+    for(int col = 0; col < n; col++) {
+        int iPivot = col;
+        for(int row = col + 1; row < n; row++)
+            if(fabs(A[row][col]) > fabs(A[iPivot][col]))
+                iPivot = row;
+
+        if(fabs(A[iPivot][col]) < 1e-300)
+            return false;
+
+        if(iPivot != col)
+            for(int k = 0; k <= n; k++) {
+                double dTemp = A[col][k];
+                A[col][k] = A[iPivot][k];
+                A[iPivot][k] = dTemp;
+            }
+
+        for(int row = col + 1; row < n; row++) {
+            double f = A[row][col] / A[col][col];
+            for(int k = col; k <= n; k++)
+                A[row][k] -= f * A[col][k];
+        }
+    }
+
+    for(int row = n - 1; row >= 0; row--) {
+        double dSum = A[row][n];
+        for(int k = row + 1; k < n; k++)
+            dSum -= A[row][k] * pCoeffs[k];
+        pCoeffs[row] = dSum / A[row][row];
+    }
+
+    return true;
+}
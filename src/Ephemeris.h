@@ -0,0 +1,88 @@
+// Ephemeris.h
+// Precomputed planetary ephemeris.
+//
+// Positions are stored as Chebyshev polynomial segments, one series per body
+// and axis, fitted offline by the ephemfit tool from JPL Horizons style vector
+// tables. At run time the coefficient file is memory mapped and any epoch is
+// evaluated in constant time per body: pick the segment, run Clenshaw.
+//
+// File layout (native endian):
+//      EphemerisHeader
+//      EphemerisBody[nBodies]
+//      double coefficients[segments][3][nDegree + 1] for each body, at nCoeffOffset
+
+#ifndef __SOLAR_EPHEMERIS
+#define __SOLAR_EPHEMERIS
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EPHEMERIS_MAGIC         "SOLEPH1"
+#define EPHEMERIS_VERSION       1
+#define EPHEMERIS_NAME_LENGTH   16
+#define EPHEMERIS_MAX_DEGREE    20
+
+struct EphemerisHeader
+    {
+    char        szMagic[8];
+    uint32_t    nVersion;
+    uint32_t    nBodies;
+    uint32_t    nDegree;        // Each series has nDegree + 1 coefficients
+    uint32_t    nReserved;
+    };
+
+struct EphemerisBody
+    {
+    char        szName[EPHEMERIS_NAME_LENGTH];
+    double      dStartJD;       // First epoch covered
+    double      dSegmentDays;   // Length of one Chebyshev segment
+    uint32_t    nSegments;
+    uint32_t    nReserved;
+    uint64_t    nCoeffOffset;   // Byte offset of the first segment
+    };
+
+class Ephemeris
+    {
+    public:
+        Ephemeris(void);
+        ~Ephemeris(void);
+
+        // Map a coefficient file. Returns false (and stays closed) if it is not valid.
+        bool Open(const char *szFileName);
+        void Close(void);
+        bool IsOpen(void) const { return pData != NULL; }
+
+        // Returns the body index, or -1 if the file does not have it
+        int FindBody(const char *szName) const;
+
+        // Heliocentric position (AU) of a body at a Julian date. Epochs outside
+        // the table are clamped to its first or last segment.
+        void GetPosition(int iBody, double dJulianDate, double vPosition[3]) const;
+
+        // Span covered by a body
+        double GetStartJD(int iBody) const;
+        double GetEndJD(int iBody) const;
+
+        int GetBodyCount(void) const { return pHeader ? int(pHeader->nBodies) : 0; }
+
+    protected:
+        const unsigned char     *pData;
+        size_t                  nDataSize;
+        bool                    bMapped;    // Came from mmap, not malloc
+
+        const EphemerisHeader   *pHeader;
+        const EphemerisBody     *pBodies;
+    };
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Offline fitting, used by the ephemfit tool
+
+// Fit one segment of degree nDegree to nSamples (time, value) pairs. Times
+// must already be mapped onto [-1, 1]. Returns false if the system is singular.
+bool ephemFitChebyshev(const double *pTimes, const double *pValues, int nSamples, int nDegree, double *pCoeffs);
+
+// Sum a Chebyshev series at t in [-1, 1]
+double ephemEvalChebyshev(const double *pCoeffs, int nDegree, double t);
+
+#endif
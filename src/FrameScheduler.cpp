@@ -0,0 +1,88 @@
+// FrameScheduler.cpp
+// Decides when the next frame is drawn, and sleeps until then.
+
+#include "FrameScheduler.h"
+
+#include <StopWatch.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <errno.h>
+#endif
+
+FrameScheduler::FrameScheduler(void) : eMode(FRAME_PACING_TARGET_FPS), nNextFrame(0), bInvalid(true)
+{
+    SetTargetFPS(FRAME_DEFAULT_FPS);
+}
+
+const char *FrameScheduler::GetModeName(FRAME_PACING eMode)
+{
+    switch(eMode) {
+        case FRAME_PACING_TARGET_FPS:   return "target fps";
+        case FRAME_PACING_VSYNC:        return "vsync";
+        case FRAME_PACING_ON_DEMAND:    return "on demand";
+        default:                        return "unknown";
+    }
+}
+
+void FrameScheduler::SetTargetFPS(double dFPS)
+{
+    if(dFPS < 1.0)
+        dFPS = 1.0;
+
+    nPeriod = int64_t(1e9 / dFPS);
+    nNextFrame = 0;
+}
+
+bool FrameScheduler::IsFrameNeeded(bool bAnimating) const
+{
+    if(eMode != FRAME_PACING_ON_DEMAND)
+        return true;
+
+    return bAnimating || bInvalid;
+}
+
+void FrameScheduler::WaitForNextFrame(void)
+{
+    if(eMode == FRAME_PACING_VSYNC)
+        return;
+
+    // First frame, or too far behind to catch up: start the schedule over
+    // rather than rushing out a burst of frames
+    int64_t nNow = GetTime();
+    if(nNextFrame == 0 || nNow - nNextFrame > nPeriod)
+        nNextFrame = nNow;
+
+    SleepUntil(nNextFrame);
+    nNextFrame += nPeriod;
+}
+
+int64_t FrameScheduler::GetTime(void)
+{
+    return CStopWatch::GetTimeNanoseconds();
+}
+
+void FrameScheduler::SleepUntil(int64_t nDeadline, int64_t nSpin)
+{
+    int64_t nWake = nDeadline - nSpin;
+
+#ifdef WIN32
+    int64_t nNow = GetTime();
+    if(nWake > nNow)
+        Sleep(DWORD((nWake - nNow) / 1000000));
+#else
+    if(nWake > GetTime()) {
+        timespec wake;
+        wake.tv_sec = time_t(nWake / 1000000000);
+        wake.tv_nsec = long(nWake % 1000000000);
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR)
+            ;
+    }
+#endif
+
+    // The scheduler may wake us late by a fraction of a millisecond; spin the rest
+    while(GetTime() < nDeadline)
+        ;
+}
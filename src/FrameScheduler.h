@@ -0,0 +1,60 @@
+// FrameScheduler.h
+// Decides when the next frame is drawn, and sleeps until then.
+//
+// Three modes:
+//   target FPS - frames start on a fixed period. The wait is a clock_nanosleep
+//                to just short of the deadline and a short spin for the rest,
+//                so the core is idle between frames but the deadline is still met.
+//   vsync      - no waiting here. The swap blocks on the display refresh.
+//   on demand  - like target FPS while something moves, and no frames at all
+//                while nothing does until Invalidate() is called.
+
+#ifndef __SOLAR_FRAME_SCHEDULER
+#define __SOLAR_FRAME_SCHEDULER
+
+#include <stdint.h>
+
+enum FRAME_PACING { FRAME_PACING_TARGET_FPS = 0, FRAME_PACING_VSYNC, FRAME_PACING_ON_DEMAND, FRAME_PACING_LAST };
+
+#define FRAME_DEFAULT_FPS       60.0
+#define FRAME_SPIN_NANOSECONDS  1500000     // Busy-wait only for this last stretch before a deadline
+
+class FrameScheduler
+    {
+    public:
+        FrameScheduler(void);
+
+        void SetMode(FRAME_PACING eNewMode) { eMode = eNewMode; nNextFrame = 0; bInvalid = true; }
+        FRAME_PACING GetMode(void) const { return eMode; }
+        static const char *GetModeName(FRAME_PACING eMode);
+
+        void SetTargetFPS(double dFPS);
+        double GetTargetFPS(void) const { return 1e9 / double(nPeriod); }
+
+        // Something changed that needs a new frame (on-demand mode)
+        void Invalidate(void) { bInvalid = true; }
+
+        // Does another frame need drawing? bAnimating says whether the scene is
+        // moving on its own. Only on-demand mode ever answers no.
+        bool IsFrameNeeded(bool bAnimating) const;
+
+        // Sleep until the next frame is due
+        void WaitForNextFrame(void);
+
+        // The frame has been presented
+        void FrameDone(void) { bInvalid = false; }
+
+        // Monotonic clock, nanoseconds
+        static int64_t GetTime(void);
+
+        // Sleep until nDeadline (GetTime() units), spinning for the last nSpin
+        static void SleepUntil(int64_t nDeadline, int64_t nSpin = FRAME_SPIN_NANOSECONDS);
+
+    protected:
+        FRAME_PACING    eMode;
+        int64_t         nPeriod;        // Nanoseconds per frame
+        int64_t         nNextFrame;     // When the next frame is due, 0 if not scheduled
+        bool            bInvalid;
+    };
+
+#endif
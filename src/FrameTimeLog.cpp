@@ -0,0 +1,354 @@
+// FrameTimeLog.cpp
+// Frame interval histograms and a stutter log.
+
+#include "FrameTimeLog.h"
+
+#include <StopWatch.h>
+
+#include <algorithm>
+#include <string>
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////
+// Log-linear buckets. Below 2 * HALF every microsecond has its own; above,
+// each power of two is split into HALF equal buckets.
+int FrameHistogram::GetBucket(int64_t nMicroseconds)
+{
+    if(nMicroseconds < 0)
+        return 0;
+    if(nMicroseconds < 2 * FRAME_HISTOGRAM_HALF)
+        return int(nMicroseconds);
+    if(nMicroseconds >= (int64_t(1) << FRAME_HISTOGRAM_MAX_BITS))
+        return FRAME_HISTOGRAM_BUCKETS - 1;
+
+    int nTopBit = 63 - __builtin_clzll(uint64_t(nMicroseconds));
+    int nShift = nTopBit - 6;                               // Leaves HALF..2 * HALF - 1
+    return FRAME_HISTOGRAM_HALF * nShift + int(nMicroseconds >> nShift);
+}
+
+int64_t FrameHistogram::GetBucketLow(int iBucket)
+{
+    if(iBucket < 2 * FRAME_HISTOGRAM_HALF)
+        return iBucket;
+
+    int nShift = iBucket / FRAME_HISTOGRAM_HALF - 1;
+    return int64_t(iBucket - FRAME_HISTOGRAM_HALF * nShift) << nShift;
+}
+
+void FrameHistogram::Clear(void)
+{
+    memset(nBuckets, 0, sizeof(nBuckets));
+    nCount = 0;
+}
+
+void FrameHistogram::Add(int64_t nMicroseconds)
+{
+    nBuckets[GetBucket(nMicroseconds)]++;
+    nCount++;
+}
+
+void FrameHistogram::Remove(int64_t nMicroseconds)
+{
+    nBuckets[GetBucket(nMicroseconds)]--;
+    nCount--;
+}
+
+double FrameHistogram::GetPercentile(double dPercent) const
+{
+    if(nCount == 0)
+        return 0.0;
+
+    int64_t nRank = int64_t(dPercent / 100.0 * double(nCount) + 0.999999);
+    if(nRank < 1)
+        nRank = 1;
+
+    int64_t nSeen = 0;
+    for(int i = 0; i < FRAME_HISTOGRAM_BUCKETS; i++) {
+        nSeen += nBuckets[i];
+        if(nSeen >= nRank)
+            return double(GetBucketLow(i) + GetBucketHigh(i)) * 0.5e-3;
+    }
+    return double(GetBucketLow(FRAME_HISTOGRAM_BUCKETS - 1)) * 1e-3;
+}
+
+
+//////////////////////////////////////////////////////////////////
+FrameTimeLog::FrameTimeLog(void) : dStutterFactor(FRAME_LOG_STUTTER_FACTOR), nFrames(0), nStartTime(0), nLastSwap(0),
+    nNotes(0), nStutters(0), iScopesPending(-1), szOutput(NULL), nPeriod(0), nNextWrite(0)
+{
+    // Never grows while running
+    stutters.reserve(FRAME_LOG_MAX_STUTTERS);
+}
+
+void FrameTimeLog::SetOutput(const char *szFile, double dPeriod)
+{
+    szOutput = szFile;
+    nPeriod = int64_t(dPeriod * 1e9);
+    nNextWrite = 0;
+}
+
+void FrameTimeLog::Note(const char *szNote)
+{
+    for(int i = 0; i < nNotes; i++)
+        if(szNotes[i] == szNote)
+            return;
+
+    if(nNotes < FRAME_LOG_MAX_NOTES)
+        szNotes[nNotes++] = szNote;
+}
+
+void FrameTimeLog::FrameDone(void)
+{
+    int64_t nNow = CStopWatch::GetTimeNanoseconds();
+    if(nStartTime == 0)
+        nStartTime = nNow;
+
+    // Scopes still open at the last swap, RenderScene around it for one,
+    // have ended by now
+    if(iScopesPending >= 0) {
+        CollectScopes(stutters[iScopesPending]);
+        iScopesPending = -1;
+    }
+
+    if(nLastSwap != 0) {
+        int64_t nInterval = (nNow - nLastSwap) / 1000;
+
+        // The median of the frames before this one, so a long run of slow
+        // frames only counts as stutter until it becomes the norm. The first
+        // frames, often the worst, come before there is a median; they are
+        // all logged and sorted out once there is.
+        if(recent.GetCount() < FRAME_LOG_MIN_FRAMES)
+            LogStutter(nLastSwap, nNow, 0.0);
+        else {
+            double dMedian = recent.GetPercentile(50.0);
+            if(double(nInterval) * 1e-3 > dStutterFactor * dMedian)
+                LogStutter(nLastSwap, nNow, dMedian);
+        }
+
+        int iSlot = int(nFrames % FRAME_LOG_WINDOW);
+        if(nFrames >= FRAME_LOG_WINDOW)
+            recent.Remove(nWindow[iSlot]);
+        nWindow[iSlot] = nInterval;
+        recent.Add(nInterval);
+        total.Add(nInterval);
+        nFrames++;
+
+        if(recent.GetCount() == FRAME_LOG_MIN_FRAMES && nFrames == FRAME_LOG_MIN_FRAMES)
+            SettleFirstFrames();
+    }
+    nLastSwap = nNow;
+    nNotes = 0;
+
+    if(szOutput != NULL && nPeriod > 0) {
+        if(nNextWrite == 0)
+            nNextWrite = nNow + nPeriod;
+        else if(nNow >= nNextWrite) {
+            nNextWrite = nNow + nPeriod;
+            Write();
+
+            // The write holds up the next frame; say so if it shows
+            Note("frame log written");
+        }
+    }
+}
+
+void FrameTimeLog::LogStutter(int64_t nStart, int64_t nEnd, double dMedian)
+{
+    Stutter *pStutter;
+    if(int(stutters.size()) < FRAME_LOG_MAX_STUTTERS) {
+        stutters.push_back(Stutter());
+        pStutter = &stutters.back();
+    }
+    else
+        pStutter = &stutters[nStutters % FRAME_LOG_MAX_STUTTERS];
+    nStutters++;
+
+    pStutter->nFrame = nFrames;
+    pStutter->nStart = nStart;
+    pStutter->nEnd = nEnd;
+    pStutter->dMedian = dMedian;
+    pStutter->nNotes = nNotes;
+    for(int i = 0; i < nNotes; i++)
+        pStutter->szNotes[i] = szNotes[i];
+    pStutter->nScopes = 0;
+    iScopesPending = int(pStutter - &stutters[0]);
+}
+
+// The scopes that took up most of the frame tell where the time went. Ones
+// that only graze it (the last frame's RenderScene ends just after the swap
+// this frame is timed from) are left out.
+void FrameTimeLog::CollectScopes(Stutter &stutter)
+{
+    int64_t nFrom = stutter.nStart, nTo = stutter.nEnd;
+    auto Overlap = [nFrom, nTo](const GLTProfileScope &scope) {
+        return (scope.nEnd < nTo ? scope.nEnd : nTo) - (scope.nStart > nFrom ? scope.nStart : nFrom);
+    };
+
+    GLTProfileScope found[64];
+    int nFound = gltProfileGetScopes(nFrom, nTo, found, 64);
+    std::sort(found, found + nFound,
+              [&Overlap](const GLTProfileScope &a, const GLTProfileScope &b) { return Overlap(a) > Overlap(b); });
+
+    stutter.nScopes = 0;
+    for(int i = 0; i < nFound && stutter.nScopes < FRAME_LOG_MAX_SCOPES && Overlap(found[i]) * 100 >= nTo - nFrom; i++)
+        stutter.scopes[stutter.nScopes++] = found[i];
+}
+
+// Keep only the first frames that turned out to be stutters
+void FrameTimeLog::SettleFirstFrames(void)
+{
+    double dMedian = recent.GetPercentile(50.0);
+    int nKept = 0;
+    int iPending = -1;
+    for(int i = 0; i < int(stutters.size()); i++) {
+        if(double(stutters[i].nEnd - stutters[i].nStart) * 1e-6 > dStutterFactor * dMedian) {
+            if(i == iScopesPending)
+                iPending = nKept;
+            stutters[nKept] = stutters[i];
+            stutters[nKept++].dMedian = dMedian;
+        }
+    }
+    iScopesPending = iPending;
+    stutters.resize(nKept);
+    nStutters = nKept;
+}
+
+//////////////////////////////////////////////////////////////////
+// Strings only ever come from the program itself, but keep the output valid
+static void WriteString(FILE *pFile, const char *szString, char cQuote)
+{
+    fputc('"', pFile);
+    for(const char *p = szString; *p != '\0'; p++) {
+        if(*p == '"')
+            fputc(cQuote, pFile);
+        else if(*p == '\\' && cQuote == '\\')
+            fputc('\\', pFile);
+        if((unsigned char)*p >= 0x20)
+            fputc(*p, pFile);
+    }
+    fputc('"', pFile);
+}
+
+bool FrameTimeLog::WriteJSON(FILE *pFile) const
+{
+    double dElapsed = nLastSwap > nStartTime ? double(nLastSwap - nStartTime) * 1e-9 : 0.0;
+    fprintf(pFile, "{\n  \"frames\": %lld,\n  \"seconds\": %.3f,\n  \"stutter_factor\": %.2f,\n  \"stutters\": %d,\n",
+            (long long)nFrames, dElapsed, dStutterFactor, nStutters);
+
+    const FrameHistogram *pHistograms[2] = { &recent, &total };
+    const char *szNames[2] = { "recent", "total" };
+    for(int h = 0; h < 2; h++) {
+        const FrameHistogram &histogram = *pHistograms[h];
+        fprintf(pFile, "  \"%s\": { \"frames\": %lld, \"min_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, \"p999_ms\": %.3f, \"max_ms\": %.3f,\n"
+                       "    \"histogram\": [",
+                szNames[h], (long long)histogram.GetCount(), histogram.GetPercentile(0.0), histogram.GetPercentile(50.0),
+                histogram.GetPercentile(90.0), histogram.GetPercentile(99.0), histogram.GetPercentile(99.9), histogram.GetPercentile(100.0));
+
+        // Only the buckets in use, [low ms, high ms, frames]
+        bool bFirst = true;
+        for(int i = 0; i < FRAME_HISTOGRAM_BUCKETS; i++) {
+            if(histogram.GetBucketCount(i) == 0)
+                continue;
+            fprintf(pFile, "%s[%.3f, %.3f, %d]", bFirst ? "" : ", ", double(FrameHistogram::GetBucketLow(i)) * 1e-3,
+                    double(FrameHistogram::GetBucketHigh(i)) * 1e-3, histogram.GetBucketCount(i));
+            bFirst = false;
+        }
+        fprintf(pFile, "] },\n");
+    }
+
+    // Oldest first
+    fprintf(pFile, "  \"stutter_log\": [");
+    int nKept = int(stutters.size());
+    for(int i = 0; i < nKept; i++) {
+        const Stutter &stutter = stutters[(nStutters - nKept + i) % FRAME_LOG_MAX_STUTTERS];
+        fprintf(pFile, "%s\n    { \"frame\": %lld, \"time_s\": %.3f, \"interval_ms\": %.3f, \"median_ms\": %.3f, \"notes\": [",
+                i == 0 ? "" : ",", (long long)stutter.nFrame, double(stutter.nStart - nStartTime) * 1e-9,
+                double(stutter.nEnd - stutter.nStart) * 1e-6, stutter.dMedian);
+        for(int j = 0; j < stutter.nNotes; j++) {
+            if(j > 0)
+                fprintf(pFile, ", ");
+            WriteString(pFile, stutter.szNotes[j], '\\');
+        }
+        fprintf(pFile, "], \"scopes\": [");
+        for(int j = 0; j < stutter.nScopes; j++) {
+            const GLTProfileScope &scope = stutter.scopes[j];
+            fprintf(pFile, "%s{ \"name\": ", j == 0 ? "" : ", ");
+            WriteString(pFile, scope.szName, '\\');
+            fprintf(pFile, ", \"thread\": ");
+            WriteString(pFile, scope.szThread, '\\');
+            fprintf(pFile, ", \"start_ms\": %.3f, \"ms\": %.3f }", double(scope.nStart - stutter.nStart) * 1e-6,
+                    double(scope.nEnd - scope.nStart) * 1e-6);
+        }
+        fprintf(pFile, "] }");
+    }
+    fprintf(pFile, "\n  ]\n}\n");
+    return ferror(pFile) == 0;
+}
+
+// A summary and the histogram as # comments, then one row per stutter. Notes
+// and scopes are ; separated within their column.
+bool FrameTimeLog::WriteCSV(FILE *pFile) const
+{
+    fprintf(pFile, "# frames %lld, stutter factor %.2f, stutters %d\n", (long long)nFrames, dStutterFactor, nStutters);
+    fprintf(pFile, "# recent %lld frames: p50 %.3f p90 %.3f p99 %.3f max %.3f ms\n", (long long)recent.GetCount(),
+            recent.GetPercentile(50.0), recent.GetPercentile(90.0), recent.GetPercentile(99.0), recent.GetPercentile(100.0));
+    fprintf(pFile, "# total %lld frames: p50 %.3f p90 %.3f p99 %.3f max %.3f ms\n", (long long)total.GetCount(),
+            total.GetPercentile(50.0), total.GetPercentile(90.0), total.GetPercentile(99.0), total.GetPercentile(100.0));
+    fprintf(pFile, "# histogram (total): low_ms,high_ms,frames\n");
+    for(int i = 0; i < FRAME_HISTOGRAM_BUCKETS; i++)
+        if(total.GetBucketCount(i) != 0)
+            fprintf(pFile, "# %.3f,%.3f,%d\n", double(FrameHistogram::GetBucketLow(i)) * 1e-3,
+                    double(FrameHistogram::GetBucketHigh(i)) * 1e-3, total.GetBucketCount(i));
+
+    fprintf(pFile, "frame,time_s,interval_ms,median_ms,notes,scopes\n");
+    int nKept = int(stutters.size());
+    for(int i = 0; i < nKept; i++) {
+        const Stutter &stutter = stutters[(nStutters - nKept + i) % FRAME_LOG_MAX_STUTTERS];
+        fprintf(pFile, "%lld,%.3f,%.3f,%.3f,", (long long)stutter.nFrame, double(stutter.nStart - nStartTime) * 1e-9,
+                double(stutter.nEnd - stutter.nStart) * 1e-6, stutter.dMedian);
+
+        std::string notes;
+        for(int j = 0; j < stutter.nNotes; j++)
+            notes += std::string(j > 0 ? ";" : "") + stutter.szNotes[j];
+        WriteString(pFile, notes.c_str(), '"');
+        fputc(',', pFile);
+
+        std::string scopes;
+        char szTime[32];
+        for(int j = 0; j < stutter.nScopes; j++) {
+            const GLTProfileScope &scope = stutter.scopes[j];
+            snprintf(szTime, sizeof(szTime), " %.3f ms", double(scope.nEnd - scope.nStart) * 1e-6);
+            scopes += std::string(j > 0 ? ";" : "") + scope.szThread + "/" + scope.szName + szTime;
+        }
+        WriteString(pFile, scopes.c_str(), '"');
+        fputc('\n', pFile);
+    }
+    return ferror(pFile) == 0;
+}
+
+// Written beside the file and renamed over it, so whoever picks the file up
+// never sees half of it
+bool FrameTimeLog::Write(void)
+{
+    if(szOutput == NULL)
+        return true;
+
+    if(iScopesPending >= 0) {
+        CollectScopes(stutters[iScopesPending]);
+        iScopesPending = -1;
+    }
+
+    std::string temp = std::string(szOutput) + ".tmp";
+    FILE *pFile = fopen(temp.c_str(), "w");
+    if(pFile == NULL)
+        return false;
+
+    size_t nLength = strlen(szOutput);
+    bool bCSV = nLength >= 4 && strcmp(szOutput + nLength - 4, ".csv") == 0;
+    bool bWritten = bCSV ? WriteCSV(pFile) : WriteJSON(pFile);
+    if(fclose(pFile) != 0 || !bWritten || rename(temp.c_str(), szOutput) != 0) {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
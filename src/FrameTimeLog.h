@@ -0,0 +1,128 @@
+// FrameTimeLog.h
+// Frame interval histograms and a stutter log, for finding hitches that an
+// average frame rate hides.
+//
+// Intervals are swap to swap, in microseconds, kept in log-linear (HDR)
+// histograms: 64 buckets per power of two, so any value is within 1.6%
+// whatever its size, from 1 us to over two minutes in under 6 KB.
+// One histogram covers the last FRAME_LOG_WINDOW frames and rolls forward,
+// another everything since the start.
+//
+// A frame longer than the stutter factor times the rolling median is logged
+// with what was going on: notes the program made during it (a resize, a
+// texture bound for the first time) and, in PROFILE=1 builds, the profiler
+// scopes on every thread that overlapped it. The log is rewritten to a JSON
+// or CSV file every few seconds and at exit, ready to attach to a report.
+
+#ifndef __SOLAR_FRAME_TIME_LOG
+#define __SOLAR_FRAME_TIME_LOG
+
+#include <GLProfiler.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#define FRAME_HISTOGRAM_MAX_BITS    27      // Largest value, 2^27 us
+#define FRAME_HISTOGRAM_HALF        64      // Buckets per power of two
+#define FRAME_HISTOGRAM_BUCKETS     (FRAME_HISTOGRAM_HALF * (FRAME_HISTOGRAM_MAX_BITS - 5))
+
+#define FRAME_LOG_WINDOW            600     // Frames in the rolling histogram
+#define FRAME_LOG_MIN_FRAMES        30      // Frames before the median is trusted, at most FRAME_LOG_MAX_STUTTERS
+#define FRAME_LOG_STUTTER_FACTOR    2.0
+#define FRAME_LOG_PERIOD            10.0    // Seconds between writes
+#define FRAME_LOG_MAX_STUTTERS      256     // Kept for the file, oldest dropped
+#define FRAME_LOG_MAX_NOTES         4       // Per frame
+#define FRAME_LOG_MAX_SCOPES        8       // Longest profiler scopes kept per stutter
+
+class FrameHistogram
+    {
+    public:
+        FrameHistogram(void) { Clear(); }
+
+        void Clear(void);
+        void Add(int64_t nMicroseconds);
+        void Remove(int64_t nMicroseconds);
+
+        int64_t GetCount(void) const { return nCount; }
+
+        // Milliseconds, the middle of the bucket the percentile falls in
+        double GetPercentile(double dPercent) const;
+
+        static int GetBucket(int64_t nMicroseconds);
+        static int64_t GetBucketLow(int iBucket);
+        static int64_t GetBucketHigh(int iBucket) { return GetBucketLow(iBucket + 1); }
+        int GetBucketCount(int iBucket) const { return nBuckets[iBucket]; }
+
+    protected:
+        int         nBuckets[FRAME_HISTOGRAM_BUCKETS];
+        int64_t     nCount;
+    };
+
+class FrameTimeLog
+    {
+    public:
+        FrameTimeLog(void);
+
+        void SetStutterFactor(double dFactor) { dStutterFactor = dFactor; }
+        double GetStutterFactor(void) const { return dStutterFactor; }
+
+        // Write the log to szFile every dPeriod seconds, and on Write(). A name
+        // ending in .csv gets CSV, anything else JSON.
+        void SetOutput(const char *szFile, double dPeriod = FRAME_LOG_PERIOD);
+
+        // Right after every swap
+        void FrameDone(void);
+
+        // The time until the next swap is not a frame (on-demand idling)
+        void Restart(void) { nLastSwap = 0; }
+
+        // Something that may make this frame slow. szNote must stay valid.
+        void Note(const char *szNote);
+
+        const FrameHistogram &GetRecent(void) const { return recent; }
+        const FrameHistogram &GetTotal(void) const { return total; }
+        int GetStutterCount(void) const { return nStutters; }
+
+        // To the output file, if there is one. False if it cannot be written.
+        bool Write(void);
+
+    protected:
+        struct Stutter
+            {
+            int64_t         nFrame;
+            int64_t         nStart;             // Clock nanoseconds
+            int64_t         nEnd;
+            double          dMedian;            // Milliseconds
+            int             nNotes;
+            const char      *szNotes[FRAME_LOG_MAX_NOTES];
+            int             nScopes;
+            GLTProfileScope scopes[FRAME_LOG_MAX_SCOPES];
+            };
+
+        void LogStutter(int64_t nStart, int64_t nEnd, double dMedian);
+        void CollectScopes(Stutter &stutter);
+        void SettleFirstFrames(void);
+        bool WriteJSON(FILE *pFile) const;
+        bool WriteCSV(FILE *pFile) const;
+
+        double                  dStutterFactor;
+        FrameHistogram          recent;
+        FrameHistogram          total;
+        int64_t                 nWindow[FRAME_LOG_WINDOW];     // Intervals in recent, a ring
+        int64_t                 nFrames;
+        int64_t                 nStartTime;
+        int64_t                 nLastSwap;
+        int                     nNotes;
+        const char              *szNotes[FRAME_LOG_MAX_NOTES];
+
+        std::vector<Stutter>    stutters;           // A ring once full
+        int                     nStutters;          // Ever logged
+        int                     iScopesPending;     // Stutter to collect scopes for at the next swap, or -1
+
+        const char              *szOutput;
+        int64_t                 nPeriod;
+        int64_t                 nNextWrite;
+    };
+
+#endif
@@ -0,0 +1,155 @@
+// GpuTimer.cpp
+// GPU time per render pass from GL_TIMESTAMP queries.
+
+#include "GpuTimer.h"
+
+#include <string.h>
+
+#define FRAME_BEGIN_QUERY   (GPU_PASS_LAST * 2)
+#define FRAME_END_QUERY     (GPU_PASS_LAST * 2 + 1)
+
+GpuTimer::GpuTimer(void) : bAvailable(false), iCurrent(0), dFrameMilliseconds(0.0)
+{
+    memset(sets, 0, sizeof(sets));
+    for(int i = 0; i < GPU_PASS_LAST; i++) {
+        dPassMilliseconds[i] = 0.0;
+        bPassTimed[i] = false;
+    }
+    ResetTotals();
+}
+
+void GpuTimer::ResetTotals(void)
+{
+    for(int i = 0; i < GPU_PASS_LAST; i++) {
+        dPassTotals[i] = 0.0;
+        nPassFrames[i] = 0;
+    }
+    dFrameTotal = 0.0;
+    nCollected = 0;
+}
+
+bool GpuTimer::Init(void)
+{
+    bAvailable = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query) && glQueryCounter != NULL;
+    if(!bAvailable)
+        return false;
+
+    for(int i = 0; i < GPU_TIMER_FRAMES; i++) {
+        glGenQueries(GPU_PASS_LAST * 2 + 2, sets[i].queries);
+        sets[i].bPending = false;
+    }
+
+    iCurrent = 0;
+    return true;
+}
+
+void GpuTimer::Shutdown(void)
+{
+    if(!bAvailable)
+        return;
+
+    for(int i = 0; i < GPU_TIMER_FRAMES; i++)
+        glDeleteQueries(GPU_PASS_LAST * 2 + 2, sets[i].queries);
+
+    bAvailable = false;
+}
+
+const char *GpuTimer::GetPassName(GPU_PASS ePass)
+{
+    static const char *szNames[GPU_PASS_LAST] = { "skybox", "sun", "planets", "indirect", "orbits", "overlay" };
+    return szNames[ePass];
+}
+
+// Read a finished set. The end-of-frame query is issued last, so once it is
+// available all the others are too.
+void GpuTimer::Collect(QuerySet &set)
+{
+    GLuint64 nTimes[GPU_PASS_LAST * 2 + 2];
+
+    for(int i = 0; i < GPU_PASS_LAST; i++) {
+        bPassTimed[i] = set.bIssued[i];
+        if(!set.bIssued[i]) {
+            dPassMilliseconds[i] = 0.0;
+            continue;
+        }
+        glGetQueryObjectui64v(set.queries[i * 2], GL_QUERY_RESULT, &nTimes[i * 2]);
+        glGetQueryObjectui64v(set.queries[i * 2 + 1], GL_QUERY_RESULT, &nTimes[i * 2 + 1]);
+        dPassMilliseconds[i] = double(nTimes[i * 2 + 1] - nTimes[i * 2]) * 1e-6;
+        dPassTotals[i] += dPassMilliseconds[i];
+        nPassFrames[i]++;
+    }
+
+    glGetQueryObjectui64v(set.queries[FRAME_BEGIN_QUERY], GL_QUERY_RESULT, &nTimes[FRAME_BEGIN_QUERY]);
+    glGetQueryObjectui64v(set.queries[FRAME_END_QUERY], GL_QUERY_RESULT, &nTimes[FRAME_END_QUERY]);
+    dFrameMilliseconds = double(nTimes[FRAME_END_QUERY] - nTimes[FRAME_BEGIN_QUERY]) * 1e-6;
+    dFrameTotal += dFrameMilliseconds;
+    nCollected++;
+
+    set.bPending = false;
+}
+
+void GpuTimer::BeginFrame(void)
+{
+    if(!bAvailable)
+        return;
+
+    // Oldest (the one about to be reused) first; stop at the first still in flight
+    for(int i = 0; i < GPU_TIMER_FRAMES; i++) {
+        QuerySet &set = sets[(iCurrent + i) % GPU_TIMER_FRAMES];
+        if(!set.bPending)
+            continue;
+
+        GLuint bReady = GL_FALSE;
+        glGetQueryObjectuiv(set.queries[FRAME_END_QUERY], GL_QUERY_RESULT_AVAILABLE, &bReady);
+        if(!bReady)
+            break;
+        Collect(set);
+    }
+
+    // Still busy after all this time: drop it rather than wait
+    QuerySet &current = sets[iCurrent];
+    current.bPending = false;
+    for(int i = 0; i < GPU_PASS_LAST; i++)
+        current.bIssued[i] = false;
+
+    glQueryCounter(current.queries[FRAME_BEGIN_QUERY], GL_TIMESTAMP);
+}
+
+void GpuTimer::EndFrame(void)
+{
+    if(!bAvailable)
+        return;
+
+    glQueryCounter(sets[iCurrent].queries[FRAME_END_QUERY], GL_TIMESTAMP);
+    sets[iCurrent].bPending = true;
+    iCurrent = (iCurrent + 1) % GPU_TIMER_FRAMES;
+}
+
+void GpuTimer::CollectAll(void)
+{
+    if(!bAvailable)
+        return;
+
+    for(int i = 0; i < GPU_TIMER_FRAMES; i++) {
+        QuerySet &set = sets[(iCurrent + i) % GPU_TIMER_FRAMES];
+        if(set.bPending)
+            Collect(set);
+    }
+}
+
+void GpuTimer::BeginPass(GPU_PASS ePass)
+{
+    if(!bAvailable)
+        return;
+
+    glQueryCounter(sets[iCurrent].queries[ePass * 2], GL_TIMESTAMP);
+}
+
+void GpuTimer::EndPass(GPU_PASS ePass)
+{
+    if(!bAvailable)
+        return;
+
+    glQueryCounter(sets[iCurrent].queries[ePass * 2 + 1], GL_TIMESTAMP);
+    sets[iCurrent].bIssued[ePass] = true;
+}
@@ -0,0 +1,77 @@
+// GpuTimer.h
+// GPU time per render pass from GL_TIMESTAMP queries.
+//
+// Every pass gets a timestamp at its start and end. Query sets rotate over
+// GPU_TIMER_FRAMES frames and results are only read once the GPU reports them
+// available, so timing never makes the CPU wait for the GPU. The numbers shown
+// are therefore a frame or two old.
+
+#ifndef __SOLAR_GPU_TIMER
+#define __SOLAR_GPU_TIMER
+
+#include <GLTools.h>
+
+// GPU_PASS_INDIRECT is IndirectBatch's single draw, the Sun and planets
+// together; a frame has either it or those two.
+enum GPU_PASS { GPU_PASS_SKYBOX = 0, GPU_PASS_SUN, GPU_PASS_PLANETS, GPU_PASS_INDIRECT, GPU_PASS_ORBITS, GPU_PASS_OVERLAY, GPU_PASS_LAST };
+
+#define GPU_TIMER_FRAMES    3       // Query sets in flight
+
+class GpuTimer
+    {
+    public:
+        GpuTimer(void);
+
+        // Needs a current context. Returns false (and times nothing) without timer queries.
+        bool Init(void);
+        void Shutdown(void);
+        bool IsAvailable(void) const { return bAvailable; }
+
+        // Collects whatever older frames have finished, then starts this one
+        void BeginFrame(void);
+        void EndFrame(void);
+
+        // Waits for every frame still in flight. Only for the end of a run.
+        void CollectAll(void);
+
+        void BeginPass(GPU_PASS ePass);
+        void EndPass(GPU_PASS ePass);
+
+        // Latest finished results, in milliseconds. A pass that was not drawn reads 0
+        // and is not timed, so it is left out of what is shown rather than shown as 0.
+        double GetPassMilliseconds(GPU_PASS ePass) const { return dPassMilliseconds[ePass]; }
+        bool IsPassTimed(GPU_PASS ePass) const { return bPassTimed[ePass]; }
+        double GetFrameMilliseconds(void) const { return dFrameMilliseconds; }
+
+        // Sums over every frame collected since the last ResetTotals(), for averages
+        void ResetTotals(void);
+        int GetCollectedFrames(void) const { return nCollected; }
+        double GetPassTotal(GPU_PASS ePass) const { return dPassTotals[ePass]; }
+        int GetPassFrames(GPU_PASS ePass) const { return nPassFrames[ePass]; }     // Collected frames that drew it
+        double GetFrameTotal(void) const { return dFrameTotal; }
+
+        static const char *GetPassName(GPU_PASS ePass);
+
+    protected:
+        struct QuerySet
+            {
+            GLuint      queries[GPU_PASS_LAST * 2 + 2];     // Begin/end per pass, then the whole frame
+            bool        bIssued[GPU_PASS_LAST];
+            bool        bPending;
+            };
+
+        void Collect(QuerySet &set);
+
+        bool        bAvailable;
+        QuerySet    sets[GPU_TIMER_FRAMES];
+        int         iCurrent;
+        double      dPassMilliseconds[GPU_PASS_LAST];
+        bool        bPassTimed[GPU_PASS_LAST];
+        double      dFrameMilliseconds;
+        double      dPassTotals[GPU_PASS_LAST];
+        int         nPassFrames[GPU_PASS_LAST];
+        double      dFrameTotal;
+        int         nCollected;
+    };
+
+#endif
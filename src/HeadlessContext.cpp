@@ -0,0 +1,144 @@
+// HeadlessContext.cpp
+// An OpenGL context with no window, for benchmarks and render servers.
+
+#include "HeadlessContext.h"
+
+#include <EGL/eglext.h>
+#include <stdio.h>
+#include <string.h>
+
+HeadlessContext::HeadlessContext(void) : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT), surface(EGL_NO_SURFACE),
+                                         framebuffer(0), nWidth(0), nHeight(0)
+{
+    renderbuffers[0] = renderbuffers[1] = 0;
+}
+
+static bool HasExtension(const char *szExtensions, const char *szName)
+{
+    size_t nLength = strlen(szName);
+    for(const char *p = szExtensions; p != NULL && (p = strstr(p, szName)) != NULL; p += nLength)
+        if((p == szExtensions || p[-1] == ' ') && (p[nLength] == ' ' || p[nLength] == '\0'))
+            return true;
+    return false;
+}
+
+bool HeadlessContext::Create(int nNewWidth, int nNewHeight)
+{
+    nWidth = nNewWidth;
+    nHeight = nNewHeight;
+
+    // Surfaceless platform first: it needs neither X nor a GPU device node
+    const char *szClientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay != NULL && HasExtension(szClientExtensions, "EGL_MESA_platform_surfaceless"))
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if(display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        fprintf(stderr, "Headless: no EGL display\n");
+        return false;
+    }
+
+    if(!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "Headless: EGL has no desktop OpenGL\n");
+        Destroy();
+        return false;
+    }
+
+    bool bSurfaceless = HasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+    // The framebuffer object carries color and depth, the config only has to render
+    EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                               EGL_SURFACE_TYPE, bSurfaceless ? 0 : EGL_PBUFFER_BIT,
+                               EGL_NONE };
+    EGLConfig config;
+    EGLint nConfigs = 0;
+    if(!eglChooseConfig(display, configAttribs, &config, 1, &nConfigs) || nConfigs < 1) {
+        fprintf(stderr, "Headless: no EGL config for OpenGL\n");
+        Destroy();
+        return false;
+    }
+
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if(context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "Headless: cannot create an OpenGL context\n");
+        Destroy();
+        return false;
+    }
+
+    if(!bSurfaceless) {
+        EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    }
+
+    if(!eglMakeCurrent(display, surface, surface, context)) {
+        fprintf(stderr, "Headless: cannot make the context current\n");
+        Destroy();
+        return false;
+    }
+
+    // glewInit() would also load GLX, and there is no GLX here
+    GLenum err = glewContextInit();
+    if(err != GLEW_OK) {
+        fprintf(stderr, "GLEW Error: %s\n", glewGetErrorString(err));
+        Destroy();
+        return false;
+    }
+
+    if(!GLEW_VERSION_3_0 && !GLEW_ARB_framebuffer_object) {
+        fprintf(stderr, "Headless: no framebuffer objects\n");
+        Destroy();
+        return false;
+    }
+
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, nWidth, nHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, nWidth, nHeight);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Headless: %d x %d framebuffer is incomplete\n", nWidth, nHeight);
+        Destroy();
+        return false;
+    }
+
+    glViewport(0, 0, nWidth, nHeight);
+    return true;
+}
+
+void HeadlessContext::Destroy(void)
+{
+    if(display == EGL_NO_DISPLAY)
+        return;
+
+    if(framebuffer != 0) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(2, renderbuffers);
+        framebuffer = 0;
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(surface != EGL_NO_SURFACE)
+        eglDestroySurface(display, surface);
+    if(context != EGL_NO_CONTEXT)
+        eglDestroyContext(display, context);
+    eglTerminate(display);
+
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+    surface = EGL_NO_SURFACE;
+}
+
+bool HeadlessContext::SaveImage(const char *szFileName)
+{
+    return gltGrabScreenTGA(szFileName) != 0;
+}
@@ -0,0 +1,45 @@
+// HeadlessContext.h
+// An OpenGL context with no window, for benchmarks and render servers.
+//
+// The context comes from EGL: the Mesa surfaceless platform when there is one
+// (no X server needed at all), otherwise the default display. It renders into
+// a framebuffer object of the requested size, so nothing ever reaches a
+// screen. Works with Mesa's llvmpipe software rasterizer.
+
+#ifndef __SOLAR_HEADLESS_CONTEXT
+#define __SOLAR_HEADLESS_CONTEXT
+
+#include <GLTools.h>
+#include <EGL/egl.h>
+
+class HeadlessContext
+    {
+    public:
+        HeadlessContext(void);
+        ~HeadlessContext(void) { Destroy(); }
+
+        // Makes a context current, initializes GLEW and binds a nWidth x nHeight
+        // framebuffer. Prints the reason and returns false on failure.
+        bool Create(int nWidth, int nHeight);
+        void Destroy(void);
+
+        int GetWidth(void) const { return nWidth; }
+        int GetHeight(void) const { return nHeight; }
+
+        // Stand-in for the swap: hands the frame to the GPU without waiting
+        void SwapBuffers(void) { glFlush(); }
+
+        // Write the framebuffer to a Targa file
+        bool SaveImage(const char *szFileName);
+
+    protected:
+        EGLDisplay  display;
+        EGLContext  context;
+        EGLSurface  surface;        // 1x1 pbuffer, only without surfaceless contexts
+        GLuint      framebuffer;
+        GLuint      renderbuffers[2];
+        int         nWidth;
+        int         nHeight;
+    };
+
+#endif
@@ -0,0 +1,158 @@
+// ImpostorBatch.cpp
+// Bodies too small on screen for a mesh to be worth it, drawn as point
+// sprites.
+
+#include "ImpostorBatch.h"
+
+#include <GLShaderManager.h>
+#include <GLProfiler.h>
+
+#include <string.h>
+
+bool ImpostorBatch::Init(void)
+{
+    shader = gltLoadShaderPairWithAttributes("src/ImpostorShader.vp", "src/ImpostorShader.fp", 2,
+                                             GLT_ATTRIBUTE_VERTEX, "vCenter", GLT_ATTRIBUTE_COLOR, "vColor");
+    if(shader == 0)
+        return false;
+
+    locProjection = glGetUniformLocation(shader, "pMatrix");
+    locPixelScale = glGetUniformLocation(shader, "fPixelScale");
+    locLight = glGetUniformLocation(shader, "vLightPosition");
+    locObserverLight = glGetUniformLocation(shader, "bObserverLight");
+
+    glGenVertexArrays(1, &vertexArray);
+    vertices.reserve(64 * 8);
+    return stream.Init(sizeof(float) * vertices.capacity());
+}
+
+void ImpostorBatch::Shutdown(void)
+{
+    if(shader != 0)
+        glDeleteProgram(shader);
+    if(vertexArray != 0)
+        glDeleteVertexArrays(1, &vertexArray);
+    shader = vertexArray = 0;
+    stream.Shutdown();
+}
+
+void ImpostorBatch::Add(const M3DVector3f vEyeCenter, float fRadius, const M3DVector3f vColor, bool bLit)
+{
+    vertices.push_back(vEyeCenter[0]);
+    vertices.push_back(vEyeCenter[1]);
+    vertices.push_back(vEyeCenter[2]);
+    vertices.push_back(fRadius);
+    vertices.push_back(vColor[0]);
+    vertices.push_back(vColor[1]);
+    vertices.push_back(vColor[2]);
+    vertices.push_back(bLit ? 1.0f : 0.0f);
+}
+
+void ImpostorBatch::Draw(const M3DMatrix44f mProjection, float fPixelScale, const M3DVector3f vLight, bool bObserverLight)
+{
+    GLT_PROFILE_FUNCTION();
+
+    int nBodies = GetCount();
+    if(nBodies == 0 || shader == 0)
+        return;
+
+    // Into this frame's part of the stream, growing it between frames when
+    // it is too small
+    GLsizeiptr nSize = sizeof(float) * vertices.size();
+    if(nSize > stream.GetFrameSize() && !stream.Init(nSize * 2))
+        return;
+    GLintptr nOffset = 0;
+    stream.BeginFrame();
+    memcpy(stream.Allocate(nSize, nOffset), &vertices[0], nSize);
+    stream.Flush();
+
+    BeginDraw(mProjection, fPixelScale, vLight, bObserverLight);
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.GetBuffer());
+    SetVertexFormat(nOffset);
+    glDrawArrays(GL_POINTS, 0, nBodies);
+    glBindVertexArray(0);
+    gltCountDraw(GL_POINTS, nBodies);
+    EndDraw();
+    stream.EndFrame();
+}
+
+void ImpostorBatch::DrawIndirect(GLuint externalArray, GLintptr nCommand, const M3DMatrix44f mProjection, float fPixelScale,
+                                 const M3DVector3f vLight, bool bObserverLight)
+{
+    GLT_PROFILE_FUNCTION();
+
+    if(shader == 0)
+        return;
+
+    BeginDraw(mProjection, fPixelScale, vLight, bObserverLight);
+    glBindVertexArray(externalArray);
+    glDrawArraysIndirect(GL_POINTS, (const GLvoid *)nCommand);
+    glBindVertexArray(0);
+    gltCountDraw(GL_POINTS, 0);
+    EndDraw();
+}
+
+void ImpostorBatch::SetVertexFormat(GLintptr nOffset)
+{
+    glEnableVertexAttribArray(GLT_ATTRIBUTE_VERTEX);
+    glVertexAttribPointer(GLT_ATTRIBUTE_VERTEX, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (const GLvoid *)nOffset);
+    glEnableVertexAttribArray(GLT_ATTRIBUTE_COLOR);
+    glVertexAttribPointer(GLT_ATTRIBUTE_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (const GLvoid *)(nOffset + sizeof(float) * 4));
+}
+
+void ImpostorBatch::BeginDraw(const M3DMatrix44f mProjection, float fPixelScale, const M3DVector3f vLight, bool bObserverLight)
+{
+    glUseProgram(shader);
+    glUniformMatrix4fv(locProjection, 1, GL_FALSE, mProjection);
+    glUniform1f(locPixelScale, fPixelScale);
+    glUniform3fv(locLight, 1, vLight);
+    glUniform1i(locObserverLight, bObserverLight);
+    gltCountStateChange();
+
+    // Compatibility contexts only feed gl_PointCoord with point sprites on
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnable(GL_POINT_SPRITE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void ImpostorBatch::EndDraw(void)
+{
+    glDisable(GL_BLEND);
+    glDisable(GL_POINT_SPRITE);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
+
+void GetAverageTextureColor(GLuint texture, M3DVector3f vColor)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // The smallest level there is: 1 x 1 when mipmapped, else the image itself
+    GLint nMaxLevel = 0, nWidth = 0, nHeight = 0;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &nMaxLevel);
+    int iLevel = 0;
+    for(int i = 1; i <= nMaxLevel && i < 16; i++) {
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_WIDTH, &nWidth);
+        if(nWidth == 0)
+            break;
+        iLevel = i;
+    }
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, iLevel, GL_TEXTURE_WIDTH, &nWidth);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, iLevel, GL_TEXTURE_HEIGHT, &nHeight);
+
+    m3dLoadVector3(vColor, 0.5f, 0.5f, 0.5f);
+    if(nWidth <= 0 || nHeight <= 0)
+        return;
+
+    std::vector<float> pixels(size_t(nWidth) * nHeight * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, iLevel, GL_RGB, GL_FLOAT, &pixels[0]);
+
+    double dSum[3] = { 0.0, 0.0, 0.0 };
+    for(size_t i = 0; i < pixels.size(); i += 3)
+        for(int j = 0; j < 3; j++)
+            dSum[j] += pixels[i + j];
+    for(int j = 0; j < 3; j++)
+        vColor[j] = float(dSum[j] / double(size_t(nWidth) * nHeight));
+}
@@ -0,0 +1,75 @@
+// ImpostorBatch.h
+// Bodies too small on screen for a mesh to be worth it, drawn as point
+// sprites.
+//
+// Add() queues a body with its eye space center, radius and average color;
+// Draw() sends every one queued since Begin() in a single draw call. The
+// fragment shader turns each sprite into a lit disc, the normal worked out
+// from where in the sprite the pixel is, so a body a couple of pixels
+// across shades like the mesh it replaces without its vertices. Bodies under
+// a pixel fade out by coverage rather than flickering between pixels.
+// The vertices go up through a StreamBuffer, without waiting on the GPU.
+
+#ifndef __SOLAR_IMPOSTOR_BATCH
+#define __SOLAR_IMPOSTOR_BATCH
+
+#include <GLTools.h>
+
+#include <vector>
+
+#include "StreamBuffer.h"
+
+#define IMPOSTOR_MAX_PIXELS     3.0f    // Radius on screen below which a body is drawn as an impostor
+
+class ImpostorBatch
+    {
+    public:
+        ImpostorBatch(void) : shader(0), vertexArray(0) {}
+
+        // Needs a current context
+        bool Init(void);
+        void Shutdown(void);
+
+        void Begin(void) { vertices.clear(); }
+
+        // vEyeCenter and fRadius place the body, vColor its average surface
+        // color. Unlit bodies (the Sun) keep their color on the dark side.
+        void Add(const M3DVector3f vEyeCenter, float fRadius, const M3DVector3f vColor, bool bLit);
+
+        int GetCount(void) const { return int(vertices.size() / 8); }
+
+        // Everything added since Begin(), in one draw. vLight is in eye space.
+        void Draw(const M3DMatrix44f mProjection, float fPixelScale, const M3DVector3f vLight, bool bObserverLight);
+
+        // Impostors a shader wrote into a buffer instead, laid out as Add()
+        // does and bound to vertexArray with SetVertexFormat(). Their count
+        // comes from the DrawArraysIndirectCommand at nCommand in the bound
+        // GL_DRAW_INDIRECT_BUFFER.
+        void DrawIndirect(GLuint externalArray, GLintptr nCommand, const M3DMatrix44f mProjection, float fPixelScale,
+                          const M3DVector3f vLight, bool bObserverLight);
+
+        // Point the bound vertex array at impostors starting nOffset bytes
+        // into the bound GL_ARRAY_BUFFER
+        static void SetVertexFormat(GLintptr nOffset);
+
+    protected:
+        void BeginDraw(const M3DMatrix44f mProjection, float fPixelScale, const M3DVector3f vLight, bool bObserverLight);
+        void EndDraw(void);
+
+        GLuint              shader;
+        GLint               locProjection;
+        GLint               locPixelScale;
+        GLint               locLight;
+        GLint               locObserverLight;
+
+        GLuint              vertexArray;
+        StreamBuffer        stream;
+
+        std::vector<float>  vertices;       // Center and radius, then color and lit, per body
+    };
+
+// Average color of the top mip level of a 2D texture. For impostors, whose
+// bodies are too small to show any detail.
+void GetAverageTextureColor(GLuint texture, M3DVector3f vColor);
+
+#endif
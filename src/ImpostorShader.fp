@@ -0,0 +1,40 @@
+#version 330
+
+// A sphere lit like SolarShader, worked out per pixel of a point sprite
+
+uniform vec3	vLightPosition;
+uniform bool	bObserverLight;
+
+flat in vec3 vBodyCenter;
+flat in vec4 vBodyColor;
+flat in float fCoverage;
+flat in float fSize;
+
+// Output fragment color
+out vec4 vFragColor;
+
+void main(void)
+{ 
+    // Sprite coordinates to a unit disc, y up
+    vec2 vDisc = gl_PointCoord * 2.0 - 1.0;
+    vDisc.y = -vDisc.y;
+    float fDistance2 = dot(vDisc, vDisc);
+
+    // Soft edge, about a pixel wide, instead of a jagged one. A single pixel
+    // sprite is all edge and keeps just its coverage.
+    float fEdge = fSize > 1.0 ? clamp((1.0 - sqrt(fDistance2)) * fSize * 0.5 + 0.5, 0.0, 1.0) : 1.0;
+    if(fEdge <= 0.0)
+        discard;
+
+    // The normal of the sphere under this pixel, facing the viewer. Sprites
+    // this small are as good as facing straight down -Z.
+    vec3 vNormal = vec3(vDisc, sqrt(max(1.0 - fDistance2, 0.0)));
+
+    vec3 vLight = bObserverLight ? vec3(0.0, 0.0, 0.0) : vLightPosition;
+    float fIntensity = 1.0;
+    if(vBodyColor.a > 0.5)
+        fIntensity = max(0.0, dot(vNormal, normalize(vLight - vBodyCenter)));
+
+	vFragColor.rgb = vBodyColor.rgb * fIntensity;
+	vFragColor.a = fCoverage * fEdge;
+}
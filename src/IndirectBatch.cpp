@@ -0,0 +1,427 @@
+// IndirectBatch.cpp
+// The Sun, bodies and rings culled, sized and submitted by the GPU.
+
+#include "IndirectBatch.h"
+#include "SphereLod.h"
+
+#include <GLShaderManager.h>
+#include <GLProfiler.h>
+#include <GL/glu.h>
+
+#include <math.h>
+#include <string.h>
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER                0x90D2
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT   0x90DF
+#endif
+#ifndef GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS
+#define GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS     0x90D6
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT      0x00000001
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT                  0x00000040
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT           0x00002000
+#endif
+
+typedef void (GLAPIENTRY *PFNDISPATCHCOMPUTE)(GLuint nGroupsX, GLuint nGroupsY, GLuint nGroupsZ);
+typedef void (GLAPIENTRY *PFNMULTIDRAWELEMENTSINDIRECT)(GLenum eMode, GLenum eType, const GLvoid *pIndirect, GLsizei nDraws, GLsizei nStride);
+typedef void (GLAPIENTRY *PFNMEMORYBARRIER)(GLbitfield nBarriers);
+
+static PFNDISPATCHCOMPUTE              pDispatchCompute = NULL;
+static PFNMULTIDRAWELEMENTSINDIRECT    pMultiDrawElementsIndirect = NULL;
+static PFNMEMORYBARRIER                pMemoryBarrier = NULL;
+
+// DrawElementsIndirectCommand, as the cull shader writes them
+struct IndirectCommand
+    {
+    GLuint      nCount;
+    GLuint      nInstances;
+    GLuint      nFirstIndex;
+    GLint       nBaseVertex;
+    GLuint      nBaseInstance;
+    };
+
+// Per object, written by the cull shader for the draw: modelview, then
+// scale, texture layer and kind
+#define INDIRECT_DRAW_SIZE      (sizeof(float) * 20)
+
+// Impostors: a DrawArraysIndirectCommand, then the vertices as ImpostorBatch lays them out
+#define INDIRECT_IMPOSTOR_HEADER    (sizeof(GLuint) * 4)
+
+bool IndirectBatch::IsSupported(void)
+{
+    GLint nMajor = 0, nMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &nMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &nMinor);
+    if(nMajor < 4 || (nMajor == 4 && nMinor < 3))
+        return false;
+
+    pDispatchCompute = (PFNDISPATCHCOMPUTE)gltGetProcAddress("glDispatchCompute");
+    pMultiDrawElementsIndirect = (PFNMULTIDRAWELEMENTSINDIRECT)gltGetProcAddress("glMultiDrawElementsIndirect");
+    pMemoryBarrier = (PFNMEMORYBARRIER)gltGetProcAddress("glMemoryBarrier");
+    if(pDispatchCompute == NULL || pMultiDrawElementsIndirect == NULL || pMemoryBarrier == NULL)
+        return false;
+
+    // The vertex shader reads what the cull shader wrote from a storage buffer
+    GLint nBlocks = 0;
+    glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &nBlocks);
+    return nBlocks > 0;
+}
+
+IndirectBatch::IndirectBatch(void) : cullShader(0), drawShader(0), vertexArray(0), impostorArray(0),
+                                     textures(0), nStorageAlignment(16), bTableDirty(true)
+{
+    memset(buffers, 0, sizeof(buffers));
+}
+
+bool IndirectBatch::Init(void)
+{
+    if(!IsSupported())
+        return false;
+
+    cullShader = gltLoadComputeShader("src/IndirectCullShader.cp");
+    drawShader = gltLoadShaderPairWithAttributes("src/IndirectShader.vp", "src/IndirectShader.fp", 4,
+                                                 GLT_ATTRIBUTE_VERTEX, "vVertex", GLT_ATTRIBUTE_NORMAL, "vNormal",
+                                                 GLT_ATTRIBUTE_TEXTURE0, "vTexCoords", GLT_ATTRIBUTE_TEXTURE1, "iObject");
+    if(cullShader == 0 || drawShader == 0) {
+        Shutdown();
+        return false;
+    }
+
+    locCullView = glGetUniformLocation(cullShader, "mView");
+    locCullPlanes = glGetUniformLocation(cullShader, "vPlanes");
+    locCullPixelScale = glGetUniformLocation(cullShader, "fPixelScale");
+    locCullImpostorPixels = glGetUniformLocation(cullShader, "fImpostorPixels");
+    locCullEnabled = glGetUniformLocation(cullShader, "bCull");
+    locCullCount = glGetUniformLocation(cullShader, "nObjects");
+    locCullLevelErrors = glGetUniformLocation(cullShader, "fLevelErrors");
+    locCullLodLimits = glGetUniformLocation(cullShader, "vLodLimits");
+
+    locProjection = glGetUniformLocation(drawShader, "pMatrix");
+    locLight = glGetUniformLocation(drawShader, "vLightPosition");
+    locObserverLight = glGetUniformLocation(drawShader, "bObserverLight");
+    glUseProgram(drawShader);
+    glUniform1i(glGetUniformLocation(drawShader, "colorMaps"), 0);
+
+    // The sphere LOD levels come first, so a level is also its mesh
+    vertices.clear();
+    indexes.clear();
+    meshes.clear();
+    for(int i = 0; i < SPHERE_LOD_LEVELS; i++)
+        MakeSphere(SphereLod::GetSlices(i), SphereLod::GetSlices(i) / 2);
+
+    glGenBuffers(BUFFER_COUNT, buffers);
+    glGenVertexArrays(1, &vertexArray);
+    glGenVertexArrays(1, &impostorArray);
+
+    // The per-instance attribute baseInstance offsets into is just 0, 1, 2...
+    GLuint nIds[INDIRECT_MAX_OBJECTS];
+    for(GLuint i = 0; i < INDIRECT_MAX_OBJECTS; i++)
+        nIds[i] = i;
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[OBJECT_IDS]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(nIds), nIds, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(GLT_ATTRIBUTE_TEXTURE1);
+    glVertexAttribIPointer(GLT_ATTRIBUTE_TEXTURE1, 1, GL_UNSIGNED_INT, 0, 0);
+    glVertexAttribDivisor(GLT_ATTRIBUTE_TEXTURE1, 1);
+    glBindVertexArray(0);
+
+    glBindVertexArray(impostorArray);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[IMPOSTORS]);
+    ImpostorBatch::SetVertexFormat(INDIRECT_IMPOSTOR_HEADER);
+    glBindVertexArray(0);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[IMPOSTORS]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, INDIRECT_IMPOSTOR_HEADER + sizeof(float) * 8 * INDIRECT_MAX_OBJECTS, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[COMMANDS]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(IndirectCommand) * INDIRECT_MAX_OBJECTS, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[DRAWS]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, INDIRECT_DRAW_SIZE * INDIRECT_MAX_OBJECTS, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &nStorageAlignment);
+
+    objects.clear();
+    bTableDirty = true;
+    return true;
+}
+
+void IndirectBatch::Shutdown(void)
+{
+    if(cullShader != 0)
+        glDeleteProgram(cullShader);
+    if(drawShader != 0)
+        glDeleteProgram(drawShader);
+    if(buffers[0] != 0)
+        glDeleteBuffers(BUFFER_COUNT, buffers);
+    if(vertexArray != 0)
+        glDeleteVertexArrays(1, &vertexArray);
+    if(impostorArray != 0)
+        glDeleteVertexArrays(1, &impostorArray);
+    cullShader = drawShader = vertexArray = impostorArray = 0;
+    memset(buffers, 0, sizeof(buffers));
+    nodeStream.Shutdown();
+}
+
+int IndirectBatch::AddMesh(const std::vector<float> &meshVertices, const std::vector<GLushort> &meshIndexes)
+{
+    Mesh mesh;
+    mesh.nCount = GLint(meshIndexes.size());
+    mesh.nFirstIndex = GLint(indexes.size());
+    mesh.nBaseVertex = GLint(vertices.size() / 8);
+    mesh.nPad = 0;
+    meshes.push_back(mesh);
+
+    vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+    indexes.insert(indexes.end(), meshIndexes.begin(), meshIndexes.end());
+    bTableDirty = true;
+    return int(meshes.size()) - 1;
+}
+
+// A grid of (nRows + 1) x (nColumns + 1) vertices, two triangles a cell, wound
+// the way gltMakeSphere() and gltMakeDisk() wind theirs
+static void MakeGridIndexes(std::vector<GLushort> &gridIndexes, int nRows, int nColumns)
+{
+    for(int i = 0; i < nRows; i++)
+        for(int j = 0; j < nColumns; j++) {
+            GLushort a = GLushort(i * (nColumns + 1) + j);
+            GLushort b = GLushort(a + nColumns + 1);
+            GLushort indexes[6] = { a, b, GLushort(a + 1), b, GLushort(b + 1), GLushort(a + 1) };
+            gridIndexes.insert(gridIndexes.end(), indexes, indexes + 6);
+        }
+}
+
+// A unit sphere, the same mesh a SphereLod level is
+void IndirectBatch::MakeSphere(int nSlices, int nStacks)
+{
+    std::vector<float> sphereVertices;
+    std::vector<GLushort> sphereIndexes;
+    SphereLod::MakeMesh(1.0f, nSlices, nStacks, sphereVertices, sphereIndexes);
+    AddMesh(sphereVertices, sphereIndexes);
+}
+
+// gltMakeDisk()'s ring, at its real size
+void IndirectBatch::MakeRing(float fInnerRadius, float fOuterRadius, int nSlices, int nStacks)
+{
+    std::vector<float> ringVertices;
+    std::vector<GLushort> ringIndexes;
+
+    float fStep = (fOuterRadius - fInnerRadius) / float(nStacks);
+    float fSlice = 2.0f * float(M3D_PI) / float(nSlices);
+    for(int i = 0; i <= nStacks; i++) {
+        float fRadius = fInnerRadius + float(i) * fStep;
+        for(int j = 0; j <= nSlices; j++) {
+            float theta = (j == nSlices) ? 0.0f : float(j) * fSlice;
+            float x = cosf(theta) * fRadius;
+            float y = sinf(theta) * fRadius;
+            float vVertex[8] = { x, y, 0.0f, 0.0f, 0.0f, 1.0f,
+                                 (x / fOuterRadius + 1.0f) * 0.5f, (y / fOuterRadius + 1.0f) * 0.5f };
+            ringVertices.insert(ringVertices.end(), vVertex, vVertex + 8);
+        }
+    }
+    MakeGridIndexes(ringIndexes, nStacks, nSlices);
+    AddMesh(ringVertices, ringIndexes);
+}
+
+int IndirectBatch::AddSphere(int iNode, float fRadius, float fBound, int iLayer, const M3DVector3f vColor, bool bLit)
+{
+    if(objects.size() >= INDIRECT_MAX_OBJECTS)
+        return -1;
+
+    Object object;
+    object.vColor[0] = vColor[0];
+    object.vColor[1] = vColor[1];
+    object.vColor[2] = vColor[2];
+    object.vColor[3] = bLit ? 1.0f : 0.0f;
+    object.vInfo[0] = iNode;
+    object.vInfo[1] = iLayer;
+    object.vInfo[2] = bLit ? INDIRECT_SPHERE : INDIRECT_UNLIT;
+    object.vInfo[3] = 0;
+    object.vSize[0] = fRadius;
+    object.vSize[1] = fBound;
+    object.vSize[2] = object.vSize[3] = 0.0f;
+    objects.push_back(object);
+
+    bTableDirty = true;
+    return int(objects.size()) - 1;
+}
+
+int IndirectBatch::AddRing(int iNode, float fInnerRadius, float fOuterRadius, float fBound, int iLayer)
+{
+    if(objects.size() >= INDIRECT_MAX_OBJECTS)
+        return -1;
+
+    Object object;
+    memset(&object, 0, sizeof(object));
+    object.vInfo[0] = iNode;
+    object.vInfo[1] = iLayer;
+    object.vInfo[2] = INDIRECT_RING;
+    object.vInfo[3] = int(meshes.size());
+    object.vSize[0] = 1.0f;         // Built at its real size
+    object.vSize[1] = fBound;
+    objects.push_back(object);
+
+    MakeRing(fInnerRadius, fOuterRadius, 30, 15);
+    return int(objects.size()) - 1;
+}
+
+void IndirectBatch::UploadTable(void)
+{
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[VERTICES]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+    glEnableVertexAttribArray(GLT_ATTRIBUTE_VERTEX);
+    glVertexAttribPointer(GLT_ATTRIBUTE_VERTEX, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, 0);
+    glEnableVertexAttribArray(GLT_ATTRIBUTE_NORMAL);
+    glVertexAttribPointer(GLT_ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (const GLvoid *)(sizeof(float) * 3));
+    glEnableVertexAttribArray(GLT_ATTRIBUTE_TEXTURE0);
+    glVertexAttribPointer(GLT_ATTRIBUTE_TEXTURE0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (const GLvoid *)(sizeof(float) * 6));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[INDEXES]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indexes.size(), &indexes[0], GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[OBJECTS]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Object) * objects.size(), &objects[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[MESHES]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Mesh) * meshes.size(), &meshes[0], GL_STATIC_DRAW);
+
+    // Every object starts in the middle, as a SphereLod does
+    std::vector<GLint> levels(objects.size(), SPHERE_LOD_LEVELS / 2);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[LEVELS]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLint) * levels.size(), &levels[0], GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    bTableDirty = false;
+}
+
+void IndirectBatch::Draw(const M3DMatrix44f *pWorldMatrices, int nNodes, const M3DMatrix44f mView,
+                         GLFrustum &eyeFrustum, const M3DMatrix44f mProjection, float fPixelScale,
+                         const M3DVector3f vLight, bool bObserverLight, bool bCull, bool bImpostors,
+                         ImpostorBatch &impostors)
+{
+    GLT_PROFILE_FUNCTION();
+
+    if(cullShader == 0 || objects.empty())
+        return;
+    if(bTableDirty)
+        UploadTable();
+
+    // The only per-frame upload: the world matrices, written straight into
+    // a region of the stream the GPU is done with
+    GLsizeiptr nNodeSize = sizeof(M3DMatrix44f) * nNodes;
+    if(nNodeSize + nStorageAlignment > nodeStream.GetFrameSize() && !nodeStream.Init(nNodeSize + nStorageAlignment))
+        return;
+    GLintptr nNodeOffset = 0;
+    nodeStream.BeginFrame();
+    memcpy(nodeStream.Allocate(nNodeSize, nNodeOffset, nStorageAlignment), pWorldMatrices, nNodeSize);
+    nodeStream.Flush();
+
+    static const GLuint nImpostorReset[4] = { 0, 1, 0, 0 };     // No vertices, one instance
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[IMPOSTORS]);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(nImpostorReset), nImpostorReset);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Cull, pick levels and write the commands
+    M3DVector4f vPlanes[6];
+    eyeFrustum.GetPlanes(vPlanes);
+    float fLevelErrors[SPHERE_LOD_LEVELS];
+    for(int i = 0; i < SPHERE_LOD_LEVELS; i++)
+        fLevelErrors[i] = SphereLod::GetError(i, 1.0f);
+
+    glUseProgram(cullShader);
+    glUniformMatrix4fv(locCullView, 1, GL_FALSE, mView);
+    glUniform4fv(locCullPlanes, 6, vPlanes[0]);
+    glUniform1f(locCullPixelScale, fPixelScale);
+    glUniform1f(locCullImpostorPixels, bImpostors ? IMPOSTOR_MAX_PIXELS : 0.0f);
+    glUniform1i(locCullEnabled, bCull);
+    glUniform1i(locCullCount, GetObjectCount());
+    glUniform1fv(locCullLevelErrors, SPHERE_LOD_LEVELS, fLevelErrors);
+    glUniform3f(locCullLodLimits, float(SPHERE_LOD_LEVELS), SPHERE_LOD_MAX_ERROR, SPHERE_LOD_HYSTERESIS);
+    gltCountStateChange();
+
+    // Binding 1, the nodes, is this frame's range of the stream
+    static const int iBindings[] = { OBJECTS, -1, MESHES, LEVELS, COMMANDS, DRAWS, IMPOSTORS };
+    for(int i = 0; i < int(sizeof(iBindings) / sizeof(iBindings[0])); i++) {
+        if(iBindings[i] >= 0)
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, buffers[iBindings[i]]);
+    }
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, nodeStream.GetBuffer(), nNodeOffset, nNodeSize);
+
+    pDispatchCompute((GetObjectCount() + INDIRECT_GROUP_SIZE - 1) / INDIRECT_GROUP_SIZE, 1, 1);
+    nodeStream.EndFrame();
+    pMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    // Everything in one call
+    glUseProgram(drawShader);
+    glUniformMatrix4fv(locProjection, 1, GL_FALSE, mProjection);
+    glUniform3fv(locLight, 1, vLight);
+    glUniform1i(locObserverLight, bObserverLight);
+    gltCountStateChange();
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textures);
+
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers[COMMANDS]);
+    pMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, 0, GetObjectCount(), 0);
+    glBindVertexArray(0);
+    gltCountDraw(GL_TRIANGLES, 0);      // How many is the GPU's business
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // And the impostors the cull shader appended
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers[IMPOSTORS]);
+    impostors.DrawIndirect(impostorArray, 0, mProjection, fPixelScale, vLight, bObserverLight);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+GLuint MakeTextureArray(const GLuint *pTextures, int nCount)
+{
+    GLint nWidth = 0, nHeight = 0;
+    glBindTexture(GL_TEXTURE_2D, pTextures[0]);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &nWidth);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &nHeight);
+    if(nWidth <= 0 || nHeight <= 0)
+        return 0;
+
+    // Already compressed once on the way in, so kept as they come out
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, nWidth, nHeight, nCount, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+    std::vector<GLubyte> pixels(size_t(nWidth) * nHeight * 3);
+    std::vector<GLubyte> original;
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for(int i = 0; i < nCount; i++) {
+        GLint nLayerWidth = 0, nLayerHeight = 0;
+        glBindTexture(GL_TEXTURE_2D, pTextures[i]);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &nLayerWidth);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &nLayerHeight);
+        if(nLayerWidth == nWidth && nLayerHeight == nHeight)
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+        else {
+            original.resize(size_t(nLayerWidth) * nLayerHeight * 3);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, &original[0]);
+            gluScaleImage(GL_RGB, nLayerWidth, nLayerHeight, GL_UNSIGNED_BYTE, &original[0],
+                          nWidth, nHeight, GL_UNSIGNED_BYTE, &pixels[0]);
+        }
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, nWidth, nHeight, 1, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texture;
+}
@@ -0,0 +1,126 @@
+// IndirectBatch.h
+// The Sun, bodies and rings culled, sized and submitted by the GPU.
+//
+// Each object (a sphere or a ring, hung off a transform node) gets one slot
+// in a table kept in a shader storage buffer. Every frame the world matrices
+// are written straight into a StreamBuffer, then a compute shader runs over
+// the table: frustum test, LOD level from the size on screen (with the same
+// error limit and hysteresis as SphereLod), and bodies below
+// IMPOSTOR_MAX_PIXELS appended to an impostor list instead. It writes one DrawElementsIndirectCommand per
+// slot, a culled object's with no instances, and the lot is drawn with one
+// glMultiDrawElementsIndirect; the impostors follow with one
+// glDrawArraysIndirect. What the CPU does per frame no longer depends on what
+// is visible or how many objects there are.
+//
+// All the meshes share one vertex and index buffer, and the textures are
+// layers of one 2D array, so nothing is bound between draws. The shader
+// finds its slot through a per-instance attribute that baseInstance offsets.
+//
+// Needs GL 4.3 (compute shaders, storage buffers, multi-draw indirect); the
+// entry points are loaded here since the bundled GLEW predates them.
+
+#ifndef __SOLAR_INDIRECT_BATCH
+#define __SOLAR_INDIRECT_BATCH
+
+#include <GLTools.h>
+#include <GLFrustum.h>
+
+#include <vector>
+
+#include "ImpostorBatch.h"
+#include "StreamBuffer.h"
+
+#define INDIRECT_MAX_OBJECTS    64
+#define INDIRECT_GROUP_SIZE     64      // Compute shader local size
+
+enum INDIRECT_KIND { INDIRECT_UNLIT = 0, INDIRECT_SPHERE, INDIRECT_RING };
+
+class IndirectBatch
+    {
+    public:
+        IndirectBatch(void);
+
+        // Whether the current context can run it
+        static bool IsSupported(void);
+
+        // Needs a current context. Builds the meshes and loads the shaders.
+        bool Init(void);
+        void Shutdown(void);
+
+        // A GL_TEXTURE_2D_ARRAY, from MakeTextureArray(), that the layers
+        // given to AddSphere() and AddRing() index
+        void SetTextures(GLuint textureArray) { textures = textureArray; }
+
+        // The table, filled once after Init(). fBound covers everything drawn
+        // around the node (rings); the body is culled, or made an impostor,
+        // by it. A ring is drawn only when its node's body is. Returns the
+        // slot, or -1 when full.
+        int AddSphere(int iNode, float fRadius, float fBound, int iLayer, const M3DVector3f vColor, bool bLit);
+        int AddRing(int iNode, float fInnerRadius, float fOuterRadius, float fBound, int iLayer);
+
+        // A frame. mView takes world space to eye space, eyeFrustum is the
+        // view frustum in eye space.
+        void Draw(const M3DMatrix44f *pWorldMatrices, int nNodes, const M3DMatrix44f mView,
+                  GLFrustum &eyeFrustum, const M3DMatrix44f mProjection, float fPixelScale,
+                  const M3DVector3f vLight, bool bObserverLight, bool bCull, bool bImpostors,
+                  ImpostorBatch &impostors);
+
+        int GetObjectCount(void) const { return int(objects.size()); }
+
+    protected:
+        enum { VERTICES = 0, INDEXES, OBJECT_IDS, OBJECTS, MESHES, LEVELS, COMMANDS, DRAWS, IMPOSTORS, BUFFER_COUNT };
+
+        struct Object
+            {
+            float       vColor[4];      // Average color, and 1 when lit
+            GLint       vInfo[4];       // Node, texture layer, INDIRECT_KIND, mesh
+            float       vSize[4];       // Radius, bound
+            };
+
+        struct Mesh
+            {
+            GLint       nCount;         // Indexes
+            GLint       nFirstIndex;
+            GLint       nBaseVertex;
+            GLint       nPad;
+            };
+
+        int AddMesh(const std::vector<float> &meshVertices, const std::vector<GLushort> &meshIndexes);
+        void MakeSphere(int nSlices, int nStacks);
+        void MakeRing(float fInnerRadius, float fOuterRadius, int nSlices, int nStacks);
+        void UploadTable(void);
+
+        GLuint                  cullShader;
+        GLint                   locCullView;
+        GLint                   locCullPlanes;
+        GLint                   locCullPixelScale;
+        GLint                   locCullImpostorPixels;
+        GLint                   locCullEnabled;
+        GLint                   locCullCount;
+        GLint                   locCullLevelErrors;
+        GLint                   locCullLodLimits;
+
+        GLuint                  drawShader;
+        GLint                   locProjection;
+        GLint                   locLight;
+        GLint                   locObserverLight;
+
+        GLuint                  vertexArray;
+        GLuint                  impostorArray;
+        GLuint                  buffers[BUFFER_COUNT];
+        GLuint                  textures;
+        StreamBuffer            nodeStream;     // World matrices
+        GLint                   nStorageAlignment;
+        bool                    bTableDirty;
+
+        std::vector<float>      vertices;       // Position, normal, texture coordinates
+        std::vector<GLushort>   indexes;
+        std::vector<Mesh>       meshes;         // Sphere LOD levels, then rings
+        std::vector<Object>     objects;
+    };
+
+// Copy 2D textures into the layers of a new mipmapped GL_TEXTURE_2D_ARRAY,
+// in order. Any not the size of the first are scaled to it.
+GLuint MakeTextureArray(const GLuint *pTextures, int nCount);
+
+#endif
@@ -0,0 +1,112 @@
+#version 430
+
+// One invocation per IndirectBatch object: frustum test, LOD level or
+// impostor, then its draw command. Runs once a frame over the whole table.
+
+layout(local_size_x = 64) in;
+
+struct Object
+{
+    vec4    vColor;     // Average color, and 1 when lit
+    ivec4   vInfo;      // Node, texture layer, kind, mesh
+    vec4    vSize;      // Radius, bound
+};
+
+// DrawElementsIndirectCommand
+struct Command
+{
+    uint    nCount;
+    uint    nInstances;
+    uint    nFirstIndex;
+    int     nBaseVertex;
+    uint    nBaseInstance;
+};
+
+struct Draw
+{
+    mat4    mModelView;
+    vec4    vParams;    // Scale, texture layer, kind
+};
+
+const int KIND_RING = 2;
+
+layout(std430, binding = 0) readonly buffer Objects { Object objects[]; };
+layout(std430, binding = 1) readonly buffer Nodes { mat4 worldMatrices[]; };
+layout(std430, binding = 2) readonly buffer Meshes { ivec4 meshes[]; };     // Count, first index, base vertex
+layout(std430, binding = 3) buffer Levels { int levels[]; };
+layout(std430, binding = 4) writeonly buffer Commands { Command commands[]; };
+layout(std430, binding = 5) writeonly buffer Draws { Draw draws[]; };
+layout(std430, binding = 6) buffer Impostors
+{
+    uint    nImpostors;         // A DrawArraysIndirectCommand
+    uint    nImpostorInstances;
+    uint    nImpostorFirst;
+    uint    nImpostorBaseInstance;
+    vec4    impostors[];        // Center and radius, then color and lit
+};
+
+uniform mat4    mView;
+uniform vec4    vPlanes[6];         // Eye space
+uniform float   fPixelScale;
+uniform float   fImpostorPixels;    // 0 for no impostors
+uniform bool    bCull;
+uniform int     nObjects;
+
+// SphereLod's rules: error per pixel of radius for each level, then the
+// number of levels, the error limit and the hysteresis
+uniform float   fLevelErrors[8];
+uniform vec3    vLodLimits;
+
+void main(void)
+{
+    int i = int(gl_GlobalInvocationID.x);
+    if(i >= nObjects)
+        return;
+
+    Object object = objects[i];
+    mat4 mModelView = mView * worldMatrices[object.vInfo.x];
+    vec3 vCenter = mModelView[3].xyz;
+    float fRadius = object.vSize.x;
+    float fBound = object.vSize.y;
+
+    bool bVisible = true;
+    if(bCull)
+        for(int p = 0; p < 6; p++)
+            if(dot(vPlanes[p].xyz, vCenter) + vPlanes[p].w + fBound <= 0.0)
+                bVisible = false;
+
+    float fDistance = length(vCenter);
+    if(bVisible && fDistance > fBound && fBound * fPixelScale / fDistance < fImpostorPixels) {
+        bVisible = false;
+        if(object.vInfo.z != KIND_RING) {
+            uint n = atomicAdd(nImpostors, 1u);
+            impostors[n * 2u] = vec4(vCenter, fRadius);
+            impostors[n * 2u + 1u] = object.vColor;
+        }
+    }
+
+    // Spheres' meshes are their levels
+    int iMesh = object.vInfo.w;
+    if(object.vInfo.z != KIND_RING) {
+        iMesh = levels[i];
+        if(bVisible) {
+            float fPixels = fDistance <= fRadius ? 1e6 : fRadius * fPixelScale / fDistance;
+            int nLevels = int(vLodLimits.x);
+            while(iMesh < nLevels - 1 && fPixels * fLevelErrors[iMesh] > vLodLimits.y)
+                iMesh++;
+            while(iMesh > 0 && fPixels * fLevelErrors[iMesh - 1] < vLodLimits.y * vLodLimits.z)
+                iMesh--;
+            levels[i] = iMesh;
+        }
+    }
+
+    ivec4 mesh = meshes[iMesh];
+    commands[i].nCount = uint(mesh.x);
+    commands[i].nInstances = bVisible ? 1u : 0u;
+    commands[i].nFirstIndex = uint(mesh.y);
+    commands[i].nBaseVertex = mesh.z;
+    commands[i].nBaseInstance = uint(i);
+
+    draws[i].mModelView = mModelView;
+    draws[i].vParams = vec4(fRadius, float(object.vInfo.y), float(object.vInfo.z), 0.0);
+}
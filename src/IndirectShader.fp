@@ -0,0 +1,17 @@
+#version 430
+
+uniform sampler2DArray colorMaps;
+
+smooth in float lightIntensity;
+smooth in vec2 vVaryingTexCoords;
+flat in float fLayer;
+
+// Output fragment color
+out vec4 vFragColor;
+
+void main(void)
+{
+	vec4 vTmpColor = texture(colorMaps, vec3(vVaryingTexCoords.st, fLayer));
+	vFragColor.rgb = vTmpColor.rgb * lightIntensity;
+	vFragColor.a = 1.0f;
+}
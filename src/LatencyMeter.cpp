@@ -0,0 +1,198 @@
+// LatencyMeter.cpp
+// Measures input-to-photon latency.
+
+#include "LatencyMeter.h"
+
+#include <StopWatch.h>
+
+#include <algorithm>
+
+LatencyMeter::LatencyMeter(void) : bRunning(false), bTimestamps(false), nClockOffset(0), nPresses(0), iNext(0)
+{
+    for(int i = 0; i < LATENCY_FRAMES_IN_FLIGHT; i++) {
+        frames[i].fence = NULL;
+        frames[i].query = 0;
+        frames[i].nPresses = 0;
+    }
+}
+
+bool LatencyMeter::Start(void)
+{
+    if(bRunning)
+        return true;
+
+    if(!GLEW_VERSION_3_2 && !GLEW_ARB_sync)
+        return false;
+
+    bTimestamps = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query) && glQueryCounter != NULL;
+    for(int i = 0; i < LATENCY_FRAMES_IN_FLIGHT; i++) {
+        if(bTimestamps)
+            glGenQueries(1, &frames[i].query);
+        frames[i].fence = NULL;
+        frames[i].nPresses = 0;
+    }
+
+    Calibrate();
+    samples.clear();
+    nPresses = 0;
+    iNext = 0;
+    bRunning = true;
+    return true;
+}
+
+void LatencyMeter::Stop(void)
+{
+    if(!bRunning)
+        return;
+
+    // Whatever is still in flight is finished by now or shortly
+    for(int i = 0; i < LATENCY_FRAMES_IN_FLIGHT; i++) {
+        Frame &frame = frames[i];
+        if(frame.fence == NULL)
+            continue;
+        glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        Collect(frame, CStopWatch::GetTimeNanoseconds());
+    }
+
+    for(int i = 0; i < LATENCY_FRAMES_IN_FLIGHT; i++)
+        if(frames[i].query != 0)
+            glDeleteQueries(1, &frames[i].query);
+
+    bRunning = false;
+}
+
+// The GPU clock has its own zero. Reading it straight (not through a query)
+// returns its value now, so the CPU clock read alongside gives the offset.
+void LatencyMeter::Calibrate(void)
+{
+    if(!bTimestamps)
+        return;
+
+    int64_t nBefore = CStopWatch::GetTimeNanoseconds();
+    GLint64 nGPU = 0;
+    glGetInteger64v(GL_TIMESTAMP, &nGPU);
+    int64_t nAfter = CStopWatch::GetTimeNanoseconds();
+    nClockOffset = (nBefore + nAfter) / 2 - int64_t(nGPU);
+}
+
+void LatencyMeter::KeyPressed(void)
+{
+    if(!bRunning || nPresses >= LATENCY_MAX_PRESSES)
+        return;
+
+    nPressTimes[nPresses++] = CStopWatch::GetTimeNanoseconds();
+}
+
+void LatencyMeter::FrameSwapped(int64_t nInputTime)
+{
+    if(!bRunning || nPresses == 0)
+        return;
+
+    // Presses this frame reflects, in the order they happened
+    Frame &frame = frames[iNext];
+    if(frame.fence != NULL) {
+        // Every slot busy means the GPU is far behind; this wait is rare
+        glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        Collect(frame, CStopWatch::GetTimeNanoseconds());
+    }
+
+    int nKept = 0;
+    frame.nPresses = 0;
+    for(int i = 0; i < nPresses; i++) {
+        if(nPressTimes[i] <= nInputTime)
+            frame.nPressTimes[frame.nPresses++] = nPressTimes[i];
+        else
+            nPressTimes[nKept++] = nPressTimes[i];
+    }
+    nPresses = nKept;
+
+    if(frame.nPresses == 0)
+        return;
+
+    if(bTimestamps)
+        glQueryCounter(frame.query, GL_TIMESTAMP);
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    iNext = (iNext + 1) % LATENCY_FRAMES_IN_FLIGHT;
+}
+
+void LatencyMeter::Poll(void)
+{
+    if(!bRunning)
+        return;
+
+    for(int i = 0; i < LATENCY_FRAMES_IN_FLIGHT; i++) {
+        Frame &frame = frames[i];
+        if(frame.fence == NULL)
+            continue;
+
+        GLenum eStatus = glClientWaitSync(frame.fence, 0, 0);
+        if(eStatus == GL_ALREADY_SIGNALED || eStatus == GL_CONDITION_SATISFIED)
+            Collect(frame, CStopWatch::GetTimeNanoseconds());
+    }
+}
+
+// The fence has signaled. nSeen is when that was noticed, the fallback
+// without GPU timestamps.
+void LatencyMeter::Collect(Frame &frame, int64_t nSeen)
+{
+    int64_t nComplete = nSeen;
+    if(bTimestamps) {
+        GLuint64 nGPU = 0;
+        glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &nGPU);
+        nComplete = int64_t(nGPU) + nClockOffset;
+    }
+
+    for(int i = 0; i < frame.nPresses; i++)
+        samples.push_back(double(nComplete - frame.nPressTimes[i]) * 1e-6);
+
+    glDeleteSync(frame.fence);
+    frame.fence = NULL;
+    frame.nPresses = 0;
+}
+
+double LatencyMeter::GetPercentile(double dPercent) const
+{
+    if(samples.empty())
+        return 0.0;
+
+    sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t iRank = size_t(dPercent / 100.0 * sorted.size() + 0.999999);
+    if(iRank < 1)
+        iRank = 1;
+    if(iRank > sorted.size())
+        iRank = sorted.size();
+    return sorted[iRank - 1];
+}
+
+void LatencyMeter::Report(FILE *pFile) const
+{
+    if(samples.empty()) {
+        fprintf(pFile, "Input latency: no key presses measured\n");
+        return;
+    }
+
+    fprintf(pFile, "Input latency over %d presses (%s): min %.2f  median %.2f  p90 %.2f  p99 %.2f  max %.2f ms\n",
+            GetSampleCount(), bTimestamps ? "GPU timestamps" : "fence polling",
+            GetPercentile(0.0), GetPercentile(50.0), GetPercentile(90.0), GetPercentile(99.0), GetPercentile(100.0));
+
+    // 5 ms buckets, the last one open-ended
+    const int nBuckets = 12;
+    int nCounts[nBuckets] = { 0 };
+    for(size_t i = 0; i < samples.size(); i++) {
+        int iBucket = int(samples[i] / 5.0);
+        nCounts[iBucket < 0 ? 0 : (iBucket >= nBuckets ? nBuckets - 1 : iBucket)]++;
+    }
+
+    int nMost = *std::max_element(nCounts, nCounts + nBuckets);
+    for(int i = 0; i < nBuckets; i++) {
+        if(i < nBuckets - 1)
+            fprintf(pFile, "  %3d-%3d ms %5d ", i * 5, i * 5 + 5, nCounts[i]);
+        else
+            fprintf(pFile, "  %3d+    ms %5d ", i * 5, nCounts[i]);
+        for(int j = 0; j < (nCounts[i] * 40 + nMost - 1) / nMost; j++)
+            fputc('#', pFile);
+        fputc('\n', pFile);
+    }
+}
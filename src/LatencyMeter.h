@@ -0,0 +1,73 @@
+// LatencyMeter.h
+// Measures input-to-photon latency: how long after a key press the first
+// frame showing its effect has been swapped.
+//
+// KeyPressed() stamps each press. After every swap, FrameSwapped() is told
+// the time up to which that frame's simulation had taken input in; presses
+// up to then are tagged with the frame, and a GL_TIMESTAMP query plus a
+// fence go in behind the swap. Poll() later reads the ones the GPU has
+// finished, without waiting, and turns the GPU timestamp into the CPU clock.
+// The result is when the swap completed; scanout can add up to one refresh.
+
+#ifndef __SOLAR_LATENCY_METER
+#define __SOLAR_LATENCY_METER
+
+#include <GLTools.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#define LATENCY_FRAMES_IN_FLIGHT    8
+#define LATENCY_MAX_PRESSES         16      // Presses waiting for, or tagged to, one frame
+
+class LatencyMeter
+    {
+    public:
+        LatencyMeter(void);
+
+        // Needs a current context with sync objects. Clears earlier samples.
+        bool Start(void);
+        void Stop(void);
+        bool IsRunning(void) const { return bRunning; }
+
+        void KeyPressed(void);
+
+        // Right after a swap. nInputTime is the clock time (nanoseconds) up to
+        // which input had reached the frame just swapped.
+        void FrameSwapped(int64_t nInputTime);
+
+        // Collect frames the GPU has finished
+        void Poll(void);
+
+        // Milliseconds
+        int GetSampleCount(void) const { return int(samples.size()); }
+        double GetPercentile(double dPercent) const;
+
+        // Percentiles and a histogram
+        void Report(FILE *pFile) const;
+
+    protected:
+        struct Frame
+            {
+            GLsync      fence;          // NULL when the slot is free
+            GLuint      query;
+            int         nPresses;
+            int64_t     nPressTimes[LATENCY_MAX_PRESSES];
+            };
+
+        void Collect(Frame &frame, int64_t nComplete);
+        void Calibrate(void);
+
+        bool                    bRunning;
+        bool                    bTimestamps;    // GPU timestamps, else the time the fence is seen
+        int64_t                 nClockOffset;   // CPU clock minus GPU clock
+        int64_t                 nPressTimes[LATENCY_MAX_PRESSES];
+        int                     nPresses;
+        Frame                   frames[LATENCY_FRAMES_IN_FLIGHT];
+        int                     iNext;
+        std::vector<double>     samples;
+        mutable std::vector<double> sorted;
+    };
+
+#endif
@@ -0,0 +1,136 @@
+// Orbit.cpp
+// Two-body orbit propagation for the solar scene.
+
+#include "Orbit.h"
+
+#include <math.h>
+#include <math3d.h>
+
+OrbitPropagator::OrbitPropagator(void) : dMu(0.0), dMeanMotion(0.0), bAnalytic(true), nLastSubsteps(0)
+{
+    elements.dSemiMajorAxis = 0.0;
+    elements.dEccentricity = 0.0;
+    elements.dPeriod = 1.0;
+    elements.dMeanAnomalyAtEpoch = 0.0;
+
+    vPosition[0] = vPosition[1] = 0.0;
+    vVelocity[0] = vVelocity[1] = 0.0;
+}
+
+void OrbitPropagator::SetElements(const OrbitElements &orbitElements, double dTime)
+{
+    elements = orbitElements;
+
+    // n = 2PI / T, mu = n^2 a^3. The sign of n carries the direction of travel.
+    dMeanMotion = M3D_2PI / elements.dPeriod;
+    dMu = dMeanMotion * dMeanMotion * elements.dSemiMajorAxis * elements.dSemiMajorAxis * elements.dSemiMajorAxis;
+
+    SetTime(dTime);
+}
+
+void OrbitPropagator::SetTime(double dTime)
+{
+    SolveKepler(dTime, vPosition, vVelocity);
+    bAnalytic = true;
+    nLastSubsteps = 0;
+}
+
+void OrbitPropagator::SetState(const double vPos[2], const double vVel[2])
+{
+    vPosition[0] = vPos[0];
+    vPosition[1] = vPos[1];
+    vVelocity[0] = vVel[0];
+    vVelocity[1] = vVel[1];
+}
+
+void OrbitPropagator::Advance(double dTime, double dDeltaTime, int nMaxSubsteps)
+{
+    if(dDeltaTime == 0.0) {
+        nLastSubsteps = 0;
+        return;
+    }
+
+    double dMaxStep = fabs(elements.dPeriod) / ORBIT_STEPS_PER_REVOLUTION;
+    double dSubsteps = ceil(fabs(dDeltaTime) / dMaxStep);
+
+    // Too much ground to cover this frame, the closed form is both cheaper and exact
+    if(dSubsteps > nMaxSubsteps) {
+        SetTime(dTime);
+        return;
+    }
+
+    // Yoshida's composition of three leapfrogs makes each step fourth order,
+    // so the phase error stays negligible over thousands of revolutions
+    static const double dCbrt2 = pow(2.0, 1.0 / 3.0);
+    static const double w1 = 1.0 / (2.0 - dCbrt2);
+    static const double w0 = -dCbrt2 / (2.0 - dCbrt2);
+
+    int nSubsteps = int(dSubsteps);
+    double dStep = dDeltaTime / nSubsteps;
+    for(int i = 0; i < nSubsteps; i++) {
+        Leapfrog(w1 * dStep);
+        Leapfrog(w0 * dStep);
+        Leapfrog(w1 * dStep);
+    }
+
+    bAnalytic = false;
+    nLastSubsteps = nSubsteps;
+}
+
+// Kick-drift-kick leapfrog. Symplectic, so the orbit does not spiral in or out
+// no matter how long we integrate.
+void OrbitPropagator::Leapfrog(double dStep)
+{
+    double dHalf = dStep * 0.5;
+
+    double r2 = vPosition[0] * vPosition[0] + vPosition[1] * vPosition[1];
+    double k = -dMu / (r2 * sqrt(r2));
+    vVelocity[0] += k * vPosition[0] * dHalf;
+    vVelocity[1] += k * vPosition[1] * dHalf;
+
+    vPosition[0] += vVelocity[0] * dStep;
+    vPosition[1] += vVelocity[1] * dStep;
+
+    r2 = vPosition[0] * vPosition[0] + vPosition[1] * vPosition[1];
+    k = -dMu / (r2 * sqrt(r2));
+    vVelocity[0] += k * vPosition[0] * dHalf;
+    vVelocity[1] += k * vPosition[1] * dHalf;
+}
+
+void OrbitPropagator::SolveKepler(double dTime, double vPos[2], double vVel[2]) const
+{
+    double a = elements.dSemiMajorAxis;
+    double e = elements.dEccentricity;
+
+    // Wrap the mean anomaly before anything else so large times keep their precision
+    double M = fmod(elements.dMeanAnomalyAtEpoch + dMeanMotion * dTime, M3D_2PI);
+
+    // Newton-Raphson on E - e sin(E) = M
+    double E = (e < 0.8) ? M : M3D_PI;
+    for(int i = 0; i < 16; i++) {
+        double dE = (E - e * sin(E) - M) / (1.0 - e * cos(E));
+        E -= dE;
+        if(fabs(dE) < 1e-12)
+            break;
+    }
+
+    double sinE = sin(E);
+    double cosE = cos(E);
+    double b = a * sqrt(1.0 - e * e);
+    double Edot = dMeanMotion / (1.0 - e * cosE);
+
+    vPos[0] = a * (cosE - e);
+    vPos[1] = b * sinE;
+    vVel[0] = -a * sinE * Edot;
+    vVel[1] = b * cosE * Edot;
+}
+
+double OrbitPropagator::GetAngle(void) const
+{
+    return m3dRadToDeg(atan2(vPosition[1], vPosition[0]));
+}
+
+double OrbitPropagator::GetRadius(void) const
+{
+    return sqrt(vPosition[0] * vPosition[0] + vPosition[1] * vPosition[1]);
+}
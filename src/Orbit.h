@@ -0,0 +1,68 @@
+// Orbit.h
+// Two-body orbit propagation for the solar scene.
+//
+// A body is normally advanced with a leapfrog integrator, substepped so that
+// no single step sweeps more than a small arc of the orbit. When the time warp
+// is so high that this would exceed the per-frame step budget, the propagator
+// switches to the analytic Kepler solution, which costs the same at any time
+// scale and carries no accumulated error.
+
+#ifndef __SOLAR_ORBIT
+#define __SOLAR_ORBIT
+
+// Integrator steps per revolution. One step never covers more than half a degree.
+#define ORBIT_STEPS_PER_REVOLUTION  720
+
+struct OrbitElements
+    {
+    double dSemiMajorAxis;          // Scene units
+    double dEccentricity;           // 0 = circle
+    double dPeriod;                 // Simulation seconds, negative for a retrograde orbit
+    double dMeanAnomalyAtEpoch;     // Radians at simulation time zero
+    };
+
+class OrbitPropagator
+    {
+    public:
+        OrbitPropagator(void);
+
+        // Set the orbit and place the body where it is at dTime
+        void SetElements(const OrbitElements &orbitElements, double dTime = 0.0);
+        const OrbitElements& GetElements(void) const { return elements; }
+
+        // Move the body forward by dDeltaTime so that it ends up at dTime.
+        // Integrates when that fits in nMaxSubsteps, otherwise jumps analytically.
+        void Advance(double dTime, double dDeltaTime, int nMaxSubsteps);
+
+        // Jump straight to dTime with the analytic solution
+        void SetTime(double dTime);
+
+        // Position in the orbital plane as an angle from periapsis (degrees) and a distance
+        double GetAngle(void) const;
+        double GetRadius(void) const;
+
+        // Raw state, in the orbital plane
+        const double* GetPosition(void) const { return vPosition; }
+        const double* GetVelocity(void) const { return vVelocity; }
+        void SetState(const double vPos[2], const double vVel[2]);
+
+        // How the last Advance() was carried out
+        bool IsAnalytic(void) const { return bAnalytic; }
+        int GetLastSubsteps(void) const { return nLastSubsteps; }
+
+        // Solve Kepler's equation for the state at dTime
+        void SolveKepler(double dTime, double vPos[2], double vVel[2]) const;
+
+    protected:
+        void Leapfrog(double dStep);
+
+        OrbitElements   elements;
+        double          dMu;            // Gravitational parameter of the central body
+        double          dMeanMotion;    // Radians per simulation second, signed
+        double          vPosition[2];
+        double          vVelocity[2];
+        bool            bAnalytic;
+        int             nLastSubsteps;
+    };
+
+#endif
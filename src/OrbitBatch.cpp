@@ -0,0 +1,99 @@
+// OrbitBatch.cpp
+// Orbit paths generated on the GPU, every one in view in a single draw.
+
+#include "OrbitBatch.h"
+
+#include <GLProfiler.h>
+
+#include <math.h>
+#include <string.h>
+
+bool OrbitBatch::Init(void)
+{
+    shader = gltLoadShaderTripletWithAttributes("src/OrbitShader.vp", "src/OrbitShader.gp", "src/OrbitShader.fp", 0);
+    if(shader == 0)
+        return false;
+
+    locModelViews = glGetUniformLocation(shader, "mvMatrices");
+    locElements = glGetUniformLocation(shader, "vElements");
+    locProjection = glGetUniformLocation(shader, "pMatrix");
+    locColor = glGetUniformLocation(shader, "vColor");
+    locHalfViewport = glGetUniformLocation(shader, "vHalfViewport");
+    locHalfWidth = glGetUniformLocation(shader, "fHalfWidth");
+
+    glGenVertexArrays(1, &vertexArray);
+    return true;
+}
+
+void OrbitBatch::Shutdown(void)
+{
+    if(shader != 0)
+        glDeleteProgram(shader);
+    if(vertexArray != 0)
+        glDeleteVertexArrays(1, &vertexArray);
+    shader = vertexArray = 0;
+}
+
+bool OrbitBatch::Add(const M3DMatrix44f mModelView, float fSemiMajorAxis, float fEccentricity)
+{
+    if(nOrbits == ORBIT_MAX_ORBITS)
+        return false;
+
+    // How close the eye (the origin) comes to the orbit, taken as the circle
+    // of the semi-major axis in its plane; the plane's normal is the node's Y
+    const float *vCenter = &mModelView[12];
+    const float *vNormal = &mModelView[4];
+    float fHeight = -m3dDotProduct3(vCenter, vNormal);
+    M3DVector3f vInPlane;
+    for(int i = 0; i < 3; i++)
+        vInPlane[i] = -vCenter[i] - fHeight * vNormal[i];
+    float fAcross = m3dGetVectorLength3(vInPlane) - fSemiMajorAxis;
+    float fDistance = sqrtf(fHeight * fHeight + fAcross * fAcross);
+
+    // Segments so the sagitta r (1 - cos(pi / n)) stays under the error,
+    // r being the tightest radius of curvature (at periapsis) in pixels
+    float fCurvature = fSemiMajorAxis * (1.0f - fEccentricity * fEccentricity);
+    float fPixels = fCurvature * fScale / (fDistance > 0.01f ? fDistance : 0.01f);
+    int nSegments = ORBIT_MAX_SEGMENTS;
+    if(fPixels > ORBIT_MAX_ERROR) {
+        float fSegments = float(M3D_PI) / acosf(1.0f - ORBIT_MAX_ERROR / fPixels);
+        if(fSegments < float(ORBIT_MAX_SEGMENTS))
+            nSegments = int(ceilf(fSegments));
+    }
+    else
+        nSegments = ORBIT_MIN_SEGMENTS;
+    if(nSegments < ORBIT_MIN_SEGMENTS)
+        nSegments = ORBIT_MIN_SEGMENTS;
+    if(nSegments > nMaxSegments)
+        nMaxSegments = nSegments;
+
+    memcpy(mModelViews[nOrbits], mModelView, sizeof(M3DMatrix44f));
+    m3dLoadVector4(vElements[nOrbits], fSemiMajorAxis, fEccentricity, float(nSegments), 0.0f);
+    nOrbits++;
+    return true;
+}
+
+void OrbitBatch::Draw(const M3DMatrix44f mProjection, const M3DVector4f vColor, int nViewportWidth, int nViewportHeight,
+                      float fLineWidth)
+{
+    GLT_PROFILE_FUNCTION();
+
+    if(nOrbits == 0 || shader == 0)
+        return;
+
+    glUseProgram(shader);
+    glUniformMatrix4fv(locModelViews, nOrbits, GL_FALSE, mModelViews[0]);
+    glUniform4fv(locElements, nOrbits, vElements[0]);
+    glUniformMatrix4fv(locProjection, 1, GL_FALSE, mProjection);
+    glUniform4fv(locColor, 1, vColor);
+    glUniform2f(locHalfViewport, 0.5f * float(nViewportWidth), 0.5f * float(nViewportHeight));
+    glUniform1f(locHalfWidth, 0.5f * fLineWidth);
+    gltCountStateChange();
+
+    // A closed strip of n segments is n + 1 points, with one more at each
+    // end for adjacency
+    glBindVertexArray(vertexArray);
+    glDrawArraysInstanced(GL_LINE_STRIP_ADJACENCY, 0, nMaxSegments + 3, nOrbits);
+    glBindVertexArray(0);
+    gltCountDraw(GL_LINE_STRIP_ADJACENCY, (nMaxSegments + 3) * nOrbits);
+}
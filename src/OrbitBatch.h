@@ -0,0 +1,67 @@
+// OrbitBatch.h
+// Orbit paths generated on the GPU, every one in view in a single draw.
+//
+// No vertex buffers: Add() queues an orbit as its plane (a modelview placing
+// it, with the orbit in the XZ plane and periapsis along +X), its semi-major
+// axis and eccentricity. Draw() makes one instanced
+// GL_LINE_STRIP_ADJACENCY call, and the vertex shader puts vertex k of
+// instance i at eccentric anomaly 2 pi k / n of orbit i, from gl_VertexID
+// and gl_InstanceID. Each orbit gets its own n, enough that no segment is
+// more than ORBIT_MAX_ERROR pixels off the true curve where the orbit comes
+// closest to the eye; instances with fewer segments than the draw's largest
+// repeat their last vertex, which the geometry shader drops. The geometry
+// shader widens each segment into a quad a fixed number of pixels across,
+// mitred with its neighbours, and clips it to the near plane first so orbits
+// passing behind the camera stay correct.
+
+#ifndef __SOLAR_ORBIT_BATCH
+#define __SOLAR_ORBIT_BATCH
+
+#include <GLTools.h>
+
+#define ORBIT_MAX_ORBITS        16      // Per draw, the shader's uniform arrays
+#define ORBIT_MIN_SEGMENTS      32
+#define ORBIT_MAX_SEGMENTS      2048
+#define ORBIT_MAX_ERROR         0.25f   // Pixels between a segment and the curve
+
+class OrbitBatch
+    {
+    public:
+        OrbitBatch(void) : shader(0), vertexArray(0), nOrbits(0), nMaxSegments(0) {}
+
+        // Needs a current context
+        bool Init(void);
+        void Shutdown(void);
+
+        // fPixelScale as for SphereLod: pixels per unit at unit distance
+        void Begin(float fPixelScale) { nOrbits = 0; nMaxSegments = 0; fScale = fPixelScale; }
+
+        // mModelView (rigid) places the orbit's plane. False when full.
+        bool Add(const M3DMatrix44f mModelView, float fSemiMajorAxis, float fEccentricity);
+
+        int GetCount(void) const { return nOrbits; }
+        int GetSegments(int iOrbit) const { return int(vElements[iOrbit][2]); }
+
+        // Everything added since Begin(), fLineWidth pixels wide, in one draw
+        void Draw(const M3DMatrix44f mProjection, const M3DVector4f vColor, int nViewportWidth, int nViewportHeight,
+                  float fLineWidth = 1.0f);
+
+    protected:
+        GLuint          shader;
+        GLint           locModelViews;
+        GLint           locElements;
+        GLint           locProjection;
+        GLint           locColor;
+        GLint           locHalfViewport;
+        GLint           locHalfWidth;
+
+        GLuint          vertexArray;        // Empty, the core profile wants one bound
+
+        float           fScale;
+        int             nOrbits;
+        int             nMaxSegments;
+        M3DMatrix44f    mModelViews[ORBIT_MAX_ORBITS];
+        M3DVector4f     vElements[ORBIT_MAX_ORBITS];    // Semi-major axis, eccentricity, segments
+    };
+
+#endif
@@ -0,0 +1,12 @@
+#version 330
+
+// Flat color for the orbit paths
+
+uniform vec4 vColor;
+
+out vec4 vFragColor;
+
+void main(void)
+{
+    vFragColor = vColor;
+}
@@ -0,0 +1,79 @@
+#version 330
+
+// Each segment as a quad fHalfWidth pixels either side, its ends mitred with
+// the neighbouring segments. Clipped to the near plane before any divide.
+
+layout(lines_adjacency) in;
+layout(triangle_strip, max_vertices = 4) out;
+
+uniform vec2    vHalfViewport;      // Pixels
+uniform float   fHalfWidth;         // Pixels
+
+// In front of the near plane
+bool InFront(vec4 vClip)
+{
+    return vClip.z + vClip.w > 0.0;
+}
+
+vec2 ToScreen(vec4 vClip)
+{
+    return vClip.xy / vClip.w * vHalfViewport;
+}
+
+vec2 Perpendicular(vec2 vDirection)
+{
+    return vec2(-vDirection.y, vDirection.x);
+}
+
+// Offset at a joint for a unit normal, mitred with the neighbour's segment
+// when it has one in front of the camera
+vec2 Miter(vec2 vNormal, vec2 vPoint, vec4 vNeighbour, bool bBefore)
+{
+    if(!InFront(vNeighbour))
+        return vNormal;
+    vec2 vOther = bBefore ? vPoint - ToScreen(vNeighbour) : ToScreen(vNeighbour) - vPoint;
+    if(dot(vOther, vOther) < 1e-8)
+        return vNormal;
+    vec2 vMiter = normalize(vNormal + Perpendicular(normalize(vOther)));
+    return vMiter / max(dot(vMiter, vNormal), 0.5);
+}
+
+void Emit(vec2 vScreen, vec4 vClip)
+{
+    gl_Position = vec4(vScreen / vHalfViewport * vClip.w, vClip.z, vClip.w);
+    EmitVertex();
+}
+
+void main(void)
+{
+    vec4 vStart = gl_in[1].gl_Position;
+    vec4 vEnd = gl_in[2].gl_Position;
+
+    float fStart = vStart.z + vStart.w;
+    float fEnd = vEnd.z + vEnd.w;
+    if(fStart <= 0.0 && fEnd <= 0.0)
+        return;
+
+    // Cut at the near plane; a cut end has no neighbour to mitre with
+    bool bStartCut = fStart <= 0.0, bEndCut = fEnd <= 0.0;
+    if(bStartCut)
+        vStart = mix(vStart, vEnd, fStart / (fStart - fEnd));
+    if(bEndCut)
+        vEnd = mix(vEnd, vStart, fEnd / (fEnd - fStart));
+
+    vec2 vA = ToScreen(vStart);
+    vec2 vB = ToScreen(vEnd);
+    vec2 vAlong = vB - vA;
+    if(dot(vAlong, vAlong) < 1e-8)
+        return;                         // Repeated points past an orbit's end
+    vec2 vNormal = Perpendicular(normalize(vAlong));
+
+    vec2 vOffsetA = fHalfWidth * (bStartCut ? vNormal : Miter(vNormal, vA, gl_in[0].gl_Position, true));
+    vec2 vOffsetB = fHalfWidth * (bEndCut ? vNormal : Miter(vNormal, vB, gl_in[3].gl_Position, false));
+
+    Emit(vA + vOffsetA, vStart);
+    Emit(vA - vOffsetA, vStart);
+    Emit(vB + vOffsetB, vEnd);
+    Emit(vB - vOffsetB, vEnd);
+    EndPrimitive();
+}
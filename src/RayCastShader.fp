@@ -0,0 +1,70 @@
+#version 330
+
+// Intersect the ray through this pixel with the sphere, then shade the hit
+// as SolarShader shades the mesh, with gltMakeSphere()'s texture mapping
+
+uniform sampler2D colorMap;
+uniform mat4	mvMatrix;
+uniform mat4	pMatrix;
+uniform float	fRadius;
+uniform vec3	vLightPosition;
+uniform bool	bObserverLight;
+uniform bool	bLit;
+
+smooth in vec3 vRay;
+
+// Output fragment color
+out vec4 vFragColor;
+
+const float PI = 3.14159265358979;
+
+void main(void)
+{
+    vec3 vCenter = mvMatrix[3].xyz;
+    vec3 vDirection = normalize(vRay);
+
+    // Nearest root of |t D - C| = r. A miss is only discarded at the end:
+    // the derivatives below are undefined after a discard that neighbouring
+    // fragments do not share, so a miss carries on from the closest point
+    float b = dot(vDirection, vCenter);
+    float fDiscriminant = b * b - dot(vCenter, vCenter) + fRadius * fRadius;
+    vec3 vPosition = vDirection * (b - sqrt(max(fDiscriminant, 0.0)));
+    vec3 vEyeNormal = (vPosition - vCenter) / fRadius;
+
+    vec4 vClip = pMatrix * vec4(vPosition, 1.0);
+    gl_FragDepth = (gl_DepthRange.diff * vClip.z / vClip.w + gl_DepthRange.near + gl_DepthRange.far) * 0.5;
+
+    // Back into the sphere's own frame: gltMakeSphere() puts x = -sin(theta) sin(rho),
+    // y = cos(theta) sin(rho), z = cos(rho) at s = theta / 2 pi, t = 1 - rho / pi
+    vec3 vNormal = transpose(mat3(mvMatrix)) * vEyeNormal;
+    float fTheta = atan(-vNormal.x, vNormal.y);
+    vec2 vTexCoords = vec2(fTheta / (2.0 * PI), 1.0 - acos(clamp(vNormal.z, -1.0, 1.0)) / PI);
+    vTexCoords.s = fract(vTexCoords.s);
+
+    // s wraps from 1 to 0 at theta = 0; take the gradient from a copy that
+    // wraps on the far side instead, or the seam picks the smallest mip
+    vec2 vGradX = dFdx(vTexCoords);
+    vec2 vGradY = dFdy(vTexCoords);
+    float fShifted = fract(vTexCoords.s + 0.5);
+    float fShiftedX = dFdx(fShifted), fShiftedY = dFdy(fShifted);
+    if(abs(fShiftedX) + abs(fShiftedY) < abs(vGradX.s) + abs(vGradY.s)) {
+        vGradX.s = fShiftedX;
+        vGradY.s = fShiftedY;
+    }
+
+    float lightIntensity = 1.0;
+    if(bLit){
+        vec3 vTmpLightPosition = vLightPosition;
+        if(bObserverLight){
+            vTmpLightPosition = vec3(0.0, 0.0, 0.0);
+        }
+        lightIntensity = max(0.0, dot(vEyeNormal, normalize(vTmpLightPosition - vPosition)));
+    }
+
+    vec4 vTmpColor = textureGrad(colorMap, vTexCoords, vGradX, vGradY);
+    vFragColor.rgb = vTmpColor.rgb * lightIntensity;
+    vFragColor.a = 1.0;
+
+    if(fDiscriminant < 0.0)
+        discard;
+}
@@ -0,0 +1,164 @@
+// ShaderPermutations.cpp
+// One shader source, compiled once per combination of features.
+
+#include "ShaderPermutations.h"
+
+#include <GLProfiler.h>
+#include <GLProgramCache.h>
+
+#include <stdio.h>
+
+// The whole file, or false
+static bool ReadSource(const char *szFile, std::string &source)
+{
+    FILE *pFile = fopen(szFile, "rb");
+    if(pFile == NULL)
+        return false;
+
+    source.clear();
+    char szBuffer[4096];
+    size_t nRead;
+    while((nRead = fread(szBuffer, 1, sizeof(szBuffer), pFile)) > 0)
+        source.append(szBuffer, nRead);
+    fclose(pFile);
+    return true;
+}
+
+bool ShaderPermutations::Load(const char *szVertexProg, const char *szFragmentProg, const char * const *szFeatureNames, int nFeatureCount)
+{
+    Shutdown();
+
+    if(nFeatureCount > SHADER_MAX_FEATURES)
+        return false;
+    if(!ReadSource(szVertexProg, vertexSource) || !ReadSource(szFragmentProg, fragmentSource)) {
+        fprintf(stderr, "The shader pair %s, %s could not be read.\n", szVertexProg, szFragmentProg);
+        return false;
+    }
+    vertexName = szVertexProg;
+    fragmentName = szFragmentProg;
+
+    nFeatures = nFeatureCount;
+    for(int i = 0; i < nFeatures; i++)
+        features[i] = szFeatureNames[i];
+    nAttributes = 0;
+
+    programs.assign(size_t(1) << nFeatures, 0);
+    tried.assign(size_t(1) << nFeatures, false);
+    return true;
+}
+
+void ShaderPermutations::BindAttribute(GLuint iIndex, const char *szName)
+{
+    if(nAttributes == SHADER_MAX_ATTRIBUTES)
+        return;
+    attributeIndexes[nAttributes] = iIndex;
+    attributeNames[nAttributes] = szName;
+    nAttributes++;
+}
+
+GLuint ShaderPermutations::Get(unsigned int nKey)
+{
+    if(nKey >= programs.size())
+        return 0;
+    if(!tried[nKey]) {
+        tried[nKey] = true;
+        programs[nKey] = Build(nKey);
+    }
+    return programs[nKey];
+}
+
+void ShaderPermutations::Shutdown(void)
+{
+    for(size_t i = 0; i < programs.size(); i++) {
+        if(programs[i] != 0)
+            glDeleteProgram(programs[i]);
+    }
+    programs.clear();
+    tried.clear();
+    nCompiled = 0;
+}
+
+GLuint ShaderPermutations::Build(unsigned int nKey)
+{
+    GLT_PROFILE_FUNCTION();
+
+    std::string defines;
+    for(int i = 0; i < nFeatures; i++) {
+        if(nKey & (1u << i))
+            defines += "#define " + features[i] + "\n";
+    }
+    std::string vertexText = AddDefines(vertexSource, defines);
+    std::string fragmentText = AddDefines(fragmentSource, defines);
+
+    // Linked on an earlier run, nothing to compile
+    uint64_t nCacheKey = gltProgramCacheHash(gltProgramCacheHash(GLT_PROGRAM_CACHE_SEED, vertexText.c_str()), fragmentText.c_str());
+    GLuint hProgram = glCreateProgram();
+    for(int i = 0; i < nAttributes; i++) {
+        glBindAttribLocation(hProgram, attributeIndexes[i], attributeNames[i].c_str());
+        nCacheKey = gltProgramCacheHash(gltProgramCacheHash(nCacheKey, int(attributeIndexes[i])), attributeNames[i].c_str());
+    }
+    if(gltProgramCacheLoad(hProgram, nCacheKey)) {
+        nCompiled++;
+        return hProgram;
+    }
+
+    GLuint hVertexShader = CompileStage(GL_VERTEX_SHADER, vertexText, defines, vertexName.c_str());
+    GLuint hFragmentShader = CompileStage(GL_FRAGMENT_SHADER, fragmentText, defines, fragmentName.c_str());
+    if(hVertexShader == 0 || hFragmentShader == 0) {
+        if(hVertexShader != 0)
+            glDeleteShader(hVertexShader);
+        if(hFragmentShader != 0)
+            glDeleteShader(hFragmentShader);
+        glDeleteProgram(hProgram);
+        return 0;
+    }
+
+    glAttachShader(hProgram, hVertexShader);
+    glAttachShader(hProgram, hFragmentShader);
+    glLinkProgram(hProgram);
+    glDeleteShader(hVertexShader);
+    glDeleteShader(hFragmentShader);
+
+    GLint testVal;
+    glGetProgramiv(hProgram, GL_LINK_STATUS, &testVal);
+    if(testVal == GL_FALSE) {
+        char infoLog[1024];
+        glGetProgramInfoLog(hProgram, 1024, NULL, infoLog);
+        fprintf(stderr, "The program %s, %s (features 0x%x) failed to link with the following errors:\n%s\n",
+                vertexName.c_str(), fragmentName.c_str(), nKey, infoLog);
+        glDeleteProgram(hProgram);
+        return 0;
+    }
+
+    gltProgramCacheStore(hProgram, nCacheKey);
+    nCompiled++;
+    return hProgram;
+}
+
+// The defines go after #version, which must come first
+std::string ShaderPermutations::AddDefines(const std::string &source, const std::string &defines)
+{
+    size_t nVersion = source.find("#version");
+    size_t nLineEnd = (nVersion == std::string::npos) ? std::string::npos : source.find('\n', nVersion);
+    if(nLineEnd == std::string::npos)
+        return defines + source;
+    return source.substr(0, nLineEnd + 1) + defines + source.substr(nLineEnd + 1);
+}
+
+GLuint ShaderPermutations::CompileStage(GLenum eStage, const std::string &text, const std::string &defines, const char *szName)
+{
+    GLuint hShader = glCreateShader(eStage);
+    gltLoadShaderSrc(text.c_str(), hShader);
+    glCompileShader(hShader);
+
+    GLint testVal;
+    glGetShaderiv(hShader, GL_COMPILE_STATUS, &testVal);
+    if(testVal == GL_FALSE) {
+        char infoLog[1024];
+        glGetShaderInfoLog(hShader, 1024, NULL, infoLog);
+        fprintf(stderr, "The shader at %s failed to compile with the following error:\n%s\n%s\n", szName, defines.c_str(), infoLog);
+        glDeleteShader(hShader);
+        return 0;
+    }
+    return hShader;
+}
@@ -0,0 +1,66 @@
+// ShaderPermutations.h
+// One shader source, compiled once per combination of features.
+//
+// Instead of branching on uniforms for every vertex and fragment, a shader
+// pair is written with #ifdef blocks, one per feature. Bit i of a key turns
+// on feature i, which is #defined right after the #version line. Get()
+// compiles and links a key's program the first time it is asked for and
+// keeps it, so only the combinations actually drawn ever get built; each one
+// runs just the code it needs. With a GLProgramCache directory set, a
+// combination built on an earlier run is loaded rather than compiled.
+
+#ifndef __SOLAR_SHADER_PERMUTATIONS
+#define __SOLAR_SHADER_PERMUTATIONS
+
+#include <GLTools.h>
+
+#include <string>
+#include <vector>
+
+#define SHADER_MAX_FEATURES     8
+#define SHADER_MAX_ATTRIBUTES   8
+
+class ShaderPermutations
+    {
+    public:
+        ShaderPermutations(void) : nFeatures(0), nAttributes(0), nCompiled(0) {}
+
+        // Read the sources. Bit i of a key #defines szFeatures[i]. Programs
+        // built earlier are released.
+        bool Load(const char *szVertexProg, const char *szFragmentProg, const char * const *szFeatureNames, int nFeatureCount);
+
+        // Before the first Get()
+        void BindAttribute(GLuint iIndex, const char *szName);
+
+        // The program for nKey, built now if this is the first time. 0 if it
+        // will not build (reported on stderr once).
+        GLuint Get(unsigned int nKey);
+
+        // Whether Get(nKey) will return without compiling
+        bool IsBuilt(unsigned int nKey) const { return nKey < tried.size() && tried[nKey]; }
+        int GetBuiltCount(void) const { return nCompiled; }
+
+        // Needs the context the programs were built in
+        void Shutdown(void);
+
+    protected:
+        GLuint Build(unsigned int nKey);
+        static std::string AddDefines(const std::string &source, const std::string &defines);
+        GLuint CompileStage(GLenum eStage, const std::string &text, const std::string &defines, const char *szName);
+
+        std::string             vertexSource;
+        std::string             fragmentSource;
+        std::string             vertexName;
+        std::string             fragmentName;
+        std::string             features[SHADER_MAX_FEATURES];
+        int                     nFeatures;
+        GLuint                  attributeIndexes[SHADER_MAX_ATTRIBUTES];
+        std::string             attributeNames[SHADER_MAX_ATTRIBUTES];
+        int                     nAttributes;
+
+        std::vector<GLuint>     programs;       // By key
+        std::vector<bool>       tried;
+        int                     nCompiled;
+    };
+
+#endif
@@ -1,11 +0,0 @@
-#version 330
-
-in vec4 vVaryingColor;
-
-out vec4 vFragColor;
-
-void main(void)
-{ 
-	vFragColor = vVaryingColor;
-}
-    
\ No newline at end of file
@@ -0,0 +1,49 @@
+// SimulationThread.cpp
+// Runs the simulation step on its own thread at a fixed rate.
+
+#include "SimulationThread.h"
+#include "FrameScheduler.h"
+
+#include <GLProfiler.h>
+
+void SimulationThread::Start(StepFunc pStepFunc, double dRate)
+{
+    Stop();
+
+    if(dRate < 1.0)
+        dRate = 1.0;
+
+    pStep = pStepFunc;
+    nPeriod = int64_t(1e9 / dRate);
+    bQuit = false;
+    thread = std::thread(&SimulationThread::Run, this);
+}
+
+void SimulationThread::Stop(void)
+{
+    if(!thread.joinable())
+        return;
+
+    bQuit = true;
+    thread.join();
+}
+
+void SimulationThread::Run(void)
+{
+    gltProfileSetThreadName("simulation");
+
+    double dStep = GetStepSeconds();
+    int64_t nNext = FrameScheduler::GetTime();
+
+    while(!bQuit.load(std::memory_order_relaxed)) {
+        pStep(dStep);
+        nNext += nPeriod;
+
+        int64_t nNow = FrameScheduler::GetTime();
+        if(nNow - nNext > nPeriod * SIM_MAX_BEHIND_STEPS)
+            nNext = nNow;
+
+        // No spin: a late wakeup only delays publishing, never the render
+        FrameScheduler::SleepUntil(nNext, 0);
+    }
+}
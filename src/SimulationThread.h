@@ -0,0 +1,44 @@
+// SimulationThread.h
+// Runs the simulation step on its own thread at a fixed rate.
+//
+// Every step is the same length of simulated time, whatever the renderer is
+// doing. The thread sleeps between steps; when a step overruns, the next
+// ones follow straight on to catch up, and after falling more than
+// SIM_MAX_BEHIND_STEPS behind the schedule starts over so the simulation
+// slows down instead of spiralling.
+
+#ifndef __SOLAR_SIMULATION_THREAD
+#define __SOLAR_SIMULATION_THREAD
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+
+#define SIM_DEFAULT_RATE        120.0   // Steps per second
+#define SIM_MAX_BEHIND_STEPS    4
+
+class SimulationThread
+    {
+    public:
+        typedef void (*StepFunc)(double dStep);
+
+        SimulationThread(void) : pStep(NULL), nPeriod(0), bQuit(false) {}
+        ~SimulationThread(void) { Stop(); }
+
+        // Call pStepFunc with dStep = 1 / dRate, dRate times a second
+        void Start(StepFunc pStepFunc, double dRate);
+        void Stop(void);
+        bool IsRunning(void) const { return thread.joinable(); }
+
+        double GetStepSeconds(void) const { return double(nPeriod) * 1e-9; }
+
+    protected:
+        void Run(void);
+
+        StepFunc            pStep;
+        int64_t             nPeriod;        // Nanoseconds per step
+        std::atomic<bool>   bQuit;
+        std::thread         thread;
+    };
+
+#endif
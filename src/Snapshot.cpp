@@ -0,0 +1,268 @@
+// Snapshot.cpp
+// Periodic, compressed snapshots of the simulation state for seeking.
+
+#include "Snapshot.h"
+
+#include <string.h>
+#include <stdint.h>
+
+// Header in front of every record in the spill file
+struct SnapshotFileRecord
+    {
+    double      dTime;
+    uint32_t    nPackedSize;
+    uint32_t    bKeyframe;
+    };
+
+SnapshotStore::SnapshotStore(int nStateDoubles, int nMaxRecords) : nDoubles(nStateDoubles), nMaxSnapshots(nMaxRecords),
+    nSinceKey(SNAPSHOT_KEY_INTERVAL), pFile(NULL), lLastKeyOffset(0), nLastKeySize(0)
+{
+    // Always keep at least two whole groups in memory
+    if(nMaxSnapshots < 2 * SNAPSHOT_KEY_INTERVAL)
+        nMaxSnapshots = 2 * SNAPSHOT_KEY_INTERVAL;
+
+    keyState.resize(nDoubles);
+}
+
+SnapshotStore::~SnapshotStore(void)
+{
+    if(pFile != NULL)
+        fclose(pFile);
+}
+
+bool SnapshotStore::OpenFile(const char *szFileName)
+{
+    if(pFile != NULL)
+        fclose(pFile);
+
+    diskIndex.clear();
+    pFile = fopen(szFileName, "w+b");
+    if(pFile == NULL)
+        return false;
+
+    fwrite(SNAPSHOT_MAGIC, 1, 8, pFile);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// XOR against the keyframe, then pack runs of zero bytes. Values that did not
+// change, and the sign/exponent bytes of values that changed a little, cost
+// next to nothing.
+//   control < 0x80 : control + 1 literal bytes follow
+//   control >= 0x80: control - 0x7F zero bytes
+void SnapshotStore::Pack(const double *pState, const double *pKey, std::vector<unsigned char> &out) const
+{
+    std::vector<unsigned char> delta(nDoubles * sizeof(double));
+    for(int i = 0; i < nDoubles; i++) {
+        uint64_t a, b;
+        memcpy(&a, &pState[i], sizeof(a));
+        memcpy(&b, &pKey[i], sizeof(b));
+        a ^= b;
+        memcpy(&delta[i * sizeof(double)], &a, sizeof(a));
+    }
+
+    out.clear();
+    size_t i = 0;
+    while(i < delta.size()) {
+        size_t nRun = 0;
+        while(i + nRun < delta.size() && delta[i + nRun] == 0 && nRun < 128)
+            nRun++;
+
+        if(nRun >= 2) {
+            out.push_back((unsigned char)(0x7F + nRun));
+            i += nRun;
+            continue;
+        }
+
+        // Literals up to the next pair of zeros
+        size_t nStart = i;
+        while(i < delta.size() && i - nStart < 128 &&
+              !(delta[i] == 0 && i + 1 < delta.size() && delta[i + 1] == 0))
+            i++;
+
+        out.push_back((unsigned char)(i - nStart - 1));
+        out.insert(out.end(), delta.begin() + nStart, delta.begin() + i);
+    }
+}
+
+void SnapshotStore::Unpack(const unsigned char *pPacked, size_t nSize, const double *pKey, double *pState) const
+{
+    std::vector<unsigned char> delta(nDoubles * sizeof(double), 0);
+    size_t iOut = 0;
+
+    for(size_t i = 0; i < nSize && iOut < delta.size(); ) {
+        unsigned char control = pPacked[i++];
+        if(control >= 0x80) {
+            iOut += control - 0x7F;
+        }
+        else {
+            size_t nCount = control + 1;
+            if(i + nCount > nSize || iOut + nCount > delta.size())
+                break;
+            memcpy(&delta[iOut], &pPacked[i], nCount);
+            i += nCount;
+            iOut += nCount;
+        }
+    }
+
+    for(int i = 0; i < nDoubles; i++) {
+        uint64_t a, b;
+        memcpy(&a, &delta[i * sizeof(double)], sizeof(a));
+        memcpy(&b, &pKey[i], sizeof(b));
+        a ^= b;
+        memcpy(&pState[i], &a, sizeof(a));
+    }
+}
+
+void SnapshotStore::Capture(double dTime, const double *pState)
+{
+    if(GetSnapshotCount() != 0 && dTime <= GetLatestTime())
+        DiscardFrom(dTime);
+
+    Record record;
+    record.dTime = dTime;
+
+    if(nSinceKey >= SNAPSHOT_KEY_INTERVAL) {
+        record.bKeyframe = true;
+        record.packed.resize(nDoubles * sizeof(double));
+        memcpy(&record.packed[0], pState, nDoubles * sizeof(double));
+        memcpy(&keyState[0], pState, nDoubles * sizeof(double));
+        nSinceKey = 1;
+    }
+    else {
+        record.bKeyframe = false;
+        Pack(pState, &keyState[0], record.packed);
+        nSinceKey++;
+    }
+
+    memory.push_back(record);
+
+    while(int(memory.size()) > nMaxSnapshots)
+        EvictGroup();
+}
+
+// Drop the oldest group from memory, onto disk if there is a file
+void SnapshotStore::EvictGroup(void)
+{
+    do {
+        const Record &record = memory.front();
+
+        if(pFile != NULL) {
+            fseek(pFile, 0, SEEK_END);
+
+            SnapshotFileRecord header;
+            header.dTime = record.dTime;
+            header.nPackedSize = uint32_t(record.packed.size());
+            header.bKeyframe = record.bKeyframe ? 1 : 0;
+            fwrite(&header, sizeof(header), 1, pFile);
+
+            DiskEntry entry;
+            entry.dTime = record.dTime;
+            entry.bKeyframe = record.bKeyframe;
+            entry.lOffset = ftell(pFile);
+            entry.nPackedSize = header.nPackedSize;
+            fwrite(&record.packed[0], 1, record.packed.size(), pFile);
+
+            if(record.bKeyframe) {
+                lLastKeyOffset = entry.lOffset;
+                nLastKeySize = entry.nPackedSize;
+            }
+            entry.lKeyOffset = lLastKeyOffset;
+            entry.nKeySize = nLastKeySize;
+            diskIndex.push_back(entry);
+        }
+
+        memory.pop_front();
+    } while(!memory.empty() && !memory.front().bKeyframe);
+
+    if(pFile != NULL)
+        fflush(pFile);
+}
+
+void SnapshotStore::DiscardFrom(double dTime)
+{
+    while(!memory.empty() && memory.back().dTime >= dTime)
+        memory.pop_back();
+
+    if(memory.empty())
+        while(!diskIndex.empty() && diskIndex.back().dTime >= dTime)
+            diskIndex.pop_back();
+
+    // Whatever comes next starts a fresh group
+    nSinceKey = SNAPSHOT_KEY_INTERVAL;
+}
+
+bool SnapshotStore::ReadDisk(long lOffset, unsigned nSize, std::vector<unsigned char> &out)
+{
+    out.resize(nSize);
+    return fseek(pFile, lOffset, SEEK_SET) == 0 && fread(&out[0], 1, nSize, pFile) == nSize;
+}
+
+bool SnapshotStore::Restore(double dTime, double &dSnapshotTime, double *pState)
+{
+    // Newest first, memory before disk
+    for(int i = int(memory.size()) - 1; i >= 0; i--) {
+        if(memory[i].dTime > dTime)
+            continue;
+
+        int iKey = i;
+        while(!memory[iKey].bKeyframe)
+            iKey--;
+
+        const double *pKey = (const double *)&memory[iKey].packed[0];
+        if(iKey == i)
+            memcpy(pState, pKey, nDoubles * sizeof(double));
+        else
+            Unpack(&memory[i].packed[0], memory[i].packed.size(), pKey, pState);
+
+        dSnapshotTime = memory[i].dTime;
+        return true;
+    }
+
+    if(pFile == NULL)
+        return false;
+
+    for(int i = int(diskIndex.size()) - 1; i >= 0; i--) {
+        const DiskEntry &entry = diskIndex[i];
+        if(entry.dTime > dTime)
+            continue;
+
+        std::vector<unsigned char> key, packed;
+        if(!ReadDisk(entry.lKeyOffset, entry.nKeySize, key) || key.size() != nDoubles * sizeof(double))
+            return false;
+
+        std::vector<double> keyDoubles(nDoubles);
+        memcpy(&keyDoubles[0], &key[0], key.size());
+
+        if(entry.bKeyframe)
+            memcpy(pState, &keyDoubles[0], nDoubles * sizeof(double));
+        else {
+            if(!ReadDisk(entry.lOffset, entry.nPackedSize, packed))
+                return false;
+            Unpack(&packed[0], packed.size(), &keyDoubles[0], pState);
+        }
+
+        dSnapshotTime = entry.dTime;
+        return true;
+    }
+
+    return false;
+}
+
+double SnapshotStore::GetLatestTime(void) const
+{
+    if(!memory.empty())
+        return memory.back().dTime;
+    if(!diskIndex.empty())
+        return diskIndex.back().dTime;
+    return -1.0;
+}
+
+size_t SnapshotStore::GetMemoryBytes(void) const
+{
+    size_t nBytes = 0;
+    for(size_t i = 0; i < memory.size(); i++)
+        nBytes += sizeof(Record) + memory[i].packed.size();
+
+    return nBytes + diskIndex.size() * sizeof(DiskEntry);
+}
@@ -0,0 +1,80 @@
+// Snapshot.h
+// Periodic, compressed snapshots of the simulation state for seeking.
+//
+// The state is an opaque array of doubles supplied by the caller. Snapshots
+// are grouped: every group starts with a keyframe, the rest of the group is
+// XORed against that keyframe and run-length packed, so any snapshot can be
+// restored from at most two records. Recent groups stay in memory; groups that
+// age out of the ring are appended to an optional file and can still be
+// restored from there.
+
+#ifndef __SOLAR_SNAPSHOT
+#define __SOLAR_SNAPSHOT
+
+#include <stdio.h>
+#include <vector>
+#include <deque>
+
+#define SNAPSHOT_MAGIC          "SOLSNAP1"
+#define SNAPSHOT_KEY_INTERVAL   16      // Snapshots per group
+
+class SnapshotStore
+    {
+    public:
+        SnapshotStore(int nStateDoubles, int nMaxSnapshots = 1024);
+        ~SnapshotStore(void);
+
+        // Spill evicted groups to this file. Optional.
+        bool OpenFile(const char *szFileName);
+
+        // Record the state at dTime. Recording a time at or before the newest
+        // snapshot forks the timeline and drops everything after it.
+        void Capture(double dTime, const double *pState);
+
+        // Restore the newest snapshot at or before dTime.
+        // Returns false if there is none.
+        bool Restore(double dTime, double &dSnapshotTime, double *pState);
+
+        // Time of the newest snapshot, or a negative number if there is none
+        double GetLatestTime(void) const;
+
+        int GetSnapshotCount(void) const { return int(memory.size() + diskIndex.size()); }
+        size_t GetMemoryBytes(void) const;
+
+    protected:
+        struct Record
+            {
+            double                      dTime;
+            bool                        bKeyframe;
+            std::vector<unsigned char>  packed;     // Keyframe: raw. Delta: XOR vs keyframe, RLE.
+            };
+
+        struct DiskEntry
+            {
+            double      dTime;
+            bool        bKeyframe;
+            long        lOffset;        // Start of the packed bytes
+            unsigned    nPackedSize;
+            long        lKeyOffset;     // Keyframe record this one depends on
+            unsigned    nKeySize;
+            };
+
+        void Pack(const double *pState, const double *pKey, std::vector<unsigned char> &out) const;
+        void Unpack(const unsigned char *pPacked, size_t nSize, const double *pKey, double *pState) const;
+        void EvictGroup(void);
+        void DiscardFrom(double dTime);
+        bool ReadDisk(long lOffset, unsigned nSize, std::vector<unsigned char> &out);
+
+        int                         nDoubles;
+        int                         nMaxSnapshots;
+        std::deque<Record>          memory;
+        std::vector<double>         keyState;       // Unpacked keyframe of the newest group
+        int                         nSinceKey;
+
+        FILE                        *pFile;
+        std::vector<DiskEntry>      diskIndex;
+        long                        lLastKeyOffset;
+        unsigned                    nLastKeySize;
+    };
+
+#endif
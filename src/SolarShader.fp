@@ -1,16 +1,126 @@
 #version 330
 
+// Features as listed in SolarShader.vp
+
 uniform sampler2D colorMap;
+uniform vec3	vLightPosition;
+
+#ifdef ATMOSPHERE
+uniform vec3	vAtmosphereColor;
+#endif
+
+#ifndef OBSERVER_LIGHT
+// Shadows, all in eye space. The light is the Sun, a sphere of fSunRadius;
+// occluders are spheres (center, radius) between it and this body, the body
+// itself first. A ring around the body has its center, normal and radii
+// (inner, outer, opacity).
+uniform float	fSunRadius;
+uniform vec4	vOccluders[8];
+uniform int		nOccluders;
+#ifdef RING_SHADOW
+uniform vec3	vRingCenter;
+uniform vec3	vRingNormal;
+uniform vec3	vRingShadow;
+#endif
 
-in float lightIntensity;
-in vec4 vVaryingTexCoords;
+// A surface skips the body itself; a ring is shadowed by it
+#ifdef DOUBLE_LAYER
+#define FIRST_OCCLUDER	0
+#else
+#define FIRST_OCCLUDER	1
+#endif
+#endif
+
+smooth in vec2 vVaryingTexCoords;
+smooth in vec3 vVaryingPosition;
+#if defined(PER_PIXEL) || defined(ATMOSPHERE)
+smooth in vec3 vVaryingNormal;
+#endif
+#ifndef PER_PIXEL
+smooth in float lightIntensity;
+#endif
 
 // Output fragment color
 out vec4 vFragColor;
 
+#ifndef OBSERVER_LIGHT
+// How much of the Sun's disc the sphere leaves uncovered, seen from
+// vPosition: the two discs' angular radii and separation, with the overlap
+// ramped linearly across the penumbra
+float SphereLight(vec3 vPosition, vec3 vToSun, float fSunDistance, vec4 vOccluder)
+{
+	vec3 vToOccluder = vOccluder.xyz - vPosition;
+	float fDistance = length(vToOccluder);
+	if(fDistance <= vOccluder.w || fDistance >= fSunDistance || dot(vToOccluder, vToSun) <= 0.0)
+		return 1.0;
+
+	float fSun = asin(min(fSunRadius / fSunDistance, 1.0));
+	float fOccluder = asin(vOccluder.w / fDistance);
+	float fApart = acos(clamp(dot(vToOccluder / fDistance, vToSun), -1.0, 1.0));
+
+	float fCovered = clamp((fSun + fOccluder - fApart) / (2.0 * min(fSun, fOccluder)), 0.0, 1.0);
+	float fMost = min(1.0, (fOccluder * fOccluder) / (fSun * fSun));
+	return 1.0 - fCovered * fMost;
+}
+
+#ifdef RING_SHADOW
+// Light let through the ring on the way to the Sun's center
+float RingLight(vec3 vPosition, vec3 vToSun, float fSunDistance)
+{
+	float fFacing = dot(vToSun, vRingNormal);
+	if(abs(fFacing) < 1e-5)
+		return 1.0;
+	float t = dot(vRingCenter - vPosition, vRingNormal) / fFacing;
+	if(t <= 0.0 || t >= fSunDistance)
+		return 1.0;
+	float fRadius = length(vPosition + t * vToSun - vRingCenter);
+	return (fRadius > vRingShadow.x && fRadius < vRingShadow.y) ? 1.0 - vRingShadow.z : 1.0;
+}
+#endif
+#endif
+
 void main(void)
 { 
+#ifdef OBSERVER_LIGHT
+	vec3 vLightDir = normalize(-vVaryingPosition);
+#else
+	vec3 vLightDir = vLightPosition - vVaryingPosition;
+	float fSunDistance = length(vLightDir);
+	vLightDir /= fSunDistance;
+#endif
+
+#if defined(PER_PIXEL) || defined(ATMOSPHERE)
+	vec3 vNormal = normalize(vVaryingNormal);
+#endif
+#ifdef PER_PIXEL
+#ifdef DOUBLE_LAYER
+	float fIntensity = abs(dot(vNormal, vLightDir));
+#else
+	float fIntensity = max(0.0, dot(vNormal, vLightDir));
+#endif
+#else
+	float fIntensity = lightIntensity;
+#endif
+
+	float fShadow = 1.0;
+#ifndef OBSERVER_LIGHT
+	if(fIntensity > 0.0) {
+		for(int i = FIRST_OCCLUDER; i < nOccluders; i++)
+			fShadow *= SphereLight(vVaryingPosition, vLightDir, fSunDistance, vOccluders[i]);
+#ifdef RING_SHADOW
+		fShadow *= RingLight(vVaryingPosition, vLightDir, fSunDistance);
+#endif
+	}
+#endif
+
 	vec4 vTmpColor = texture(colorMap, vVaryingTexCoords.st);
-	vFragColor.rgb = vTmpColor.rgb * lightIntensity;
+	vFragColor.rgb = vTmpColor.rgb * fIntensity * fShadow;
+
+#ifdef ATMOSPHERE
+	// Thickest seen edge on, and reaching a little past the terminator
+	float fEdge = 1.0 - max(0.0, dot(vNormal, normalize(-vVaryingPosition)));
+	float fDay = smoothstep(-0.25, 0.35, dot(vNormal, vLightDir));
+	vFragColor.rgb += vAtmosphereColor * (fEdge * fEdge * fEdge) * fDay * fShadow;
+#endif
 	vFragColor.a = 1.0f;
-}
\ No newline at end of file
+}
@@ -0,0 +1,121 @@
+// SphereLod.cpp
+// A sphere at several tessellations, picked per frame by how big it is on
+// screen.
+
+#include "SphereLod.h"
+
+#include <GLProfiler.h>
+
+#include <math.h>
+#include <string.h>
+
+SphereLod::SphereLod(void) : fRadius(0.0f), iLevel(0)
+{
+    memset(levels, 0, sizeof(levels));
+}
+
+SphereLod::~SphereLod(void)
+{
+    Release();
+}
+
+void SphereLod::Build(float fSphereRadius)
+{
+    GLT_PROFILE_FUNCTION();
+
+    Release();
+    fRadius = fSphereRadius;
+
+    std::vector<float> meshVertices;
+    std::vector<GLushort> meshIndexes;
+    for(int i = 0; i < SPHERE_LOD_LEVELS; i++) {
+        meshVertices.clear();
+        meshIndexes.clear();
+        MakeMesh(fRadius, GetSlices(i), GetSlices(i) / 2, meshVertices, meshIndexes);
+
+        Level &level = levels[i];
+        level.nIndexes = GLsizei(meshIndexes.size());
+        glGenVertexArrays(1, &level.vertexArray);
+        glGenBuffers(2, level.buffers);
+        glBindVertexArray(level.vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, level.buffers[0]);
+        glBufferData(GL_ARRAY_BUFFER, meshVertices.size() * sizeof(float), &meshVertices[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(GLT_ATTRIBUTE_VERTEX);
+        glVertexAttribPointer(GLT_ATTRIBUTE_VERTEX, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(GLT_ATTRIBUTE_NORMAL);
+        glVertexAttribPointer(GLT_ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
+        glEnableVertexAttribArray(GLT_ATTRIBUTE_TEXTURE0);
+        glVertexAttribPointer(GLT_ATTRIBUTE_TEXTURE0, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, level.buffers[1]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshIndexes.size() * sizeof(GLushort), &meshIndexes[0], GL_STATIC_DRAW);
+        glBindVertexArray(0);
+    }
+
+    // Until the first Select(), something in the middle
+    iLevel = SPHERE_LOD_LEVELS / 2;
+}
+
+void SphereLod::Draw(void)
+{
+    const Level &level = levels[iLevel];
+    glBindVertexArray(level.vertexArray);
+    glDrawElements(GL_TRIANGLES, level.nIndexes, GL_UNSIGNED_SHORT, 0);
+    gltCountStateChange();
+    gltCountDraw(GL_TRIANGLES, level.nIndexes);
+    glBindVertexArray(0);
+}
+
+void SphereLod::Release(void)
+{
+    for(int i = 0; i < SPHERE_LOD_LEVELS; i++) {
+        if(levels[i].vertexArray != 0) {
+            glDeleteVertexArrays(1, &levels[i].vertexArray);
+            glDeleteBuffers(2, levels[i].buffers);
+        }
+    }
+    memset(levels, 0, sizeof(levels));
+}
+
+void SphereLod::MakeMesh(float fSphereRadius, int nSlices, int nStacks,
+                         std::vector<float> &meshVertices, std::vector<GLushort> &meshIndexes)
+{
+    GLushort nFirst = GLushort(meshVertices.size() / 8);
+
+    float drho = float(M3D_PI) / float(nStacks);
+    float dtheta = 2.0f * float(M3D_PI) / float(nSlices);
+    for(int i = 0; i <= nStacks; i++) {
+        float rho = float(i) * drho;
+        for(int j = 0; j <= nSlices; j++) {
+            float theta = (j == nSlices) ? 0.0f : float(j) * dtheta;
+            float x = -sinf(theta) * sinf(rho);
+            float y = cosf(theta) * sinf(rho);
+            float z = cosf(rho);
+            float vVertex[8] = { x * fSphereRadius, y * fSphereRadius, z * fSphereRadius, x, y, z,
+                                 float(j) / float(nSlices), 1.0f - float(i) / float(nStacks) };
+            meshVertices.insert(meshVertices.end(), vVertex, vVertex + 8);
+        }
+    }
+
+    // Wound the way gltMakeSphere() winds its triangles
+    for(int i = 0; i < nStacks; i++)
+        for(int j = 0; j < nSlices; j++) {
+            GLushort a = GLushort(nFirst + i * (nSlices + 1) + j);
+            GLushort b = GLushort(a + nSlices + 1);
+            GLushort vIndexes[6] = { a, b, GLushort(a + 1), b, GLushort(b + 1), GLushort(a + 1) };
+            meshIndexes.insert(meshIndexes.end(), vIndexes, vIndexes + 6);
+        }
+}
+
+float SphereLod::GetError(int iLevel, float fPixels)
+{
+    return fPixels * (1.0f - cosf(float(M3D_PI) / float(GetSlices(iLevel))));
+}
+
+void SphereLod::Select(float fPixels)
+{
+    while(iLevel < SPHERE_LOD_LEVELS - 1 && GetError(iLevel, fPixels) > SPHERE_LOD_MAX_ERROR)
+        iLevel++;
+
+    while(iLevel > 0 && GetError(iLevel - 1, fPixels) < SPHERE_LOD_MAX_ERROR * SPHERE_LOD_HYSTERESIS)
+        iLevel--;
+}
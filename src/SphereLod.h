@@ -0,0 +1,69 @@
+// SphereLod.h
+// A sphere at several tessellations, picked per frame by how big it is on
+// screen.
+//
+// Level i has SPHERE_LOD_MIN_SLICES << i slices and half as many stacks. A
+// polygon with n sides misses the true outline by r (1 - cos(pi / n)), so the
+// coarsest level whose miss stays under SPHERE_LOD_MAX_ERROR pixels is
+// enough. To keep a body hovering at a boundary from flipping level every
+// frame, a finer level is only given up once the coarser one would do with
+// room to spare.
+//
+// The levels are indexed latitude/longitude grids built directly, as
+// gltMakeSphere() lays them out but without GLTriangleBatch's search for
+// duplicate vertices, which is quadratic in the vertex count.
+
+#ifndef __SOLAR_SPHERE_LOD
+#define __SOLAR_SPHERE_LOD
+
+#include <GLTools.h>
+
+#include <vector>
+
+#define SPHERE_LOD_LEVELS       5
+#define SPHERE_LOD_MIN_SLICES   8           // 8 x 4 up to 128 x 64
+#define SPHERE_LOD_MAX_ERROR    0.5f        // Pixels
+#define SPHERE_LOD_HYSTERESIS   0.6f        // Drop a level when the coarser one is under this much of the limit
+
+class SphereLod
+    {
+    public:
+        SphereLod(void);
+        ~SphereLod(void);
+
+        // Needs a current context
+        void Build(float fSphereRadius);
+
+        // Choose the level for a sphere fPixels in radius on screen
+        void Select(float fPixels);
+
+        void Draw(void);
+
+        float GetRadius(void) const { return fRadius; }
+        int GetLevel(void) const { return iLevel; }
+        static int GetSlices(int iLevel) { return SPHERE_LOD_MIN_SLICES << iLevel; }
+
+        // Worst outline error of a level, in pixels, for a sphere fPixels in radius
+        static float GetError(int iLevel, float fPixels);
+
+        // A sphere with gltMakeSphere()'s vertices, normals and texture
+        // coordinates, 8 floats a vertex, indexed as a grid of triangles
+        static void MakeMesh(float fSphereRadius, int nSlices, int nStacks,
+                             std::vector<float> &meshVertices, std::vector<GLushort> &meshIndexes);
+
+    protected:
+        struct Level
+            {
+            GLuint      vertexArray;
+            GLuint      buffers[2];     // Vertices, indexes
+            GLsizei     nIndexes;
+            };
+
+        void Release(void);
+
+        Level               levels[SPHERE_LOD_LEVELS];
+        float               fRadius;
+        int                 iLevel;
+    };
+
+#endif
@@ -0,0 +1,77 @@
+// SphereRayCaster.cpp
+// Spheres drawn exactly, by ray casting, instead of from a tessellated mesh.
+
+#include "SphereRayCaster.h"
+
+#include <GLShaderManager.h>
+#include <GLProfiler.h>
+
+bool SphereRayCaster::Init(void)
+{
+    shader = gltLoadShaderPairWithAttributes("src/RayCastShader.vp", "src/RayCastShader.fp", 1,
+                                             GLT_ATTRIBUTE_VERTEX, "vCorner");
+    if(shader == 0)
+        return false;
+
+    locModelView = glGetUniformLocation(shader, "mvMatrix");
+    locProjection = glGetUniformLocation(shader, "pMatrix");
+    locRadius = glGetUniformLocation(shader, "fRadius");
+    locLight = glGetUniformLocation(shader, "vLightPosition");
+    locObserverLight = glGetUniformLocation(shader, "bObserverLight");
+    locLit = glGetUniformLocation(shader, "bLit");
+    glUseProgram(shader);
+    glUniform1i(glGetUniformLocation(shader, "colorMap"), 0);
+
+    // The quad's corners; the vertex shader places them
+    static const GLfloat vCorners[] = { -1.0f, -1.0f,  1.0f, -1.0f,  1.0f, 1.0f,  -1.0f, 1.0f };
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(1, &buffer);
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vCorners), vCorners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(GLT_ATTRIBUTE_VERTEX);
+    glVertexAttribPointer(GLT_ATTRIBUTE_VERTEX, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glBindVertexArray(0);
+    return true;
+}
+
+void SphereRayCaster::Shutdown(void)
+{
+    if(shader != 0)
+        glDeleteProgram(shader);
+    if(buffer != 0)
+        glDeleteBuffers(1, &buffer);
+    if(vertexArray != 0)
+        glDeleteVertexArrays(1, &vertexArray);
+    shader = buffer = vertexArray = 0;
+}
+
+bool SphereRayCaster::Draw(const M3DMatrix44f mModelView, const M3DMatrix44f mProjection, float fRadius,
+                           const M3DVector3f vLight, bool bObserverLight, bool bLit)
+{
+    if(shader == 0)
+        return false;
+
+    // Near and far from the perspective projection, and the sphere's depth
+    // range in front of the eye
+    float fNear = mProjection[14] / (mProjection[10] - 1.0f);
+    float fFar = mProjection[14] / (mProjection[10] + 1.0f);
+    float fDepth = -mModelView[14];
+    if(fDepth - fRadius <= fNear || fDepth + fRadius >= fFar)
+        return false;
+
+    glUseProgram(shader);
+    glUniformMatrix4fv(locModelView, 1, GL_FALSE, mModelView);
+    glUniformMatrix4fv(locProjection, 1, GL_FALSE, mProjection);
+    glUniform1f(locRadius, fRadius);
+    glUniform3fv(locLight, 1, vLight);
+    glUniform1i(locObserverLight, bObserverLight);
+    glUniform1i(locLit, bLit);
+    gltCountStateChange();
+
+    glBindVertexArray(vertexArray);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glBindVertexArray(0);
+    gltCountDraw(GL_TRIANGLE_FAN, 4);
+    return true;
+}
@@ -0,0 +1,49 @@
+// SphereRayCaster.h
+// Spheres drawn exactly, by ray casting, instead of from a tessellated mesh.
+//
+// Each sphere is one screen-facing quad just big enough to cover it: set in
+// the plane through its center, facing the eye, and as wide as the cone from
+// the eye that touches the sphere. The fragment shader intersects the ray
+// through each pixel with the sphere, discards the misses and from the hit
+// works out the depth, the normal, and the texture coordinates gltMakeSphere()
+// would have given that point. Four vertices a sphere however close it is,
+// and a silhouette that stays round at any zoom.
+//
+// The quad must lie between the near and far planes, so a sphere reaching
+// past either (or around the eye) is left to the mesh: Draw() says so.
+
+#ifndef __SOLAR_SPHERE_RAY_CASTER
+#define __SOLAR_SPHERE_RAY_CASTER
+
+#include <GLTools.h>
+
+class SphereRayCaster
+    {
+    public:
+        SphereRayCaster(void) : shader(0), vertexArray(0), buffer(0) {}
+
+        // Needs a current context
+        bool Init(void);
+        void Shutdown(void);
+
+        // The sphere of fRadius centered where mModelView (rigid) puts the
+        // origin, textured from unit 0 the way gltMakeSphere() maps it. vLight
+        // is in eye space; unlit spheres (the Sun) show the texture as it is.
+        // False, drawing nothing, when the mesh has to do.
+        bool Draw(const M3DMatrix44f mModelView, const M3DMatrix44f mProjection, float fRadius,
+                  const M3DVector3f vLight, bool bObserverLight, bool bLit);
+
+    protected:
+        GLuint      shader;
+        GLint       locModelView;
+        GLint       locProjection;
+        GLint       locRadius;
+        GLint       locLight;
+        GLint       locObserverLight;
+        GLint       locLit;
+
+        GLuint      vertexArray;
+        GLuint      buffer;
+    };
+
+#endif
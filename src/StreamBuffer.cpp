@@ -0,0 +1,147 @@
+// StreamBuffer.cpp
+// A ring of per-frame regions in one buffer object, for data written afresh
+// every frame.
+
+#include "StreamBuffer.h"
+
+#include <GLProfiler.h>
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT       0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT         0x0080
+#endif
+
+typedef void (GLAPIENTRY *PFNBUFFERSTORAGE)(GLenum eTarget, GLsizeiptr nSize, const GLvoid *pData, GLbitfield nFlags);
+
+StreamBuffer::StreamBuffer(void) : buffer(0), nFrameSize(0), bPersistent(false), pMemory(NULL),
+                                   iRegion(0), nUsed(0), nFlushed(0)
+{
+    for(int i = 0; i < STREAM_FRAMES; i++)
+        fences[i] = NULL;
+}
+
+bool StreamBuffer::Init(GLsizeiptr nSize)
+{
+    Shutdown();
+
+    nFrameSize = (nSize + STREAM_REGION_ALIGN - 1) & ~GLsizeiptr(STREAM_REGION_ALIGN - 1);
+    GLsizeiptr nTotal = nFrameSize * STREAM_FRAMES;
+
+    GLint nMajor = 0, nMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &nMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &nMinor);
+    PFNBUFFERSTORAGE pBufferStorage = NULL;
+    if(nMajor > 4 || (nMajor == 4 && nMinor >= 4))
+        pBufferStorage = (PFNBUFFERSTORAGE)gltGetProcAddress("glBufferStorage");
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if(pBufferStorage != NULL) {
+        const GLbitfield nFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        pBufferStorage(GL_ARRAY_BUFFER, nTotal, NULL, nFlags);
+        pMemory = (GLubyte *)glMapBufferRange(GL_ARRAY_BUFFER, 0, nTotal, nFlags);
+        bPersistent = (pMemory != NULL);
+    }
+    if(!bPersistent) {
+        // The storage is immutable once given, so start again without it
+        if(pBufferStorage != NULL) {
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        }
+        glBufferData(GL_ARRAY_BUFFER, nTotal, NULL, GL_STREAM_DRAW);
+        mirror.resize(nTotal);
+        pMemory = &mirror[0];
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The first BeginFrame() moves on to region 0
+    iRegion = STREAM_FRAMES - 1;
+    nUsed = nFrameSize;
+    nFlushed = nFrameSize;
+    return buffer != 0;
+}
+
+void StreamBuffer::Shutdown(void)
+{
+    for(int i = 0; i < STREAM_FRAMES; i++) {
+        if(fences[i] != NULL)
+            glDeleteSync(fences[i]);
+        fences[i] = NULL;
+    }
+
+    if(buffer != 0) {
+        if(bPersistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    nFrameSize = 0;
+    bPersistent = false;
+    pMemory = NULL;
+    mirror.clear();
+}
+
+void StreamBuffer::BeginFrame(void)
+{
+    GLT_PROFILE_FUNCTION();
+
+    iRegion = (iRegion + 1) % STREAM_FRAMES;
+    nUsed = 0;
+    nFlushed = 0;
+
+    GLsync fence = fences[iRegion];
+    if(fence == NULL)
+        return;
+
+    // Normally signalled long ago; if not, flush once so it can be
+    GLbitfield nFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while(glClientWaitSync(fence, nFlags, 1000000000) == GL_TIMEOUT_EXPIRED)
+        nFlags = 0;
+    glDeleteSync(fence);
+    fences[iRegion] = NULL;
+}
+
+void *StreamBuffer::Allocate(GLsizeiptr nSize, GLintptr &nOffset, GLsizeiptr nAlignment)
+{
+    GLsizeiptr nBase = nFrameSize * iRegion;
+    GLsizeiptr nStart, nEnd;
+    GLsizeiptr nOld = nUsed.load(std::memory_order_relaxed);
+    do {
+        // Aligned within the buffer; regions start at STREAM_REGION_ALIGN
+        nStart = ((nBase + nOld + nAlignment - 1) & ~(nAlignment - 1)) - nBase;
+        nEnd = nStart + nSize;
+        if(nEnd > nFrameSize)
+            return NULL;
+    } while(!nUsed.compare_exchange_weak(nOld, nEnd, std::memory_order_relaxed));
+
+    nOffset = nBase + nStart;
+    return pMemory + nOffset;
+}
+
+void StreamBuffer::Flush(void)
+{
+    // A coherent mapping needs nothing; the fences keep us off the GPU's
+    // data. Threads that wrote must have been joined by now.
+    GLsizeiptr nEnd = nUsed.load(std::memory_order_relaxed);
+    if(bPersistent || nEnd <= nFlushed)
+        return;
+
+    GLintptr nOffset = nFrameSize * iRegion + nFlushed;
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, nOffset, nEnd - nFlushed, pMemory + nOffset);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    nFlushed = nEnd;
+}
+
+void StreamBuffer::EndFrame(void)
+{
+    if(fences[iRegion] != NULL)
+        glDeleteSync(fences[iRegion]);
+    fences[iRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
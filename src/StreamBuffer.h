@@ -0,0 +1,74 @@
+// StreamBuffer.h
+// A ring of per-frame regions in one buffer object, for data written afresh
+// every frame.
+//
+// With GL 4.4 buffer storage the buffer is mapped once, persistent and
+// coherent, and stays mapped: Allocate() returns pointers straight into it,
+// so writing the data is the upload. No glBufferData orphaning, no
+// glBufferSubData copy, no map and unmap per frame. The ring has
+// STREAM_FRAMES regions and a fence goes in behind each frame's reads;
+// BeginFrame() waits on the fence of the region it is about to reuse, so the
+// CPU never overwrites what the GPU is still reading and the driver has
+// nothing to synchronize behind our back. Three regions deep, that wait
+// almost never blocks.
+//
+// Allocate() may be called from several threads at once, so workers can
+// write their part of a frame in place. Every write must be finished before
+// Flush(), and the draws that read them come after it.
+//
+// Without buffer storage the regions are mirrored in system memory and
+// Flush() copies what the frame allocated up with one glBufferSubData, into
+// a region the fences say the GPU is done with.
+
+#ifndef __SOLAR_STREAM_BUFFER
+#define __SOLAR_STREAM_BUFFER
+
+#include <GLTools.h>
+
+#include <atomic>
+#include <vector>
+
+#define STREAM_FRAMES           3
+#define STREAM_REGION_ALIGN     256     // Region starts, enough for any buffer binding offset
+
+class StreamBuffer
+    {
+    public:
+        StreamBuffer(void);
+
+        // Needs a current context. nFrameSize bytes per frame. Calling it
+        // again replaces the buffer, e.g. to grow it between frames.
+        bool Init(GLsizeiptr nFrameSize);
+        void Shutdown(void);
+
+        GLuint GetBuffer(void) const { return buffer; }
+        GLsizeiptr GetFrameSize(void) const { return nFrameSize; }
+        bool IsPersistent(void) const { return bPersistent; }
+
+        // Move to the next region, waiting for the GPU to finish with it
+        void BeginFrame(void);
+
+        // nSize bytes of this frame's region starting at a multiple of
+        // nAlignment (a power of two), and their offset into the buffer.
+        // NULL if the region is full.
+        void *Allocate(GLsizeiptr nSize, GLintptr &nOffset, GLsizeiptr nAlignment = 16);
+
+        // After the writes, before the draws that read them
+        void Flush(void);
+
+        // After the last command that reads this frame's region
+        void EndFrame(void);
+
+    protected:
+        GLuint                      buffer;
+        GLsizeiptr                  nFrameSize;         // Rounded up to STREAM_REGION_ALIGN
+        bool                        bPersistent;
+        GLubyte                     *pMemory;           // The mapping, or the system memory mirror
+        std::vector<GLubyte>        mirror;
+        GLsync                      fences[STREAM_FRAMES];
+        int                         iRegion;
+        std::atomic<GLsizeiptr>     nUsed;              // Bytes handed out in this region
+        GLsizeiptr                  nFlushed;
+    };
+
+#endif
@@ -0,0 +1,34 @@
+// TimeWarp.cpp
+// Simulation clock with discrete time-scale tiers.
+
+#include "TimeWarp.h"
+
+#include <math.h>
+
+double TimeWarp::Advance(double dRealSeconds)
+{
+    if(dRealSeconds < 0.0)
+        dRealSeconds = 0.0;
+    if(dRealSeconds > TIMEWARP_MAX_FRAME_SECONDS)
+        dRealSeconds = TIMEWARP_MAX_FRAME_SECONDS;
+
+    dLastDelta = bPaused ? 0.0 : dRealSeconds * GetScale();
+    dSimTime += dLastDelta;
+
+    return dLastDelta;
+}
+
+void TimeWarp::SetTier(int iNewTier)
+{
+    if(iNewTier < 0)
+        iNewTier = 0;
+    if(iNewTier >= TIMEWARP_TIER_COUNT)
+        iNewTier = TIMEWARP_TIER_COUNT - 1;
+
+    iTier = iNewTier;
+}
+
+double TimeWarp::GetScale(void) const
+{
+    return pow(10.0, iTier);
+}
@@ -0,0 +1,53 @@
+// TimeWarp.h
+// Simulation clock with discrete time-scale tiers, from real time (1x)
+// up to 10^7x. The clock keeps simulation time in double precision so that
+// long warps do not erode the resolution of the animation.
+
+#ifndef __SOLAR_TIME_WARP
+#define __SOLAR_TIME_WARP
+
+#define TIMEWARP_TIER_COUNT     8       // 1x, 10x, ... 10^7x
+
+// Longest real frame we honour. Anything longer (window drag, debugger) is
+// treated as this, so a stall never turns into a jump across the orbit.
+#define TIMEWARP_MAX_FRAME_SECONDS  0.25
+
+// Integrator substeps each body may spend per frame before it switches
+// to analytic propagation
+#define TIMEWARP_SUBSTEP_BUDGET     64
+
+class TimeWarp
+    {
+    public:
+        TimeWarp(void) : dSimTime(0.0), dLastDelta(0.0), iTier(0), bPaused(false) {}
+
+        // Feed in the real time that passed since the last frame. Returns the
+        // simulation time that passed, which is zero while paused.
+        double Advance(double dRealSeconds);
+
+        // Time scale
+        void SetTier(int iNewTier);
+        int GetTier(void) const { return iTier; }
+        void SpeedUp(void) { SetTier(iTier + 1); }
+        void SlowDown(void) { SetTier(iTier - 1); }
+        double GetScale(void) const;
+
+        // Pausing keeps the tier, so unpausing resumes at the same speed
+        void SetPaused(bool bPause) { bPaused = bPause; }
+        void TogglePaused(void) { bPaused = !bPaused; }
+        bool IsPaused(void) const { return bPaused; }
+
+        double GetSimTime(void) const { return dSimTime; }
+        void SetSimTime(double dTime) { dSimTime = dTime; dLastDelta = 0.0; }
+        double GetLastDelta(void) const { return dLastDelta; }
+
+        int GetSubstepBudget(void) const { return TIMEWARP_SUBSTEP_BUDGET; }
+
+    protected:
+        double  dSimTime;
+        double  dLastDelta;
+        int     iTier;
+        bool    bPaused;
+    };
+
+#endif
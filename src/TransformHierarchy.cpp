@@ -0,0 +1,163 @@
+// TransformHierarchy.cpp
+// Flat, parent-indexed transform hierarchy.
+
+#include "TransformHierarchy.h"
+
+#include <math.h>
+
+int TransformHierarchy::AddNode(int iParent)
+{
+    int iNode = int(parents.size());
+    if(iParent >= iNode)
+        iParent = TRANSFORM_NO_PARENT;    // Parents must come first
+
+    parents.push_back(iParent);
+    tx.push_back(0.0f); ty.push_back(0.0f); tz.push_back(0.0f);
+    qx.push_back(0.0f); qy.push_back(0.0f); qz.push_back(0.0f); qw.push_back(1.0f);
+    scales.push_back(1.0f);
+    dirty.push_back(1);
+    rebuilt.push_back(0);
+
+    Matrix identity;
+    m3dLoadIdentity44(identity.m);
+    worldMatrices.push_back(identity);
+
+    return iNode;
+}
+
+void TransformHierarchy::SetTranslation(int iNode, float x, float y, float z)
+{
+    if(tx[iNode] == x && ty[iNode] == y && tz[iNode] == z)
+        return;
+
+    tx[iNode] = x;
+    ty[iNode] = y;
+    tz[iNode] = z;
+    dirty[iNode] = 1;
+}
+
+void TransformHierarchy::SetRotation(int iNode, const M3DVector4f vQuat)
+{
+    if(qx[iNode] == vQuat[0] && qy[iNode] == vQuat[1] && qz[iNode] == vQuat[2] && qw[iNode] == vQuat[3])
+        return;
+
+    qx[iNode] = vQuat[0];
+    qy[iNode] = vQuat[1];
+    qz[iNode] = vQuat[2];
+    qw[iNode] = vQuat[3];
+    dirty[iNode] = 1;
+}
+
+void TransformHierarchy::SetRotation(int iNode, float fAngleDegrees, float x, float y, float z)
+{
+    M3DVector4f vQuat;
+    QuatFromAxisAngle(vQuat, fAngleDegrees, x, y, z);
+    SetRotation(iNode, vQuat);
+}
+
+void TransformHierarchy::AppendRotation(int iNode, float fAngleDegrees, float x, float y, float z)
+{
+    M3DVector4f vCurrent = { qx[iNode], qy[iNode], qz[iNode], qw[iNode] };
+    M3DVector4f vQuat, vResult;
+    QuatFromAxisAngle(vQuat, fAngleDegrees, x, y, z);
+    QuatMultiply(vResult, vCurrent, vQuat);
+    SetRotation(iNode, vResult);
+}
+
+void TransformHierarchy::SetScale(int iNode, float fScale)
+{
+    if(scales[iNode] == fScale)
+        return;
+
+    scales[iNode] = fScale;
+    dirty[iNode] = 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// One pass, parents before children. A node is rebuilt if it is dirty itself
+// or its parent was rebuilt earlier in this same pass.
+void TransformHierarchy::Update(void)
+{
+    int nNodes = int(parents.size());
+    nLastUpdated = 0;
+
+    for(int i = 0; i < nNodes; i++) {
+        int iParent = parents[i];
+        if(!dirty[i] && (iParent == TRANSFORM_NO_PARENT || !rebuilt[iParent])) {
+            rebuilt[i] = 0;
+            continue;
+        }
+
+        // Local matrix straight from the quaternion, no trig needed
+        float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+        float s = scales[i];
+        M3DMatrix44f local;
+
+        local[0] = (1.0f - 2.0f * (y * y + z * z)) * s;
+        local[1] = (2.0f * (x * y + w * z)) * s;
+        local[2] = (2.0f * (x * z - w * y)) * s;
+        local[3] = 0.0f;
+
+        local[4] = (2.0f * (x * y - w * z)) * s;
+        local[5] = (1.0f - 2.0f * (x * x + z * z)) * s;
+        local[6] = (2.0f * (y * z + w * x)) * s;
+        local[7] = 0.0f;
+
+        local[8] = (2.0f * (x * z + w * y)) * s;
+        local[9] = (2.0f * (y * z - w * x)) * s;
+        local[10] = (1.0f - 2.0f * (x * x + y * y)) * s;
+        local[11] = 0.0f;
+
+        local[12] = tx[i];
+        local[13] = ty[i];
+        local[14] = tz[i];
+        local[15] = 1.0f;
+
+        if(iParent == TRANSFORM_NO_PARENT)
+            m3dCopyMatrix44(worldMatrices[i].m, local);
+        else
+            m3dMatrixMultiply44(worldMatrices[i].m, worldMatrices[iParent].m, local);
+
+        dirty[i] = 0;
+        rebuilt[i] = 1;
+        nLastUpdated++;
+    }
+}
+
+void TransformHierarchy::GetWorldPosition(int iNode, M3DVector3f vPosition) const
+{
+    const M3DMatrix44f &m = worldMatrices[iNode].m;
+    vPosition[0] = m[12];
+    vPosition[1] = m[13];
+    vPosition[2] = m[14];
+}
+
+void TransformHierarchy::QuatFromAxisAngle(M3DVector4f vQuat, float fAngleDegrees, float x, float y, float z)
+{
+    float fLength = sqrtf(x * x + y * y + z * z);
+    if(fLength == 0.0f) {
+        vQuat[0] = vQuat[1] = vQuat[2] = 0.0f;
+        vQuat[3] = 1.0f;
+        return;
+    }
+
+    float fHalf = float(m3dDegToRad(fAngleDegrees)) * 0.5f;
+    float fSin = sinf(fHalf) / fLength;
+    vQuat[0] = x * fSin;
+    vQuat[1] = y * fSin;
+    vQuat[2] = z * fSin;
+    vQuat[3] = cosf(fHalf);
+}
+
+void TransformHierarchy::QuatMultiply(M3DVector4f vResult, const M3DVector4f a, const M3DVector4f b)
+{
+    float x = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+    float y = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+    float z = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+    float w = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+
+    vResult[0] = x;
+    vResult[1] = y;
+    vResult[2] = z;
+    vResult[3] = w;
+}
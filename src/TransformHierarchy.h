@@ -0,0 +1,72 @@
+// TransformHierarchy.h
+// Flat, parent-indexed transform hierarchy.
+//
+// Nodes are stored structure-of-arrays: local translation, rotation (unit
+// quaternion) and uniform scale each live in their own array, and parents
+// always come before their children. Update() walks the arrays once, front to
+// back, and rebuilds the world matrix only for nodes whose local transform
+// changed or whose parent was rebuilt in the same pass. Nothing that stood
+// still costs anything.
+
+#ifndef __SOLAR_TRANSFORM_HIERARCHY
+#define __SOLAR_TRANSFORM_HIERARCHY
+
+#include <math3d.h>
+#include <vector>
+
+#define TRANSFORM_NO_PARENT     -1
+
+class TransformHierarchy
+    {
+    public:
+        TransformHierarchy(void) : nLastUpdated(0) {}
+
+        // Add a node under iParent (or TRANSFORM_NO_PARENT). Returns its index.
+        int AddNode(int iParent);
+        int GetNodeCount(void) const { return int(parents.size()); }
+        int GetParent(int iNode) const { return parents[iNode]; }
+
+        // Local TRS. Setting a value equal to the current one does not dirty the node.
+        void SetTranslation(int iNode, float x, float y, float z);
+        void SetRotation(int iNode, const M3DVector4f vQuat);
+        void SetRotation(int iNode, float fAngleDegrees, float x, float y, float z);
+        void SetScale(int iNode, float fScale);
+
+        // Right-multiply the local rotation by another one. Handy for building
+        // constant orientations out of the same chain of rotations GLMatrixStack takes.
+        void AppendRotation(int iNode, float fAngleDegrees, float x, float y, float z);
+
+        // Rebuild world matrices for everything that changed
+        void Update(void);
+
+        const M3DMatrix44f& GetWorldMatrix(int iNode) const { return worldMatrices[iNode].m; }
+        // All world matrices, by node index, for batch processing
+        const M3DMatrix44f *GetWorldMatrices(void) const { return &worldMatrices[0].m; }
+
+        // World-space origin of a node
+        void GetWorldPosition(int iNode, M3DVector3f vPosition) const;
+
+        // Nodes rebuilt by the last Update()
+        int GetLastUpdatedCount(void) const { return nLastUpdated; }
+
+        // Quaternion helpers, (x, y, z, w) order
+        static void QuatFromAxisAngle(M3DVector4f vQuat, float fAngleDegrees, float x, float y, float z);
+        static void QuatMultiply(M3DVector4f vResult, const M3DVector4f a, const M3DVector4f b);
+
+    protected:
+        struct Matrix { M3DMatrix44f m; };
+
+        std::vector<int>            parents;
+
+        std::vector<float>          tx, ty, tz;
+        std::vector<float>          qx, qy, qz, qw;
+        std::vector<float>          scales;
+
+        std::vector<unsigned char>  dirty;      // Local transform changed since the last Update()
+        std::vector<unsigned char>  rebuilt;    // World matrix rebuilt in the current pass
+        std::vector<Matrix>         worldMatrices;
+
+        int                         nLastUpdated;
+    };
+
+#endif
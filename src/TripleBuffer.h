@@ -0,0 +1,51 @@
+// TripleBuffer.h
+// Hands the latest value from one producer thread to one consumer thread
+// without locks and without either side ever waiting.
+//
+// Three slots: the producer fills its own, the consumer reads its own, and
+// the third sits in the middle. Publish() swaps the producer's slot with the
+// middle one; Update() swaps the middle one with the consumer's if something
+// new was published. A slow consumer skips values, it never sees a torn one.
+// Slots are allocated up front, so nothing is allocated while running.
+
+#ifndef __SOLAR_TRIPLE_BUFFER
+#define __SOLAR_TRIPLE_BUFFER
+
+#include <atomic>
+
+template <class T> class TripleBuffer
+    {
+    public:
+        TripleBuffer(void) : iWrite(0), iMiddle(1), iRead(2) {}
+
+        // Every slot, for sizing before either thread starts
+        T &GetSlot(int i) { return slots[i]; }
+
+        // Producer side
+        T &GetWriteBuffer(void) { return slots[iWrite]; }
+        void Publish(void)
+            {
+            // The release makes the slot's contents visible with its index
+            iWrite = iMiddle.exchange(iWrite | FRESH, std::memory_order_acq_rel) & ~FRESH;
+            }
+
+        // Consumer side. True if a newer value was taken.
+        bool Update(void)
+            {
+            if((iMiddle.load(std::memory_order_relaxed) & FRESH) == 0)
+                return false;
+            iRead = iMiddle.exchange(iRead, std::memory_order_acq_rel) & ~FRESH;
+            return true;
+            }
+        const T &GetReadBuffer(void) const { return slots[iRead]; }
+
+    protected:
+        enum { FRESH = 4 };     // Set in iMiddle when it holds something the consumer has not seen
+
+        T                   slots[3];
+        int                 iWrite;
+        std::atomic<int>    iMiddle;
+        int                 iRead;
+    };
+
+#endif
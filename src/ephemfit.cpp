@@ -0,0 +1,243 @@
+// ephemfit.cpp
+// Offline tool that fits Chebyshev segments to ephemeris tables and writes
+// the compact binary that solar maps at run time (see Ephemeris.h).
+//
+// Usage: ephemfit [-d degree] [-s segmentDays] out.bin name=table.txt [name=table.txt ...]
+//
+// Each table holds one body. Both JPL Horizons vector tables (CSV export,
+// rows between $$SOE and $$EOE: JDTDB, calendar date, X, Y, Z, ...) and plain
+// "JD X Y Z" lines are accepted. Positions should be heliocentric ecliptic.
+
+#include "Ephemeris.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+struct Sample
+    {
+    double dJD;
+    double v[3];
+    };
+
+struct FittedBody
+    {
+    EphemerisBody           body;
+    std::vector<double>     coeffs;
+    };
+
+// Pull the numbers out of one table row. Returns false for anything that is not data.
+static bool ParseRow(char *szLine, Sample &sample)
+{
+    double fields[8];
+    int nFields = 0;
+    bool bCSV = strchr(szLine, ',') != NULL;
+
+    char *pSave = NULL;
+    for(char *pToken = strtok_r(szLine, bCSV ? "," : " \t\r\n", &pSave); pToken != NULL && nFields < 8;
+        pToken = strtok_r(NULL, bCSV ? "," : " \t\r\n", &pSave)) {
+        char *pEnd;
+        double d = strtod(pToken, &pEnd);
+
+        // Skip the calendar date column of Horizons output
+        while(*pEnd == ' ' || *pEnd == '\t' || *pEnd == '\r' || *pEnd == '\n')
+            pEnd++;
+        if(pEnd == pToken || *pEnd != '\0')
+            continue;
+
+        fields[nFields++] = d;
+    }
+
+    if(nFields < 4)
+        return false;
+
+    sample.dJD = fields[0];
+    sample.v[0] = fields[1];
+    sample.v[1] = fields[2];
+    sample.v[2] = fields[3];
+    return true;
+}
+
+static bool ReadTable(const char *szFileName, std::vector<Sample> &samples)
+{
+    FILE *pFile = fopen(szFileName, "r");
+    if(pFile == NULL) {
+        fprintf(stderr, "Cannot open %s\n", szFileName);
+        return false;
+    }
+
+    // First pass: does it have Horizons markers?
+    char szLine[1024];
+    bool bMarkers = false;
+    while(fgets(szLine, sizeof(szLine), pFile))
+        if(strncmp(szLine, "$$SOE", 5) == 0)
+            bMarkers = true;
+    rewind(pFile);
+
+    bool bInData = !bMarkers;
+    while(fgets(szLine, sizeof(szLine), pFile)) {
+        if(strncmp(szLine, "$$SOE", 5) == 0) { bInData = true; continue; }
+        if(strncmp(szLine, "$$EOE", 5) == 0) { bInData = false; continue; }
+        if(!bInData || szLine[0] == '#')
+            continue;
+
+        Sample sample;
+        if(ParseRow(szLine, sample))
+            samples.push_back(sample);
+    }
+    fclose(pFile);
+
+    if(samples.size() < 2) {
+        fprintf(stderr, "%s has no usable rows\n", szFileName);
+        return false;
+    }
+
+    for(size_t i = 1; i < samples.size(); i++)
+        if(samples[i].dJD <= samples[i-1].dJD) {
+            fprintf(stderr, "%s is not sorted by time (row %d)\n", szFileName, int(i));
+            return false;
+        }
+
+    return true;
+}
+
+static bool FitBody(const char *szName, const std::vector<Sample> &samples, int nDegree, double dSegmentDays, FittedBody &fitted)
+{
+    memset(&fitted.body, 0, sizeof(fitted.body));
+    strncpy(fitted.body.szName, szName, EPHEMERIS_NAME_LENGTH - 1);
+
+    double dStart = samples.front().dJD;
+    double dEnd = samples.back().dJD;
+    int nSegments = int(ceil((dEnd - dStart) / dSegmentDays));
+    if(nSegments < 1)
+        nSegments = 1;
+
+    fitted.body.dStartJD = dStart;
+    fitted.body.dSegmentDays = dSegmentDays;
+    fitted.body.nSegments = nSegments;
+    fitted.coeffs.resize(size_t(nSegments) * 3 * (nDegree + 1));
+
+    std::vector<double> times, values;
+    double dMaxError = 0.0;
+    size_t iFirst = 0;
+
+    for(int seg = 0; seg < nSegments; seg++) {
+        double dSegStart = dStart + seg * dSegmentDays;
+        double dSegEnd = dSegStart + dSegmentDays;
+
+        // Include the boundary samples on both sides so neighbours agree there
+        while(iFirst < samples.size() && samples[iFirst].dJD < dSegStart)
+            iFirst++;
+
+        times.clear();
+        for(size_t i = iFirst; i < samples.size() && samples[i].dJD <= dSegEnd; i++)
+            times.push_back(2.0 * (samples[i].dJD - dSegStart) / dSegmentDays - 1.0);
+
+        if(int(times.size()) < nDegree + 1) {
+            fprintf(stderr, "%s: segment %d has %d samples, need %d. Use longer segments or a lower degree.\n",
+                    szName, seg, int(times.size()), nDegree + 1);
+            return false;
+        }
+
+        for(int axis = 0; axis < 3; axis++) {
+            values.clear();
+            for(size_t i = 0; i < times.size(); i++)
+                values.push_back(samples[iFirst + i].v[axis]);
+
+            double *pCoeffs = &fitted.coeffs[(size_t(seg) * 3 + axis) * (nDegree + 1)];
+            if(!ephemFitChebyshev(&times[0], &values[0], int(times.size()), nDegree, pCoeffs)) {
+                fprintf(stderr, "%s: fit failed in segment %d\n", szName, seg);
+                return false;
+            }
+
+            for(size_t i = 0; i < times.size(); i++) {
+                double dError = fabs(ephemEvalChebyshev(pCoeffs, nDegree, times[i]) - values[i]);
+                if(dError > dMaxError)
+                    dMaxError = dError;
+            }
+        }
+    }
+
+    printf("%-12s JD %.1f - %.1f, %d segments, max residual %.3g\n", szName, dStart, dEnd, nSegments, dMaxError);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int nDegree = 10;
+    double dSegmentDays = 32.0;
+    int iArg = 1;
+
+    for(; iArg < argc && argv[iArg][0] == '-'; iArg++) {
+        if(strcmp(argv[iArg], "-d") == 0 && iArg + 1 < argc)
+            nDegree = atoi(argv[++iArg]);
+        else if(strcmp(argv[iArg], "-s") == 0 && iArg + 1 < argc)
+            dSegmentDays = atof(argv[++iArg]);
+        else
+            break;
+    }
+
+    if(argc - iArg < 2 || nDegree < 1 || nDegree > EPHEMERIS_MAX_DEGREE || dSegmentDays <= 0.0) {
+        fprintf(stderr, "Usage: %s [-d degree (1-%d)] [-s segmentDays] out.bin name=table.txt [name=table.txt ...]\n",
+                argv[0], EPHEMERIS_MAX_DEGREE);
+        return 1;
+    }
+
+    const char *szOutput = argv[iArg++];
+    std::vector<FittedBody> bodies;
+
+    for(; iArg < argc; iArg++) {
+        char szName[EPHEMERIS_NAME_LENGTH];
+        const char *pEquals = strchr(argv[iArg], '=');
+        if(pEquals == NULL || pEquals == argv[iArg] || pEquals - argv[iArg] >= EPHEMERIS_NAME_LENGTH) {
+            fprintf(stderr, "Expected name=table, got %s\n", argv[iArg]);
+            return 1;
+        }
+        memset(szName, 0, sizeof(szName));
+        memcpy(szName, argv[iArg], pEquals - argv[iArg]);
+
+        std::vector<Sample> samples;
+        if(!ReadTable(pEquals + 1, samples))
+            return 1;
+
+        bodies.push_back(FittedBody());
+        if(!FitBody(szName, samples, nDegree, dSegmentDays, bodies.back()))
+            return 1;
+    }
+
+    // Lay out the file: header, directory, then each body's coefficients
+    EphemerisHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.szMagic, EPHEMERIS_MAGIC, sizeof(EPHEMERIS_MAGIC));
+    header.nVersion = EPHEMERIS_VERSION;
+    header.nBodies = uint32_t(bodies.size());
+    header.nDegree = uint32_t(nDegree);
+
+    uint64_t nOffset = sizeof(EphemerisHeader) + bodies.size() * sizeof(EphemerisBody);
+    for(size_t i = 0; i < bodies.size(); i++) {
+        bodies[i].body.nCoeffOffset = nOffset;
+        nOffset += bodies[i].coeffs.size() * sizeof(double);
+    }
+
+    FILE *pFile = fopen(szOutput, "wb");
+    if(pFile == NULL) {
+        fprintf(stderr, "Cannot write %s\n", szOutput);
+        return 1;
+    }
+
+    bool bOK = fwrite(&header, sizeof(header), 1, pFile) == 1;
+    for(size_t i = 0; i < bodies.size(); i++)
+        bOK = bOK && fwrite(&bodies[i].body, sizeof(EphemerisBody), 1, pFile) == 1;
+    for(size_t i = 0; i < bodies.size(); i++)
+        bOK = bOK && fwrite(&bodies[i].coeffs[0], sizeof(double), bodies[i].coeffs.size(), pFile) == bodies[i].coeffs.size();
+
+    if(fclose(pFile) != 0 || !bOK) {
+        fprintf(stderr, "Error writing %s\n", szOutput);
+        return 1;
+    }
+
+    printf("Wrote %s (%llu bytes)\n", szOutput, (unsigned long long)nOffset);
+    return 0;
+}
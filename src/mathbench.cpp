@@ -0,0 +1,133 @@
+// mathbench.cpp
+// Compares the math3d batch kernels with calling the one-at-a-time routines in
+// a loop, and checks that both give the same answers.
+//
+// Usage: mathbench [count] [passes]
+
+#include <math3d.h>
+#include <GLTools.h>     // GL types for GLFrustum
+#include <GLFrame.h>
+#include <GLFrustum.h>
+#include <StopWatch.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+struct Matrix { M3DMatrix44f m; };
+struct Vector { M3DVector4f v; };
+
+static float Random(void)
+{
+    return float(rand()) / float(RAND_MAX) * 2.0f - 1.0f;
+}
+
+// Best of a few runs, in nanoseconds per element
+template <class F> static double Time(F func, int nCount, int nPasses)
+{
+    double dBest = 1e30;
+    for(int run = 0; run < 5; run++) {
+        CStopWatch timer;
+        for(int pass = 0; pass < nPasses; pass++)
+            func();
+        double dSeconds = timer.GetElapsedSeconds();
+        if(dSeconds < dBest)
+            dBest = dSeconds;
+    }
+    return dBest * 1e9 / (double(nCount) * nPasses);
+}
+
+static float MaxDifference(const float *a, const float *b, size_t nFloats)
+{
+    float fMax = 0.0f;
+    for(size_t i = 0; i < nFloats; i++)
+        if(fabsf(a[i] - b[i]) > fMax)
+            fMax = fabsf(a[i] - b[i]);
+    return fMax;
+}
+
+static void Report(const char *szName, double dScalar, double dBatch, float fDifference)
+{
+    printf("%-28s %8.2f ns %8.2f ns %6.2fx   max diff %g\n", szName, dScalar, dBatch, dScalar / dBatch, fDifference);
+}
+
+int main(int argc, char* argv[])
+{
+    int nCount = argc > 1 ? atoi(argv[1]) : 4096;
+    int nPasses = argc > 2 ? atoi(argv[2]) : 200;
+    if(nCount < 1 || nPasses < 1) {
+        fprintf(stderr, "Usage: %s [count] [passes]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<Matrix> a(nCount), b(nCount), scalar(nCount), batch(nCount);
+    std::vector<Vector> vIn(nCount), vScalar(nCount), vBatch(nCount);
+
+    for(int i = 0; i < nCount; i++) {
+        for(int j = 0; j < 16; j++) {
+            a[i].m[j] = Random();
+            b[i].m[j] = Random();
+        }
+        for(int j = 0; j < 4; j++)
+            vIn[i].v[j] = Random();
+    }
+
+    const M3DMatrix44f *pA = &a[0].m;
+    const M3DMatrix44f *pB = &b[0].m;
+    M3DMatrix44f *pScalar = &scalar[0].m;
+    M3DMatrix44f *pBatch = &batch[0].m;
+    const M3DVector4f *pIn = &vIn[0].v;
+
+    printf("%d elements, %d passes\n", nCount, nPasses);
+    printf("%-28s %11s %11s %7s\n", "", "scalar", "batch", "speedup");
+
+    // Pairwise products
+    double dScalar = Time([&]() {
+        for(int i = 0; i < nCount; i++)
+            m3dMatrixMultiply44(pScalar[i], pA[i], pB[i]);
+        }, nCount, nPasses);
+    double dBatch = Time([&]() { m3dMatrixMultiply44Batch(pBatch, pA, pB, nCount); }, nCount, nPasses);
+    Report("a[i] * b[i]", dScalar, dBatch, MaxDifference(&scalar[0].m[0], &batch[0].m[0], size_t(nCount) * 16));
+
+    // One matrix times many
+    dScalar = Time([&]() {
+        for(int i = 0; i < nCount; i++)
+            m3dMatrixMultiply44(pScalar[i], pA[0], pB[i]);
+        }, nCount, nPasses);
+    dBatch = Time([&]() { m3dMatrixMultiply44Batch(pBatch, pA[0], pB, nCount); }, nCount, nPasses);
+    Report("a * b[i]", dScalar, dBatch, MaxDifference(&scalar[0].m[0], &batch[0].m[0], size_t(nCount) * 16));
+
+    // Vector transform
+    dScalar = Time([&]() {
+        for(int i = 0; i < nCount; i++)
+            m3dTransformVector4(vScalar[i].v, pIn[i], pA[0]);
+        }, nCount, nPasses);
+    dBatch = Time([&]() { m3dTransformVector4Batch(&vBatch[0].v, pIn, pA[0], nCount); }, nCount, nPasses);
+    Report("m * v[i]", dScalar, dBatch, MaxDifference(&vScalar[0].v[0], &vBatch[0].v[0], size_t(nCount) * 4));
+
+    // Frustum culling, spheres scattered so some are in view and some not.
+    // The difference is the number of spheres the two disagree on.
+    GLFrustum frustum;
+    GLFrame camera;
+    frustum.SetPerspective(35.0f, 4.0f / 3.0f, 0.01f, 160.0f);
+    frustum.Transform(camera);
+
+    std::vector<Vector> spheres(nCount);
+    std::vector<unsigned char> bScalar(nCount), bBatch(nCount);
+    for(int i = 0; i < nCount; i++)
+        m3dLoadVector4(spheres[i].v, Random() * 20.0f, Random() * 20.0f, Random() * 20.0f - 15.0f, fabsf(Random()));
+    const M3DVector4f *pSpheres = &spheres[0].v;
+
+    dScalar = Time([&]() {
+        for(int i = 0; i < nCount; i++)
+            bScalar[i] = frustum.TestSphere(spheres[i].v, spheres[i].v[3]) ? 1 : 0;
+        }, nCount, nPasses);
+    dBatch = Time([&]() { frustum.TestSpheres(pSpheres, &bBatch[0], nCount); }, nCount, nPasses);
+
+    int nDisagree = 0;
+    for(int i = 0; i < nCount; i++)
+        nDisagree += bScalar[i] != bBatch[i];
+    Report("frustum vs spheres[i]", dScalar, dBatch, float(nDisagree));
+
+    return 0;
+}
@@ -11,10 +11,36 @@
 #include <GLMatrixStack.h>
 #include <GLGeometryTransform.h>
 #include <StopWatch.h>
+#include <GLProfiler.h>
+#include <GLProgramCache.h>
 #include <iostream>
 
+#include "TimeWarp.h"
+#include "Orbit.h"
+#include "Ephemeris.h"
+#include "Snapshot.h"
+#include "TransformHierarchy.h"
+#include "FrameScheduler.h"
+#include "solar.h"
+#include "SimulationThread.h"
+#include "CameraController.h"
+#include "LatencyMeter.h"
+#include "FrameTimeLog.h"
+#include "SphereLod.h"
+#include "ImpostorBatch.h"
+#include "SphereRayCaster.h"
+#include "OrbitBatch.h"
+#include "ShaderPermutations.h"
+#include "IndirectBatch.h"
+#include "TripleBuffer.h"
+
+#include <atomic>
+#include <errno.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
 
 #ifdef __APPLE__
 #include <glut/glut.h>
@@ -23,6 +49,16 @@
 #include <GL/glut.h>
 #endif
 
+#if !defined(WIN32) && !defined(__APPLE__)
+#include <glxew.h>
+#endif
+
+#ifdef WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
 #define PI 3.1415926535
 
 GLfloat vWhite[] = { 1.0f, 1.0f, 1.0f, 1.0f };
@@ -41,52 +77,83 @@ GLBatch     skyBoxRight;
 GLBatch     skyBoxFront;
 GLBatch     skyBoxBack;
 
-GLTriangleBatch     sunBatch;
-GLTriangleBatch     mercuryBatch;
-GLTriangleBatch     venusBatch;
-GLTriangleBatch     earthBatch;
-GLTriangleBatch     moonBatch;
-GLTriangleBatch     marsBatch;
-GLTriangleBatch     jupiterBatch;
-GLTriangleBatch     saturnBatch;
+// Every sphere comes in several tessellations, chosen per frame by size on screen
+SphereLod           sunLod;
+SphereLod           mercuryLod;
+SphereLod           venusLod;
+SphereLod           earthLod;
+SphereLod           moonLod;
+SphereLod           marsLod;
+SphereLod           jupiterLod;
+SphereLod           saturnLod;
 GLTriangleBatch     saturnRingBatch;
-GLTriangleBatch     uranusBatch;
+SphereLod           uranusLod;
 GLTriangleBatch     uranusRingBatch;
-GLTriangleBatch     neptuneBatch;
-GLTriangleBatch     plutoBatch;
-
-GLBatch             mercuryOrbitBatch;
-GLBatch             venusOrbitBatch;
-GLBatch             earthOrbitBatch;
-GLBatch             moonOrbitBatch;
-GLBatch             marsOrbitBatch;
-GLBatch             jupiterOrbitBatch;
-GLBatch             saturnOrbitBatch;
-GLBatch             uranusOrbitBatch;
-GLBatch             neptuneOrbitBatch;
-GLBatch             plutoOrbitBatch;
+SphereLod           neptuneLod;
+SphereLod           plutoLod;
+float               lodPixelScale = 1.0f;   // Pixels on screen per unit of size at unit distance
+
+// Bodies a few pixels across are point sprites instead, all in one draw,
+// colored by their texture's average
+ImpostorBatch       impostors;
+bool                impostorsEnabled = true;
+M3DVector3f         sunColor;
+
+// Or the GPU culls, sizes and draws the Sun and bodies itself, from the
+// frustum in eye space
+IndirectBatch       indirectBatch;
+bool                gpuDriven = false;
+bool                gpuDrivenAvailable = false;     // IndirectBatch set up, with its texture array
+GLuint              bodyTextureArray = 0;
+GLFrustum           eyeFrustum;
+
+// Or each sphere is ray cast on a quad that covers it, exact at any size
+SphereRayCaster     rayCaster;
+bool                rayCastingEnabled = false;
+
+// Orbit paths, generated by the shaders from their elements
+OrbitBatch          orbitBatch;
 
 GLTriangleBatch     emptyRingBatch;
 
 GLFrame             cameraFrame;
 
 M3DVector4f         vLightTransformed;
-M3DMatrix44f        mCamera;
 
 GLuint              uiTextures[12];
 GLuint              skyBoxTexture[6];
 
-GLuint  solarShader;        // The Solar shader
-GLint   locLight;           // The location of the Light in eye coordinates
-GLint   locMV;              // The location of the ModelView matrix uniform
-GLint   locMVP;             // The location of the ModelViewProjection matrix uniform
-GLint   locNM;              // The location of the Normal matrix uniform
-GLint   locDoubleLayer;     // The location of the double layer flag uniform
-GLint   locObserverLight;     // The location of the observer light uniform
+// SolarShader, built once for each combination of these it is drawn with
+enum SOLAR_FEATURE { SOLAR_OBSERVER_LIGHT = 1, SOLAR_DOUBLE_LAYER = 2, SOLAR_PER_PIXEL = 4, SOLAR_ATMOSPHERE = 8,
+                     SOLAR_RING_SHADOW = 16, SOLAR_PERMUTATIONS = 32 };
+const char *solarFeatures[] = { "OBSERVER_LIGHT", "DOUBLE_LAYER", "PER_PIXEL", "ATMOSPHERE", "RING_SHADOW" };
+ShaderPermutations  solarShaders;
 
-GLuint  simpleShader;       // The Solar shader
-GLint   locSimpleColor;     // The location of the diffuse color
-GLint   locSimpleMVP;       // The location of the ModelViewProjection matrix uniform
+// Uniform locations of one permutation, found the first time it is used
+struct SolarLocations
+    {
+    GLuint  program;            // 0 until then, or if it does not build
+    GLint   light;              // The Light in eye coordinates
+    GLint   MVP;
+    GLint   MV;
+    GLint   NM;
+    GLint   sunRadius;          // Shadows: the Sun's radius,
+    GLint   occluders;          // the spheres that may be in the way,
+    GLint   occluderCount;
+    GLint   ringCenter;         // and the body's ring
+    GLint   ringNormal;
+    GLint   ringShadow;
+    GLint   atmosphere;
+    };
+SolarLocations      solarLocations[SOLAR_PERMUTATIONS];
+bool                perPixelLighting = true;
+
+// Linked programs are kept here between runs, none when NULL
+const char          *shaderCacheDirectory = NULL;
+
+#define SHADOW_MAX_OCCLUDERS    8       // SolarShader.fp's vOccluders
+#define RING_SHADOW_OPACITY     0.6f
+bool    shadowsEnabled = true;
 
 const float mercuryOrbitInclination = 7.0f;
 const float mercuryAxialTilt = -0.027f;
@@ -142,6 +209,148 @@ const float plutoAxialTilt = -119.591f;
 const float plutoRadius = 0.04f;
 const float plutoOrbitRadius = 9.0f;
 
+const float sunRadius = 0.5f;
+
+// Bodies that move under the simulation clock
+enum SOLAR_BODY { BODY_MERCURY = 0, BODY_VENUS, BODY_EARTH, BODY_MOON, BODY_MARS, BODY_JUPITER,
+                    BODY_SATURN, BODY_URANUS, BODY_NEPTUNE, BODY_PLUTO, BODY_LAST };
+
+const float bodyRadii[BODY_LAST] = { mercuryRadius, venusRadius, earthRadius, moonRadius, marsRadius, jupiterRadius,
+                                     saturnRadius, uranusRadius, neptuneRadius, plutoRadius };
+
+// Bounding sphere radius of each body, rings included
+const float bodyBoundRadii[BODY_LAST] = { mercuryRadius, venusRadius, earthRadius, moonRadius, marsRadius, jupiterRadius,
+                                          saturnRingOuterRadius, uranusRingOuterRadius, neptuneRadius, plutoRadius };
+M3DVector3f bodyColors[BODY_LAST];      // Average of each texture, for impostors
+
+// Color each body's atmosphere adds around its lit limb, 0 for none
+const float bodyAtmosphereColors[BODY_LAST][3] = { { 0.0f, 0.0f, 0.0f }, { 0.35f, 0.3f, 0.15f }, { 0.25f, 0.4f, 0.8f },
+                                                   { 0.0f, 0.0f, 0.0f }, { 0.3f, 0.15f, 0.08f }, { 0.25f, 0.2f, 0.15f },
+                                                   { 0.25f, 0.22f, 0.15f }, { 0.2f, 0.35f, 0.4f }, { 0.15f, 0.25f, 0.5f },
+                                                   { 0.0f, 0.0f, 0.0f } };
+
+// Inner and outer radius of each body's ring, 0 for none
+const float bodyRingRadii[BODY_LAST][2] = { { 0.0f, 0.0f }, { 0.0f, 0.0f }, { 0.0f, 0.0f }, { 0.0f, 0.0f }, { 0.0f, 0.0f },
+                                            { 0.0f, 0.0f }, { saturnRingInnerRadius, saturnRingOuterRadius },
+                                            { uranusRingInnerRadius, uranusRingOuterRadius }, { 0.0f, 0.0f }, { 0.0f, 0.0f } };
+
+// One simulation second at 1x turns the Sun by this many degrees. Orbit and
+// spin rates below are multiples of it.
+const double sunSpinRate = 35.0;
+
+const double bodyOrbitRates[BODY_LAST] = { 3.5, 2.0, 0.5, -2.0, 0.4, 0.32, 0.27, 0.22, 0.18, 0.15 };
+const double bodySpinRates[BODY_LAST] = { -5.0, 4.0, -7.0, 0.0, 3.0, -2.0, 3.0, -4.0, 2.0, 1.0 };
+const float bodyOrbitRadii[BODY_LAST] = { mercuryOrbitRadius, venusOrbitRadius, earthOrbitRadius, moonOrbitRadius,
+                                          marsOrbitRadius, jupiterOrbitRadius, saturnOrbitRadius, uranusOrbitRadius,
+                                          neptuneOrbitRadius, plutoOrbitRadius };
+
+const float bodyOrbitInclinations[BODY_LAST] = { mercuryOrbitInclination, venusOrbitInclination, earthOrbitInclination,
+                                                  moonOrbitInclination, marsOrbitInclination, jupiterOrbitInclination,
+                                                  saturnOrbitInclination, uranusOrbitInclination, neptuneOrbitInclination,
+                                                  plutoOrbitInclination };
+const float bodyAxialTilts[BODY_LAST] = { mercuryAxialTilt, venusAxialTilt, earthAxialTilt, moonAxialTilt, marsAxialTilt,
+                                          jupiterAxialTilt, saturnAxialTilt, uranusAxialTilt, neptuneAxialTilt, plutoAxialTilt };
+
+// Names used to look bodies up in an ephemeris file
+const char *bodyNames[BODY_LAST] = { "mercury", "venus", "earth", "moon", "mars", "jupiter",
+                                     "saturn", "uranus", "neptune", "pluto" };
+
+// Sidereal rotation periods in hours, used with real data. Negative is retrograde.
+const double sunRotationHours = 609.12;
+const double bodyRotationHours[BODY_LAST] = { 1407.6, -5832.5, 23.9345, 655.72, 24.6229, 9.925,
+                                              10.656, -17.24, 16.11, -153.29 };
+
+TimeWarp            timeWarp;
+OrbitPropagator     bodyOrbits[BODY_LAST];
+float               bodyOrbitAngles[BODY_LAST];
+
+// Real-data mode. When an ephemeris is open, orbit angles come from it and one
+// simulation second is one real second after ephemerisEpoch (a Julian date).
+Ephemeris           ephemeris;
+int                 ephemerisBodies[BODY_LAST];
+double              ephemerisEpoch = 0.0;
+
+// Snapshot of the simulation for seeking: orbital position and velocity of
+// every body. Spin phases are a pure function of simulation time, so the time
+// stamp of the snapshot covers them.
+#define SNAPSHOT_BODY_DOUBLES   4
+SnapshotStore       snapshots(BODY_LAST * SNAPSHOT_BODY_DOUBLES);
+
+// Scene transforms. Every body has an orbit plane node (its orbit ring is drawn
+// there), a position node on that plane and a spin node the body is drawn with.
+// The Moon's orbit plane hangs off the Earth's position node.
+TransformHierarchy  transforms;
+int                 sunNode;
+int                 bodyOrbitNodes[BODY_LAST];
+int                 bodyPositionNodes[BODY_LAST];
+int                 bodySpinNodes[BODY_LAST];
+M3DVector4f         bodyTiltQuats[BODY_LAST];
+M3DMatrix44f        *nodeModelViews = NULL;    // View times every world matrix, refreshed each frame
+
+FrameScheduler      frameScheduler;
+
+// Stats overlay
+GpuTimer            gpuTimer;
+bool                statsVisible = false;
+double              frameMilliseconds = 0.0;    // Smoothed wall time per frame
+int                 windowWidth = 800;
+int                 windowHeight = 600;
+
+// Frame interval histograms and the stutter log, --frame-log writes them out
+FrameTimeLog        frameTimeLog;
+
+// Frustum culling. Each frame the Sun, every body and every orbit get a world
+// space bounding sphere, and the lot is tested against the frustum in one go.
+enum CULL_ENTRY { CULL_SUN = 0, CULL_BODIES, CULL_ORBITS = CULL_BODIES + BODY_LAST, CULL_LAST = CULL_ORBITS + BODY_LAST };
+
+bool                cullingEnabled = true;
+M3DVector4f         cullSpheres[CULL_LAST];
+unsigned char       cullVisible[CULL_LAST];
+int                 cullVisibleCount = CULL_LAST;
+
+// Headless mode: no window, an EGL context rendering into a framebuffer object
+bool                headlessMode = false;
+HeadlessContext     headlessContext;
+
+// Scripted camera flights, and recording them
+CameraPath          *cameraPath = NULL;
+CameraPath          loadedCameraPath;
+double              cameraPathTime = 0.0;
+FILE                *cameraRecording = NULL;
+
+// The simulation owns timeWarp, the orbits, snapshots, transforms, cameraFrame
+// and the camera path. It runs on its own thread at a fixed rate, or inline
+// in RenderScene for headless runs and --sim-rate 0, and publishes what the
+// renderer needs as a SimulationFrame. Rendering only ever reads the latest
+// published frame.
+struct SimulationFrame
+    {
+    double              dSimTime;
+    double              dScale;
+    bool                bPaused;
+    bool                bAnimating;         // Something would move in the next frame
+    GLFrame             camera;
+    CameraMotion        cameraMotion;
+    int64_t             nCameraTime;        // Clock nanoseconds the camera is placed for; all input up to then is in
+    std::vector<float>  worldMatrices;      // 16 per transform node
+    };
+
+// Time controls for the simulation: counts the next step takes and zeroes.
+// Camera keys go through cameraController. No locks, so neither side waits.
+struct SimulationInput
+    {
+    std::atomic<int>    nPauseToggles;
+    std::atomic<int>    nScaleSteps;        // + faster, - slower
+    std::atomic<int>    nSeekSteps;         // 10 seconds at the current scale each
+    };
+
+SimulationInput                 simulationInput;
+LatencyMeter                    latencyMeter;
+CameraController                cameraController;
+TripleBuffer<SimulationFrame>   simulationFrames;
+double                          simulationRate = SIM_DEFAULT_RATE;
+SimulationThread                simulationThread;   // Last, so it stops before anything it uses is destroyed
+
 
 void gltMakeSkyboxTop(GLBatch& cubeBatch, GLfloat fRadius );
 void gltMakeSkyboxBottom(GLBatch& cubeBatch, GLfloat fRadius );
@@ -150,10 +359,238 @@ void gltMakeSkyboxRight(GLBatch& cubeBatch, GLfloat fRadius );
 void gltMakeSkyboxFront(GLBatch& cubeBatch, GLfloat fRadius );
 void gltMakeSkyboxBack(GLBatch& cubeBatch, GLfloat fRadius );
 
-void gltMakeCircle(GLBatch& circleBatch, GLfloat fRadius, int points );
-    
+void UpdateWindowTitle(void);
+void RequestRedraw(void);
+void SimulationStep(double dStep);
+void SetFramePacing(FRAME_PACING eMode);
+
+//////////////////////////////////////////////////////////////////
+// Put every body on its circular orbit at simulation time zero
+void InitSimulation()
+{
+    for(int i = 0; i < BODY_LAST; i++) {
+        OrbitElements elements;
+        elements.dSemiMajorAxis = bodyOrbitRadii[i];
+        elements.dEccentricity = 0.0;
+        elements.dPeriod = 360.0 / (sunSpinRate * bodyOrbitRates[i]);
+        elements.dMeanAnomalyAtEpoch = 0.0;
+        bodyOrbits[i].SetElements(elements, timeWarp.GetSimTime());
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+// Switch to real-data mode. Returns false if the file cannot be used.
+bool OpenEphemeris(const char *szFileName, double dEpoch)
+{
+    if(!ephemeris.Open(szFileName))
+        return false;
+
+    int nFound = 0;
+    for(int i = 0; i < BODY_LAST; i++) {
+        ephemerisBodies[i] = ephemeris.FindBody(bodyNames[i]);
+        if(ephemerisBodies[i] >= 0)
+            nFound++;
+    }
+
+    if(nFound == 0) {
+        fprintf(stderr, "%s has none of the solar bodies\n", szFileName);
+        ephemeris.Close();
+        return false;
+    }
+
+    // Default to now, or the start of the table if now is not covered
+    int iReference = ephemerisBodies[BODY_EARTH] >= 0 ? ephemerisBodies[BODY_EARTH] : 0;
+    if(dEpoch == 0.0) {
+        dEpoch = 2440587.5 + double(time(NULL)) / 86400.0;
+        if(dEpoch < ephemeris.GetStartJD(iReference) || dEpoch >= ephemeris.GetEndJD(iReference))
+            dEpoch = ephemeris.GetStartJD(iReference);
+    }
+    ephemerisEpoch = dEpoch;
+
+    printf("Real-data mode: %d bodies from %s, epoch JD %.2f\n", nFound, szFileName, ephemerisEpoch);
+    return true;
+}
+
+double GetJulianDate(void)
+{
+    return ephemerisEpoch + timeWarp.GetSimTime() / 86400.0;
+}
+
+//////////////////////////////////////////////////////////////////
+// Move every body to the current simulation time
+void AdvanceSimulation(double dSimDelta)
+{
+    GLT_PROFILE_FUNCTION();
+
+    for(int i = 0; i < BODY_LAST; i++) {
+        bodyOrbits[i].Advance(timeWarp.GetSimTime(), dSimDelta, timeWarp.GetSubstepBudget());
+        bodyOrbitAngles[i] = float(bodyOrbits[i].GetAngle());
+    }
+
+    if(!ephemeris.IsOpen())
+        return;
+
+    // Ecliptic longitude straight from the tables. The Moon is tabulated
+    // around the Sun like everything else, so take it relative to the Earth.
+    double dJD = GetJulianDate();
+    double vEarth[3] = { 0.0, 0.0, 0.0 };
+    if(ephemerisBodies[BODY_EARTH] >= 0)
+        ephemeris.GetPosition(ephemerisBodies[BODY_EARTH], dJD, vEarth);
+
+    for(int i = 0; i < BODY_LAST; i++) {
+        if(ephemerisBodies[i] < 0)
+            continue;
+
+        double vPos[3];
+        ephemeris.GetPosition(ephemerisBodies[i], dJD, vPos);
+        if(i == BODY_MOON) {
+            vPos[0] -= vEarth[0];
+            vPos[1] -= vEarth[1];
+        }
+        bodyOrbitAngles[i] = float(m3dRadToDeg(atan2(vPos[1], vPos[0])));
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+// Record the simulation state about once per real second, whatever the warp
+void CaptureSnapshot(void)
+{
+    GLT_PROFILE_FUNCTION();
+
+    double dTime = timeWarp.GetSimTime();
+    double dLatest = snapshots.GetLatestTime();
+    if(dLatest >= 0.0 && dTime >= dLatest && dTime - dLatest < timeWarp.GetScale())
+        return;
+
+    double state[BODY_LAST * SNAPSHOT_BODY_DOUBLES];
+    for(int i = 0; i < BODY_LAST; i++) {
+        const double *vPos = bodyOrbits[i].GetPosition();
+        const double *vVel = bodyOrbits[i].GetVelocity();
+        state[i * SNAPSHOT_BODY_DOUBLES + 0] = vPos[0];
+        state[i * SNAPSHOT_BODY_DOUBLES + 1] = vPos[1];
+        state[i * SNAPSHOT_BODY_DOUBLES + 2] = vVel[0];
+        state[i * SNAPSHOT_BODY_DOUBLES + 3] = vVel[1];
+    }
+
+    snapshots.Capture(dTime, state);
+}
+
+//////////////////////////////////////////////////////////////////
+// Jump to simulation time dTarget: restore the nearest snapshot before it and
+// step forward from there
+void SeekSimulation(double dTarget)
+{
+    if(dTarget < 0.0)
+        dTarget = 0.0;
+
+    double state[BODY_LAST * SNAPSHOT_BODY_DOUBLES];
+    double dSnapshotTime;
+
+    if(snapshots.Restore(dTarget, dSnapshotTime, state)) {
+        for(int i = 0; i < BODY_LAST; i++) {
+            bodyOrbits[i].SetState(&state[i * SNAPSHOT_BODY_DOUBLES], &state[i * SNAPSHOT_BODY_DOUBLES + 2]);
+            bodyOrbits[i].Advance(dTarget, dTarget - dSnapshotTime, timeWarp.GetSubstepBudget());
+        }
+    }
+    else {
+        for(int i = 0; i < BODY_LAST; i++)
+            bodyOrbits[i].SetTime(dTarget);
+    }
+
+    timeWarp.SetSimTime(dTarget);
+    AdvanceSimulation(0.0);
+}
+
+//////////////////////////////////////////////////////////////////
+// Build the scene graph. Orbit planes and the fixed part of each body's
+// orientation never change, so they are set once here.
+void InitTransforms()
+{
+    sunNode = transforms.AddNode(TRANSFORM_NO_PARENT);
+
+    for(int i = 0; i < BODY_LAST; i++) {
+        float inclination = bodyOrbitInclinations[i];
+
+        if(i == BODY_MOON) {
+            bodyOrbitNodes[i] = transforms.AddNode(bodyPositionNodes[BODY_EARTH]);
+            transforms.SetRotation(bodyOrbitNodes[i], -90.0f, 1.0f, 0.0f, 0.0f);
+            transforms.AppendRotation(bodyOrbitNodes[i], inclination, 0.0f, 1.0f, 0.0f);
+        }
+        else {
+            bodyOrbitNodes[i] = transforms.AddNode(TRANSFORM_NO_PARENT);
+            transforms.SetRotation(bodyOrbitNodes[i], inclination, 0.0f, 0.0f, 1.0f);
+        }
+
+        // Keep the body upright whatever its place on the orbit
+        bodyPositionNodes[i] = transforms.AddNode(bodyOrbitNodes[i]);
+        transforms.SetRotation(bodyPositionNodes[i], 90.0f, 1.0f, 0.0f, 0.0f);
+        transforms.AppendRotation(bodyPositionNodes[i], -inclination, 0.0f, 1.0f, 0.0f);
+
+        bodySpinNodes[i] = transforms.AddNode(bodyPositionNodes[i]);
+        TransformHierarchy::QuatFromAxisAngle(bodyTiltQuats[i], bodyAxialTilts[i], 0.0f, 1.0f, 0.0f);
+    }
+
+    nodeModelViews = new M3DMatrix44f[transforms.GetNodeCount()];
+}
+
+//////////////////////////////////////////////////////////////////
+// Size every frame slot, then publish a first frame for the renderer
+void InitSimulationFrames(void)
+{
+    for(int i = 0; i < 3; i++)
+        simulationFrames.GetSlot(i).worldMatrices.resize(transforms.GetNodeCount() * 16);
+
+    SimulationStep(0.0);
+    simulationFrames.Update();
+}
+
+//////////////////////////////////////////////////////////////////
+// Spin angles (degrees), wrapped in double precision first
+float GetSpinAngle(double dRate, double dRotationHours)
+{
+    if(ephemeris.IsOpen())
+        return float(fmod(360.0 * timeWarp.GetSimTime() / (3600.0 * dRotationHours), 360.0));
+
+    return float(fmod(sunSpinRate * dRate * timeWarp.GetSimTime(), 360.0));
+}
+
+float GetSpinAngle(int iBody)
+{
+    return GetSpinAngle(bodySpinRates[iBody], bodyRotationHours[iBody]);
+}
+
+//////////////////////////////////////////////////////////////////
+// Feed this frame's orbit and spin angles into the scene graph. Only what
+// actually moved gets its world matrix rebuilt.
+void UpdateTransforms(void)
+{
+    GLT_PROFILE_FUNCTION();
+
+    M3DVector4f vQuat, vSpin;
+
+    TransformHierarchy::QuatFromAxisAngle(vQuat, 90.0f, 1.0f, 0.0f, 0.0f);
+    TransformHierarchy::QuatFromAxisAngle(vSpin, GetSpinAngle(1.0, sunRotationHours), 0.0f, 0.0f, 1.0f);
+    TransformHierarchy::QuatMultiply(vQuat, vQuat, vSpin);
+    transforms.SetRotation(sunNode, vQuat);
+
+    for(int i = 0; i < BODY_LAST; i++) {
+        // Rotate(90, x) Rotate(orbit, z) Translate(r, 0, 0) lands here
+        float angle = float(m3dDegToRad(bodyOrbitAngles[i]));
+        float radius = bodyOrbitRadii[i];
+        transforms.SetTranslation(bodyPositionNodes[i], radius * cosf(angle), 0.0f, radius * sinf(angle));
+
+        TransformHierarchy::QuatFromAxisAngle(vSpin, GetSpinAngle(i), 0.0f, 0.0f, 1.0f);
+        TransformHierarchy::QuatMultiply(vQuat, bodyTiltQuats[i], vSpin);
+        transforms.SetRotation(bodySpinNodes[i], vQuat);
+    }
+
+    transforms.Update();
+}
+
 bool LoadTGATexture(const char *szFileName, GLenum minFilter, GLenum magFilter, GLenum wrapMode)
 {
+    GLT_PROFILE_FUNCTION();
+
     GLbyte *pBits;
     int nWidth, nHeight, nComponents;
     GLenum eFormat;
@@ -184,11 +621,61 @@ bool LoadTGATexture(const char *szFileName, GLenum minFilter, GLenum magFilter,
     return true;
 }
         
+//////////////////////////////////////////////////////////////////
+// Make szDirectory and any parents it lacks. True if it is there now.
+static bool MakeDirectory(const char *szDirectory)
+{
+    char szPath[1024];
+    snprintf(szPath, sizeof(szPath), "%s", szDirectory);
+
+    for(char *p = szPath + 1; ; p++) {
+        if(*p != '/' && *p != '\\' && *p != 0)
+            continue;
+        char cEnd = *p;
+        *p = 0;
+#ifdef WIN32
+        int nResult = _mkdir(szPath);
+#else
+        int nResult = mkdir(szPath, 0755);
+#endif
+        if(nResult != 0 && errno != EEXIST)
+            return false;
+        if(cEnd == 0)
+            return true;
+        *p = cEnd;
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+// The usual place for the shader cache, created if need be: solar under
+// $XDG_CACHE_HOME, ~/.cache or, on Windows, %LOCALAPPDATA%. NULL if there
+// is nowhere to put it.
+const char *MakeShaderCacheDirectory(void)
+{
+    static char szDirectory[1024];
+    const char *szBase;
+
+    if((szBase = getenv("XDG_CACHE_HOME")) != NULL && szBase[0] != 0)
+        snprintf(szDirectory, sizeof(szDirectory), "%s/solar", szBase);
+    else if((szBase = getenv("LOCALAPPDATA")) != NULL && szBase[0] != 0)
+        snprintf(szDirectory, sizeof(szDirectory), "%s/solar", szBase);
+    else if((szBase = getenv("HOME")) != NULL && szBase[0] != 0)
+        snprintf(szDirectory, sizeof(szDirectory), "%s/.cache/solar", szBase);
+    else
+        return NULL;
+
+    return MakeDirectory(szDirectory) ? szDirectory : NULL;
+}
+
 //////////////////////////////////////////////////////////////////
 // This function does any needed initialization on the rendering
 // context. 
 void SetupRC()
 {
+    GLT_PROFILE_FUNCTION();
+
+    // Before anything is compiled
+    gltSetProgramCache(shaderCacheDirectory);
     shaderManager.InitializeStockShaders();
 
     glEnable(GL_DEPTH_TEST);
@@ -203,30 +690,20 @@ void SetupRC()
     gltMakeSkyboxFront(skyBoxFront, 40.0f);
     gltMakeSkyboxBack(skyBoxBack, 40.0f);
     
-    gltMakeSphere(sunBatch, 0.5f, 40, 20);
-    gltMakeSphere(mercuryBatch, mercuryRadius, 16, 8);
-    gltMakeSphere(venusBatch, venusRadius, 20, 10);
-    gltMakeSphere(earthBatch, earthRadius, 20, 10);
-    gltMakeSphere(moonBatch, moonRadius, 16, 8);
-    gltMakeSphere(marsBatch, marsRadius, 20, 10);
-    gltMakeSphere(jupiterBatch, jupiterRadius, 30, 15);
-    gltMakeSphere(saturnBatch, saturnRadius, 30, 15);
+    sunLod.Build(sunRadius);
+    mercuryLod.Build(mercuryRadius);
+    venusLod.Build(venusRadius);
+    earthLod.Build(earthRadius);
+    moonLod.Build(moonRadius);
+    marsLod.Build(marsRadius);
+    jupiterLod.Build(jupiterRadius);
+    saturnLod.Build(saturnRadius);
     gltMakeDisk(saturnRingBatch, saturnRingInnerRadius, saturnRingOuterRadius, 30, 15);
-    gltMakeSphere(uranusBatch, uranusRadius, 30, 15);
+    uranusLod.Build(uranusRadius);
     gltMakeDisk(uranusRingBatch, uranusRingInnerRadius, uranusRingOuterRadius, 30, 15);
-    gltMakeSphere(neptuneBatch, neptuneRadius, 30, 15);
-    gltMakeSphere(plutoBatch, plutoRadius, 16, 8);
-
-    gltMakeCircle(mercuryOrbitBatch, mercuryOrbitRadius, (int) (mercuryOrbitRadius * 50));
-    gltMakeCircle(venusOrbitBatch, venusOrbitRadius, (int) (venusOrbitRadius * 50));
-    gltMakeCircle(earthOrbitBatch, earthOrbitRadius, (int) (earthOrbitRadius * 50));
-    gltMakeCircle(moonOrbitBatch, moonOrbitRadius, (int) (moonOrbitRadius * 50));
-    gltMakeCircle(marsOrbitBatch, marsOrbitRadius, (int) (marsOrbitRadius * 50));
-    gltMakeCircle(jupiterOrbitBatch, jupiterOrbitRadius, (int) (jupiterOrbitRadius * 50));
-    gltMakeCircle(saturnOrbitBatch, saturnOrbitRadius, (int) (saturnOrbitRadius * 50));
-    gltMakeCircle(uranusOrbitBatch, uranusOrbitRadius, (int) (uranusOrbitRadius * 50));
-    gltMakeCircle(neptuneOrbitBatch, neptuneOrbitRadius, (int) (neptuneOrbitRadius * 50));
-    gltMakeCircle(plutoOrbitBatch, plutoOrbitRadius, (int) (plutoOrbitRadius * 50));
+    neptuneLod.Build(neptuneRadius);
+    plutoLod.Build(plutoRadius);
+
         
     // Make 3 texture objects
     glGenTextures(12, uiTextures);
@@ -287,22 +764,65 @@ void SetupRC()
     glBindTexture(GL_TEXTURE_2D, skyBoxTexture[5]);
     LoadTGATexture("img/skybox/back.tga", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT);
 
+    InitSimulation();
+    InitTransforms();
+    InitSimulationFrames();
 
-    solarShader = gltLoadShaderPairWithAttributes("src/SolarShader.vp", "src/SolarShader.fp", 3, GLT_ATTRIBUTE_VERTEX, "vVertex",
-                                                    GLT_ATTRIBUTE_TEXTURE0, "vTexCoords", GLT_ATTRIBUTE_NORMAL, "vNormal");
-
-    locLight = glGetUniformLocation(solarShader, "vLightPosition");
-    locMVP = glGetUniformLocation(solarShader, "mvpMatrix");
-    locMV  = glGetUniformLocation(solarShader, "mvMatrix");
-    locNM  = glGetUniformLocation(solarShader, "normalMatrix");
-    locDoubleLayer  = glGetUniformLocation(solarShader, "bIsDoubleLayer");
-    locObserverLight  = glGetUniformLocation(solarShader, "bObserverLight");
-
-
-    simpleShader = gltLoadShaderPairWithAttributes("src/SimpleShader.vp", "src/SimpleShader.fp", 1, GLT_ATTRIBUTE_VERTEX, "vVertex");
-
-    locSimpleColor = glGetUniformLocation(simpleShader, "vColor");
-    locSimpleMVP = glGetUniformLocation(simpleShader, "mvpMatrix");
+    // Built as they are first drawn
+    if(solarShaders.Load("src/SolarShader.vp", "src/SolarShader.fp", solarFeatures, sizeof(solarFeatures) / sizeof(solarFeatures[0]))) {
+        solarShaders.BindAttribute(GLT_ATTRIBUTE_VERTEX, "vVertex");
+        solarShaders.BindAttribute(GLT_ATTRIBUTE_TEXTURE0, "vTexCoords");
+        solarShaders.BindAttribute(GLT_ATTRIBUTE_NORMAL, "vNormal");
+    }
+    memset(solarLocations, 0, sizeof(solarLocations));
+
+    if(!orbitBatch.Init())
+        fprintf(stderr, "No geometry shaders, orbits will not be drawn\n");
+
+    if(!gpuTimer.Init())
+        fprintf(stderr, "No timer queries, GPU pass times will read 0\n");
+
+    // Textures in body order, skipping the Sun (0) and the ring (8)
+    static const int bodyTextureIndices[BODY_LAST] = { 1, 2, 3, 4, 5, 6, 7, 9, 10, 11 };
+    GetAverageTextureColor(uiTextures[0], sunColor);
+    for(int i = 0; i < BODY_LAST; i++)
+        GetAverageTextureColor(uiTextures[bodyTextureIndices[i]], bodyColors[i]);
+
+    if(!impostors.Init())
+        impostorsEnabled = false;
+    if(!rayCaster.Init())
+        rayCastingEnabled = false;
+
+    // The Sun, bodies and rings for the GPU, their textures as layers in that
+    // order
+    const int iRingLayer = BODY_LAST + 1;
+    GLuint layerTextures[BODY_LAST + 2] = { uiTextures[0] };
+    for(int i = 0; i < BODY_LAST; i++)
+        layerTextures[i + 1] = uiTextures[bodyTextureIndices[i]];
+    layerTextures[iRingLayer] = uiTextures[8];
+    // The array is only worth its memory once the rest is known to work
+    gpuDrivenAvailable = indirectBatch.Init();
+    if(gpuDrivenAvailable) {
+        bodyTextureArray = MakeTextureArray(layerTextures, BODY_LAST + 2);
+        gpuDrivenAvailable = bodyTextureArray != 0;
+        if(!gpuDrivenAvailable)
+            indirectBatch.Shutdown();
+    }
+    if(gpuDrivenAvailable) {
+        indirectBatch.SetTextures(bodyTextureArray);
+        indirectBatch.AddSphere(sunNode, sunRadius, sunRadius, 0, sunColor, false);
+        for(int i = 0; i < BODY_LAST; i++) {
+            indirectBatch.AddSphere(bodySpinNodes[i], bodyRadii[i], bodyBoundRadii[i], i + 1, bodyColors[i], true);
+            if(i == BODY_SATURN)
+                indirectBatch.AddRing(bodySpinNodes[i], saturnRingInnerRadius, saturnRingOuterRadius, bodyBoundRadii[i], iRingLayer);
+            else if(i == BODY_URANUS)
+                indirectBatch.AddRing(bodySpinNodes[i], uranusRingInnerRadius, uranusRingOuterRadius, bodyBoundRadii[i], iRingLayer);
+        }
+    }
+    else if(gpuDriven) {
+        fprintf(stderr, "GPU-driven drawing needs OpenGL 4.3, drawing from the CPU\n");
+        gpuDriven = false;
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -311,32 +831,94 @@ void ShutdownRC(void)
 {
     glDeleteTextures(12, uiTextures);
     glDeleteTextures(6, skyBoxTexture);
+    gpuTimer.Shutdown();
+    impostors.Shutdown();
+    rayCaster.Shutdown();
+    orbitBatch.Shutdown();
+    indirectBatch.Shutdown();
+    solarShaders.Shutdown();
+    memset(solarLocations, 0, sizeof(solarLocations));
+    if(bodyTextureArray != 0)
+        glDeleteTextures(1, &bodyTextureArray);
+    bodyTextureArray = 0;
+    gpuDrivenAvailable = false;
+    delete [] nodeModelViews;
+    nodeModelViews = NULL;
 }
 
 
 ///////////////////////////////////////////////////
-// Screen changes size or is initialized
-void ChangeSize(int nWidth, int nHeight)
+// Viewport and projection for a nWidth x nHeight target
+void SetupViewport(int nWidth, int nHeight)
 {
 	glViewport(0, 0, nWidth, nHeight);
+    windowWidth = nWidth;
+    windowHeight = nHeight;
 	
     // Create the projection matrix, and load it on the projection matrix stack
 	viewFrustum.SetPerspective(35.0f, float(nWidth)/float(nHeight), 0.01f, 160.0f);
+    lodPixelScale = 0.5f * float(nHeight) / tanf(float(m3dDegToRad(35.0f * 0.5f)));
 	projectionMatrix.LoadMatrix(viewFrustum.GetProjectionMatrix());
+
+    // The same frustum seen from a camera at the origin looking down -Z
+    GLFrame eye;
+    eyeFrustum.SetPerspective(35.0f, float(nWidth)/float(nHeight), 0.01f, 160.0f);
+    eyeFrustum.Transform(eye);
     
     // Set the transformation pipeline to use the two matrix stacks 
 	transformPipeline.SetMatrixStacks(modelViewMatrix, projectionMatrix);
 }
 
+///////////////////////////////////////////////////
+// Screen changes size or is initialized
+void ChangeSize(int nWidth, int nHeight)
+{
+    frameTimeLog.Note("window resized");
+    SetupViewport(nWidth, nHeight);
+    RequestRedraw();
+}
+
 bool fullScreen = false;
-bool speedBoost = false;
-bool stop = false;
 bool orbitsVisible = false;
-bool timeStop = false;
 bool lightOn = false;
 
+//////////////////////////////////////////////////////////////////
+// Latency measurement on and off. Turning it off prints the results.
+void ReportLatency(void)
+{
+    latencyMeter.Stop();
+    latencyMeter.Report(stdout);
+}
+
+// At exit the GL context may be gone, so no Stop(): frames still in flight
+// are left out
+void ReportLatencyAtExit(void)
+{
+    if(latencyMeter.IsRunning())
+        latencyMeter.Report(stdout);
+}
+
+void WriteFrameLog(void)
+{
+    if(!frameTimeLog.Write())
+        fprintf(stderr, "Cannot write the frame log\n");
+}
+
+void ToggleLatencyMeter(void)
+{
+    if(latencyMeter.IsRunning())
+        ReportLatency();
+    else if(latencyMeter.Start())
+        printf("Measuring input latency, press l again for the results\n");
+    else
+        fprintf(stderr, "No sync objects, cannot measure input latency\n");
+}
+
 void KeyDown(unsigned char key, int x, int y)
 {
+    latencyMeter.KeyPressed();
+    RequestRedraw();
+
     if(key == 'f'){
         if(fullScreen) {
             glutReshapeWindow(1024, 600);
@@ -348,13 +930,67 @@ void KeyDown(unsigned char key, int x, int y)
         }
     }
     else if(key == 32){
-        speedBoost = true;
+        cameraController.Press(CAMERA_BOOST, true);
     }
     else if(key == 's'){
-        timeStop ^= true; // toggle
+        simulationInput.nPauseToggles++;
+    }
+    else if(key == '+' || key == '='){
+        simulationInput.nScaleSteps++;
+    }
+    else if(key == '-'){
+        simulationInput.nScaleSteps--;
+    }
+    else if(key == '['){
+        simulationInput.nSeekSteps--;
+    }
+    else if(key == ']'){
+        simulationInput.nSeekSteps++;
+    }
+    else if(key == 'l'){
+        ToggleLatencyMeter();
+    }
+    else if(key == 'o'){
+        statsVisible = !statsVisible;
+    }
+    else if(key == 'k'){
+        cullingEnabled = !cullingEnabled;
+    }
+    else if(key == 'i'){
+        impostorsEnabled = !impostorsEnabled;
+    }
+    else if(key == 'h'){
+        shadowsEnabled = !shadowsEnabled;
+    }
+    else if(key == 'r'){
+        rayCastingEnabled = !rayCastingEnabled;
+    }
+    else if(key == 'x'){
+        perPixelLighting = !perPixelLighting;
     }
+    else if(key == 'g'){
+        gpuDriven = !gpuDriven && gpuDrivenAvailable;
+    }
+    else if(key == 'p'){
+        SetFramePacing(FRAME_PACING((frameScheduler.GetMode() + 1) % FRAME_PACING_LAST));
+        UpdateWindowTitle();
+    }
+#ifdef GLT_PROFILE
+    else if(key == 't'){
+        // First press starts a capture, the second writes it out
+        if(!gltProfileIsCapturing())
+            gltProfileBeginCapture();
+        else {
+            int nEvents = gltProfileEndCapture("solar_trace.json");
+            if(nEvents < 0)
+                fprintf(stderr, "Cannot write solar_trace.json\n");
+            else
+                printf("Wrote %d events to solar_trace.json\n", nEvents);
+        }
+    }
+#endif
     else if(key == 'c'){
-        stop = true;
+        cameraController.Press(CAMERA_STOP, true);
     }
     else if(key == 'v'){
         orbitsVisible = true;
@@ -369,11 +1005,13 @@ void KeyDown(unsigned char key, int x, int y)
 
 void KeyUp(unsigned char key, int x, int y)
 {
+    RequestRedraw();
+
     if(key == 32){
-        speedBoost = false;
+        cameraController.Press(CAMERA_BOOST, false);
     }
     else if(key == 'c'){
-        stop = false;
+        cameraController.Press(CAMERA_STOP, false);
     }
     else if(key == 'v'){
         orbitsVisible = false;
@@ -383,378 +1021,907 @@ void KeyUp(unsigned char key, int x, int y)
     }
 }
 
-bool leftKey = false;
-bool rightKey = false;
-bool upKey = false;
-bool downKey = false;
-
 void SpecialKeyDown(int key, int x, int y)
 {
+    latencyMeter.KeyPressed();
+    RequestRedraw();
+
     if(key == GLUT_KEY_UP)
-        upKey = true;
+        cameraController.Press(CAMERA_PITCH_UP, true);
     
     if(key == GLUT_KEY_DOWN)
-        downKey = true;
+        cameraController.Press(CAMERA_PITCH_DOWN, true);
     
     if(key == GLUT_KEY_LEFT)
-        leftKey = true;
+        cameraController.Press(CAMERA_ROLL_LEFT, true);
     
     if(key == GLUT_KEY_RIGHT)
-        rightKey = true;
+        cameraController.Press(CAMERA_ROLL_RIGHT, true);
 }
 
 
 void SpecialKeyUp(int key, int x, int y)
 {
+    RequestRedraw();
+
     if(key == GLUT_KEY_UP)
-        upKey = false;
+        cameraController.Press(CAMERA_PITCH_UP, false);
     
     if(key == GLUT_KEY_DOWN)
-        downKey = false;
+        cameraController.Press(CAMERA_PITCH_DOWN, false);
     
     if(key == GLUT_KEY_LEFT)
-        leftKey = false;
+        cameraController.Press(CAMERA_ROLL_LEFT, false);
     
     if(key == GLUT_KEY_RIGHT)
-        rightKey = false;
+        cameraController.Press(CAMERA_ROLL_RIGHT, false);
 }
 
 
+//////////////////////////////////////////////////////////////////
+// Pace the frames. The wait between them is a sleep, not a spin. In on-demand
+// mode the idle function unhooks itself while nothing moves, so GLUT blocks
+// waiting for events until RequestRedraw() hooks it back up.
 void IdleFunc()
 {
-    float upDown = float(m3dDegToRad(1.0f));
-    float leftRight = float(m3dDegToRad(3.0f));
+    if(!frameScheduler.IsFrameNeeded(simulationFrames.GetReadBuffer().bAnimating)) {
+        glutIdleFunc(NULL);
+        frameTimeLog.Restart();     // Idling is not a slow frame
+        return;
+    }
 
-    M3DVector3f vWorldXVect;
-    M3DVector3f vLocalXVect;
-    m3dLoadVector3(vLocalXVect, 1.0f, 0.0f, 0.0f); // load our up/down rotation vector
-    cameraFrame.LocalToWorld(vLocalXVect, vWorldXVect, true); // transform it to world coordinates
-    
-    if(upKey)
-        cameraFrame.RotateWorld(upDown, vWorldXVect[0], vWorldXVect[1], vWorldXVect[2]); // rotate around X axis
-    
-    if(downKey)
-        cameraFrame.RotateWorld(-upDown, vWorldXVect[0], vWorldXVect[1], vWorldXVect[2]); // rotate around X axis
+    frameScheduler.WaitForNextFrame();
+    glutPostRedisplay();
+}
 
-    M3DVector3f vWorldZVect;
-    M3DVector3f vLocalZVect;
-    m3dLoadVector3(vLocalZVect, 0.0f, 0.0f, 1.0f); // load our left/right rotation vector
-    cameraFrame.LocalToWorld(vLocalZVect, vWorldZVect, true); // transform it to world coordinates
-    
-    if(leftKey)
-        cameraFrame.RotateWorld(-leftRight, vWorldZVect[0], vWorldZVect[1], vWorldZVect[2]); // rotate around Z axis
-    
-    if(rightKey)
-        cameraFrame.RotateWorld(leftRight, vWorldZVect[0], vWorldZVect[1], vWorldZVect[2]); // rotate around Z axis
+void RequestRedraw(void)
+{
+    frameScheduler.Invalidate();
+    glutIdleFunc(IdleFunc);
 }
 
-void MoveForward(float distance)
+//////////////////////////////////////////////////////////////////
+// One fixed step of the simulation: apply the keys, move the bodies and the
+// camera, and publish the result for the renderer
+void SimulationStep(double dStep)
 {
-    M3DVector3f vWorldDistVect;
-    M3DVector3f vLocalDistVect;
-    m3dLoadVector3(vLocalDistVect, 0.0f, 0.0f, distance); // load our left/right rotation vector
-    cameraFrame.LocalToWorld(vLocalDistVect, vWorldDistVect, true); // transform it to world coordinates
-    
-    cameraFrame.TranslateWorld(vWorldDistVect[0], vWorldDistVect[1], vWorldDistVect[2]); // rotate around Z axis
+    GLT_PROFILE_FUNCTION();
+
+    // The camera runs on the real clock, keys and all. Headless runs have no
+    // keys and a clock of their own, one step per frame.
+    // Read before the input, so every key pressed up to nNow is in this step.
+    static int64_t nCameraTime = 0;
+    int64_t nNow;
+    if(headlessMode)
+        nNow = nCameraTime + int64_t(dStep * 1e9);
+    else {
+        nNow = CStopWatch::GetTimeNanoseconds();
+        if(nCameraTime == 0)
+            nCameraTime = nNow;
+    }
 
+    int nPauseToggles = simulationInput.nPauseToggles.exchange(0);
+    int nScaleSteps = simulationInput.nScaleSteps.exchange(0);
+    int nSeekSteps = simulationInput.nSeekSteps.exchange(0);
+
+    if(nPauseToggles % 2 != 0)
+        timeWarp.TogglePaused();
+    for(; nScaleSteps > 0; nScaleSteps--)
+        timeWarp.SpeedUp();
+    for(; nScaleSteps < 0; nScaleSteps++)
+        timeWarp.SlowDown();
+    if(nSeekSteps != 0)
+        SeekSimulation(timeWarp.GetSimTime() + 10.0 * nSeekSteps * timeWarp.GetScale());
+
+    AdvanceSimulation(timeWarp.Advance(dStep));
+    CaptureSnapshot();
+    UpdateTransforms();
+
+    if(cameraPath != NULL)
+        cameraPath->Apply(cameraFrame, cameraPathTime);
+    else
+        cameraController.Integrate(cameraFrame, nCameraTime, nNow);
+    nCameraTime = nNow;
+    if(cameraRecording != NULL)
+        CameraPath::WriteKey(cameraRecording, cameraPathTime, cameraFrame);
+    cameraPathTime += dStep;
+
+    SimulationFrame &frame = simulationFrames.GetWriteBuffer();
+    frame.dSimTime = timeWarp.GetSimTime();
+    frame.dScale = timeWarp.GetScale();
+    frame.bPaused = timeWarp.IsPaused();
+    frame.bAnimating = !frame.bPaused || cameraController.IsMoving() || cameraPath != NULL;
+    frame.camera = cameraFrame;
+    frame.cameraMotion = cameraController.GetMotion();
+    frame.nCameraTime = nCameraTime;
+    memcpy(&frame.worldMatrices[0], transforms.GetWorldMatrices(), frame.worldMatrices.size() * sizeof(float));
+    simulationFrames.Publish();
 }
 
-void RenderPlanet(GLTriangleBatch &planetBatch, GLBatch &planetOrbitBatch, float inclination, float orbitAngularPosition, float orbitRadius,
-                    float axialTilt, float rotation, GLuint texture, GLfloat* color,
-                    GLTriangleBatch* planetRingBatch = &emptyRingBatch, GLuint ringTexture = -1)
+//////////////////////////////////////////////////////////////////
+// State changes go through here so the stats overlay can count them
+void BindTexture(GLuint texture)
 {
-    modelViewMatrix.PushMatrix();
-        
-        modelViewMatrix.Rotate(inclination, 0.0f, 0.0f, 1.0f);
-        if(orbitsVisible){
-            glUseProgram(simpleShader);
-            glUniform4fv(locSimpleColor, 1, vWhite);
-            glUniformMatrix4fv(locSimpleMVP, 1, GL_FALSE, transformPipeline.GetModelViewProjectionMatrix());
-            planetOrbitBatch.Draw();
+    // Drivers tend to finish a texture's upload the first time it is drawn
+    // with, which shows up as a slow frame
+    static bool bDrawn[64];
+    if(texture < 64 && !bDrawn[texture]) {
+        bDrawn[texture] = true;
+        frameTimeLog.Note("first draw with a texture");
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    gltCountStateChange();
+}
+
+void UseProgram(GLuint program)
+{
+    glUseProgram(program);
+    gltCountStateChange();
+}
+
+//////////////////////////////////////////////////////////////////
+// Decide what is in view of camera. World matrices are rigid, so a node's
+// origin is the center of whatever hangs off it; the scene as a whole sits
+// 11 units down -Z, as RenderScene draws it.
+void CullBodies(GLFrame &camera, const float *worldMatrices)
+{
+    GLT_PROFILE_FUNCTION();
+
+    if(!cullingEnabled) {
+        memset(cullVisible, 1, sizeof(cullVisible));
+        cullVisibleCount = CULL_LAST;
+        return;
+    }
+
+    const M3DMatrix44f *pWorld = (const M3DMatrix44f *)worldMatrices;
+    for(int i = 0; i < CULL_LAST; i++) {
+        int iNode;
+        float fRadius;
+        if(i == CULL_SUN) {
+            iNode = sunNode;
+            fRadius = sunRadius;
         }
+        else if(i < CULL_ORBITS) {
+            iNode = bodySpinNodes[i - CULL_BODIES];
+            fRadius = bodyBoundRadii[i - CULL_BODIES];
+        }
+        else {
+            iNode = bodyOrbitNodes[i - CULL_ORBITS];
+            fRadius = bodyOrbitRadii[i - CULL_ORBITS];
+        }
+        m3dLoadVector4(cullSpheres[i], pWorld[iNode][12], pWorld[iNode][13], pWorld[iNode][14] - 11.0f, fRadius);
+    }
 
-        modelViewMatrix.Rotate(90.0, 1.0f, 0.0f, 0.0f);
-        modelViewMatrix.Rotate(orbitAngularPosition, 0.0f, 0.0f, 1.0f);
-        modelViewMatrix.Translate(orbitRadius, 0.0f, 0.0f);
-        modelViewMatrix.Rotate(orbitAngularPosition * (-1.0), 0.0f, 0.0f, 1.0f);
-        modelViewMatrix.Rotate(inclination * (-1.0), 0.0f, 1.0f, 0.0f);
+    viewFrustum.Transform(camera);
+    cullVisibleCount = viewFrustum.TestSpheres(cullSpheres, cullVisible, CULL_LAST);
+}
 
-        modelViewMatrix.PushMatrix();
-            modelViewMatrix.Rotate(axialTilt, 0.0f, 1.0f, 0.0f);
-            modelViewMatrix.Rotate(rotation, 0.0f, 0.0f, 1.0f);
-            glBindTexture(GL_TEXTURE_2D, texture);
-
-            static GLfloat vWhite[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-            glUseProgram(solarShader);
-            glUniform1i(glGetUniformLocation(solarShader, "colorMap"), 0);
-            glUniform1i(locDoubleLayer, GL_FALSE);
-            glUniform1i(locObserverLight, lightOn);
-            glUniform3fv(locLight, 1, vLightTransformed);
-            glUniformMatrix4fv(locMVP, 1, GL_FALSE, transformPipeline.GetModelViewProjectionMatrix());
-            glUniformMatrix4fv(locMV, 1, GL_FALSE, transformPipeline.GetModelViewMatrix());
-            glUniformMatrix3fv(locNM, 1, GL_FALSE, transformPipeline.GetNormalMatrix());
-
-            planetBatch.Draw();
-            if(planetRingBatch != &emptyRingBatch){
-                if(ringTexture != -1){
-                    glBindTexture(GL_TEXTURE_2D, ringTexture);
-                    glUniform1i(glGetUniformLocation(solarShader, "colorMap"), 0);
-                }
-                glUniform1i(locObserverLight, lightOn);
-                glUniform1i(locDoubleLayer, GL_TRUE);
-                planetRingBatch->Draw();
-            }
-        modelViewMatrix.PopMatrix();
+//////////////////////////////////////////////////////////////////
+// Every orbit ring in view, in one draw
+void RenderOrbits(void)
+{
+    GLT_PROFILE_FUNCTION();
 
-    modelViewMatrix.PopMatrix();
+    orbitBatch.Begin(lodPixelScale);
+    for(int i = 0; i < BODY_LAST; i++) {
+        if(!cullVisible[CULL_ORBITS + i])
+            continue;
+
+        const OrbitElements &elements = bodyOrbits[i].GetElements();
+        orbitBatch.Add(nodeModelViews[bodyOrbitNodes[i]], float(elements.dSemiMajorAxis), float(elements.dEccentricity));
+    }
+    orbitBatch.Draw(transformPipeline.GetProjectionMatrix(), vWhite, windowWidth, windowHeight);
 }
 
-float lastTime = 0.0f;
-float sunRot = 0.0f;
-        
-// Called to draw scene
-void RenderScene(void)
+//////////////////////////////////////////////////////////////////
+// Radius on screen, in pixels, of a sphere of fRadius centered where
+// mModelView puts the origin
+float GetPixelRadius(const M3DMatrix44f mModelView, float fRadius)
 {
-    // Color values
-    static GLfloat vSunColor[] = { 0.94f, 1.0f, 0.17f, 1.0f };
-    static GLfloat vEarthColor[] = { 0.17f, 0.54f, 1.0f, 1.0f };
-    static GLfloat vMoonColor[] = { 0.8f, 0.8f, 0.8f, 1.0f };
+    float fDistance = sqrtf(mModelView[12] * mModelView[12] + mModelView[13] * mModelView[13] + mModelView[14] * mModelView[14]);
+    if(fDistance <= fRadius)
+        return 1e6f;     // Inside it
+    return fRadius * lodPixelScale / fDistance;
+}
 
-    static GLfloat vLightPos[] = { 0.0f, 0.0f, -11.0f, 1.0f };
+// Queue a body as an impostor if it is small enough on screen. fBound covers
+// anything around it, such as rings, which an impostor leaves out.
+bool AddImpostor(const M3DMatrix44f mModelView, float fRadius, float fBound, const M3DVector3f vColor, bool bLit)
+{
+    if(!impostorsEnabled || GetPixelRadius(mModelView, fBound) >= IMPOSTOR_MAX_PIXELS)
+        return false;
 
-    // Time Based animation
-	static CStopWatch	rotTimer;
-    sunRot += timeStop ? 0.0f : (rotTimer.GetElapsedSeconds() - lastTime) * 35.0f;
-    lastTime = rotTimer.GetElapsedSeconds();
+    impostors.Add(&mModelView[12], fRadius, vColor, bLit);
+    return true;
+}
 
-    float mercuryOrb = sunRot * (3.5);
-    float mercuryRot = sunRot * (-5.0);
+//////////////////////////////////////////////////////////////////
+// Pick the tessellation for a sphere from its size on screen. mModelView
+// places its center.
+void SelectLod(SphereLod &lod, const M3DMatrix44f mModelView)
+{
+    lod.Select(GetPixelRadius(mModelView, lod.GetRadius()));
+}
 
-    float venusOrb = sunRot * (2.0);
-    float venusRot = sunRot * (4.0);
+//////////////////////////////////////////////////////////////////
+// Make the SolarShader permutation for nKey current, building it and
+// finding its uniforms the first time. NULL if it does not build.
+const SolarLocations *UseSolarProgram(unsigned int nKey)
+{
+    SolarLocations &loc = solarLocations[nKey];
+    if(loc.program == 0) {
+        if(solarShaders.IsBuilt(nKey))
+            return NULL;
+        frameTimeLog.Note("shader compiled");
+        loc.program = solarShaders.Get(nKey);
+        if(loc.program == 0)
+            return NULL;
+
+        loc.light = glGetUniformLocation(loc.program, "vLightPosition");
+        loc.MVP = glGetUniformLocation(loc.program, "mvpMatrix");
+        loc.MV = glGetUniformLocation(loc.program, "mvMatrix");
+        loc.NM = glGetUniformLocation(loc.program, "normalMatrix");
+        loc.sunRadius = glGetUniformLocation(loc.program, "fSunRadius");
+        loc.occluders = glGetUniformLocation(loc.program, "vOccluders");
+        loc.occluderCount = glGetUniformLocation(loc.program, "nOccluders");
+        loc.ringCenter = glGetUniformLocation(loc.program, "vRingCenter");
+        loc.ringNormal = glGetUniformLocation(loc.program, "vRingNormal");
+        loc.ringShadow = glGetUniformLocation(loc.program, "vRingShadow");
+        loc.atmosphere = glGetUniformLocation(loc.program, "vAtmosphereColor");
+        UseProgram(loc.program);
+        glUniform1i(glGetUniformLocation(loc.program, "colorMap"), 0);
+        return &loc;
+    }
+    UseProgram(loc.program);
+    return &loc;
+}
 
-    float earthOrb = sunRot * (0.5);
-    float earthRot = sunRot * (-7.0);
+// Which permutation draws iBody's surface, or its ring
+unsigned int GetSolarKey(int iBody, bool bRing)
+{
+    unsigned int nKey = 0;
+    if(lightOn)
+        nKey |= SOLAR_OBSERVER_LIGHT;
+    if(perPixelLighting)
+        nKey |= SOLAR_PER_PIXEL;
+    if(bRing)
+        return nKey | SOLAR_DOUBLE_LAYER;
+
+    if(bodyAtmosphereColors[iBody][0] + bodyAtmosphereColors[iBody][1] + bodyAtmosphereColors[iBody][2] > 0.0f)
+        nKey |= SOLAR_ATMOSPHERE;
+    if(shadowsEnabled && !lightOn && bodyRingRadii[iBody][1] > 0.0f)
+        nKey |= SOLAR_RING_SHADOW;
+    return nKey;
+}
 
-    float moonOrb = sunRot * (-2.0);
+//////////////////////////////////////////////////////////////////
+// Eclipse and ring shadow uniforms for drawing iBody's surface. The body
+// itself goes first, for its ring to be shadowed by; after it, every body
+// close enough to the line from the Sun to put some of iBody in penumbra.
+// None when the light is at the observer, where shadows cannot be seen.
+void SetShadowUniforms(const SolarLocations &loc, int iBody)
+{
+    M3DVector4f vOccluders[SHADOW_MAX_OCCLUDERS];
+    int nOccluders = 0;
+
+    if(shadowsEnabled && !lightOn) {
+        const float *vSun = &nodeModelViews[sunNode][12];
+        const float *vBody = &nodeModelViews[bodySpinNodes[iBody]][12];
+        m3dLoadVector4(vOccluders[nOccluders++], vBody[0], vBody[1], vBody[2], bodyRadii[iBody]);
+
+        M3DVector3f vAxis, vOffset;
+        m3dSubtractVectors3(vAxis, vBody, vSun);
+        float fBodyDistance = m3dGetVectorLength3(vAxis);
+        m3dScaleVector3(vAxis, 1.0f / fBodyDistance);
+        for(int j = 0; j < BODY_LAST && nOccluders < SHADOW_MAX_OCCLUDERS; j++) {
+            if(j == iBody)
+                continue;
+            const float *vOther = &nodeModelViews[bodySpinNodes[j]][12];
+            m3dSubtractVectors3(vOffset, vOther, vSun);
+            float fAlong = m3dDotProduct3(vOffset, vAxis);
+            if(fAlong <= 0.0f || fAlong >= fBodyDistance)
+                continue;
+
+            // The penumbra widens by the Sun's and occluder's radii over the
+            // occluder's distance from the Sun
+            float fReach = bodyBoundRadii[iBody] + bodyRadii[j] + (sunRadius + bodyRadii[j]) * (fBodyDistance - fAlong) / fAlong;
+            M3DVector3f vAcross;
+            for(int k = 0; k < 3; k++)
+                vAcross[k] = vOffset[k] - fAlong * vAxis[k];
+            if(m3dGetVectorLength3(vAcross) < fReach)
+                m3dLoadVector4(vOccluders[nOccluders++], vOther[0], vOther[1], vOther[2], bodyRadii[j]);
+        }
 
-    float marsOrb = sunRot * (0.4);
-    float marsRot = sunRot * (3.0);
+        glUniform1f(loc.sunRadius, sunRadius);
+        glUniform4fv(loc.occluders, nOccluders, vOccluders[0]);
+        if(loc.ringCenter != -1) {
+            glUniform3fv(loc.ringCenter, 1, vBody);
+            glUniform3fv(loc.ringNormal, 1, &nodeModelViews[bodySpinNodes[iBody]][8]);
+            glUniform3f(loc.ringShadow, bodyRingRadii[iBody][0], bodyRingRadii[iBody][1], RING_SHADOW_OPACITY);
+        }
+    }
 
-    float jupiterOrb = sunRot * (0.32);
-    float jupiterRot = sunRot * (-2.0);
+    glUniform1i(loc.occluderCount, nOccluders);
+}
 
-    float saturnOrb = sunRot * (0.27);
-    float saturnRot = sunRot * (3.0);
+// Everything but the texture, for the modelview on top of the stack
+void SetSolarUniforms(const SolarLocations &loc, int iBody)
+{
+    glUniform3fv(loc.light, 1, vLightTransformed);
+    glUniformMatrix4fv(loc.MVP, 1, GL_FALSE, transformPipeline.GetModelViewProjectionMatrix());
+    glUniformMatrix4fv(loc.MV, 1, GL_FALSE, transformPipeline.GetModelViewMatrix());
+    glUniformMatrix3fv(loc.NM, 1, GL_FALSE, transformPipeline.GetNormalMatrix());
+    glUniform3fv(loc.atmosphere, 1, bodyAtmosphereColors[iBody]);
+    SetShadowUniforms(loc, iBody);
+}
 
-    float uranusOrb = sunRot * (0.22);
-    float uranusRot = sunRot * (-4.0);
+void RenderPlanet(int iBody, SphereLod &planetLod, GLuint texture,
+                    GLTriangleBatch* planetRingBatch = &emptyRingBatch, GLuint ringTexture = -1)
+{
+    GLT_PROFILE_FUNCTION();
 
-    float neptuneOrb = sunRot * (0.18);
-    float neptuneRot = sunRot * (2.0);
+    if(!cullVisible[CULL_BODIES + iBody])
+        return;
 
-    float plutoOrb = sunRot * (0.15);
-    float plutoRot = sunRot * (1.0);
+    if(AddImpostor(nodeModelViews[bodySpinNodes[iBody]], planetLod.GetRadius(), bodyBoundRadii[iBody], bodyColors[iBody], true))
+        return;
 
-	// Clear the color and depth buffers
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    modelViewMatrix.PushMatrix();   
+    modelViewMatrix.PushMatrix();
+        modelViewMatrix.LoadMatrix(nodeModelViews[bodySpinNodes[iBody]]);
+        BindTexture(texture);
+
+        bool bRayCast = rayCastingEnabled &&
+                        rayCaster.Draw(nodeModelViews[bodySpinNodes[iBody]], transformPipeline.GetProjectionMatrix(),
+                                       planetLod.GetRadius(), vLightTransformed, lightOn, true);
+
+        const SolarLocations *pLoc;
+        if(!bRayCast && (pLoc = UseSolarProgram(GetSolarKey(iBody, false))) != NULL){
+            SetSolarUniforms(*pLoc, iBody);
+            SelectLod(planetLod, nodeModelViews[bodySpinNodes[iBody]]);
+            planetLod.Draw();
+        }
 
-    float dist = speedBoost ? 0.05f : 0.005f;
-    dist = stop ? 0.0f : dist;
-    MoveForward(dist);
-    
-    cameraFrame.GetCameraMatrix(mCamera);
-    m3dTransformVector4(vLightTransformed, vLightPos, mCamera);
-    modelViewMatrix.MultMatrix(mCamera);
-    
-    // Start position
-    modelViewMatrix.Translate(0.0f, 0.0f, -11.0f);
+        // The planet shadows its ring; the ring does not shadow itself
+        if(planetRingBatch != &emptyRingBatch && (pLoc = UseSolarProgram(GetSolarKey(iBody, true))) != NULL){
+            if(ringTexture != -1)
+                BindTexture(ringTexture);
+            SetSolarUniforms(*pLoc, iBody);
+            planetRingBatch->Draw();
+        }
+    modelViewMatrix.PopMatrix();
+}
 
-    /****************************
-     *          SKYBOX          *
-     ****************************/
-        
-    glBindTexture(GL_TEXTURE_2D, skyBoxTexture[0]);
+//////////////////////////////////////////////////////////////////
+// The skybox, drawn around the camera with the current modelview
+void RenderSkybox(void)
+{
+    GLT_PROFILE_FUNCTION();
+
+    BindTexture(skyBoxTexture[0]);
     shaderManager.UseStockShader(GLT_SHADER_TEXTURE_REPLACE,
                                  transformPipeline.GetModelViewProjectionMatrix(),
                                  0);
+    gltCountStateChange();
     skyBoxTop.Draw();
     
-    glBindTexture(GL_TEXTURE_2D, skyBoxTexture[1]);
+    BindTexture(skyBoxTexture[1]);
     skyBoxBottom.Draw();
     
-    glBindTexture(GL_TEXTURE_2D, skyBoxTexture[2]);
+    BindTexture(skyBoxTexture[2]);
     skyBoxLeft.Draw();
     
-    glBindTexture(GL_TEXTURE_2D, skyBoxTexture[3]);
+    BindTexture(skyBoxTexture[3]);
     skyBoxRight.Draw();
     
-    glBindTexture(GL_TEXTURE_2D, skyBoxTexture[4]);
+    BindTexture(skyBoxTexture[4]);
     skyBoxFront.Draw();
     
-    glBindTexture(GL_TEXTURE_2D, skyBoxTexture[5]);
+    BindTexture(skyBoxTexture[5]);
     skyBoxBack.Draw();
-    
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
+//////////////////////////////////////////////////////////////////
+// Text overlay with frame time, GPU time per pass and draw counts.
+// Bitmap fonts are fixed function, so no program is bound while it draws.
+void DrawText(int x, int y, const char *szText)
+{
+    glWindowPos2i(x, y);
+    for(const char *p = szText; *p != '\0'; p++)
+        glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *p);
+}
+
+void RenderStats(void)
+{
+    GLT_PROFILE_FUNCTION();
+
+    GLTDrawStats stats = gltDrawStats;     // What the scene took, before the text adds to it
+    char szLine[128];
+    int y = windowHeight - 18;
+
+    glUseProgram(0);
+    glDisable(GL_DEPTH_TEST);
+    glColor3f(1.0f, 1.0f, 0.6f);
+
+    sprintf(szLine, "frame %.2f ms (%.0f fps)", frameMilliseconds, frameMilliseconds > 0.0 ? 1000.0 / frameMilliseconds : 0.0);
+    DrawText(10, y, szLine);
+    y -= 15;
+
+    if(gpuTimer.IsAvailable()) {
+        sprintf(szLine, "gpu   %.2f ms", gpuTimer.GetFrameMilliseconds());
+        DrawText(10, y, szLine);
+        y -= 15;
+
+        for(int i = 0; i < GPU_PASS_LAST; i++) {
+            if(!gpuTimer.IsPassTimed(GPU_PASS(i)))
+                continue;
+            sprintf(szLine, "  %-8s %.3f ms", GpuTimer::GetPassName(GPU_PASS(i)), gpuTimer.GetPassMilliseconds(GPU_PASS(i)));
+            DrawText(10, y, szLine);
+            y -= 15;
+        }
+    }
+
+    sprintf(szLine, "draws %u  triangles %u  state changes %u", stats.nDrawCalls, stats.nTriangles, stats.nStateChanges);
+    DrawText(10, y, szLine);
+    y -= 15;
+
+    if(gpuDriven)
+        sprintf(szLine, "culling %s on the GPU, %d objects in one indirect draw", cullingEnabled ? "on" : "off",
+                indirectBatch.GetObjectCount());
+    else
+        sprintf(szLine, "culling %s: %d visible, %d culled (sun, bodies, orbits); %d impostors", cullingEnabled ? "on" : "off",
+                cullVisibleCount, CULL_LAST - cullVisibleCount, impostors.GetCount());
+    DrawText(10, y, szLine);
+
+    if(latencyMeter.IsRunning()) {
+        y -= 15;
+        sprintf(szLine, "input latency %.1f ms median, %.1f ms p99 (%d presses)",
+                latencyMeter.GetPercentile(50.0), latencyMeter.GetPercentile(99.0), latencyMeter.GetSampleCount());
+        DrawText(10, y, szLine);
+    }
+
+    const FrameHistogram &recent = frameTimeLog.GetRecent();
+    y -= 15;
+    sprintf(szLine, "last %lld frames: p50 %.2f  p99 %.2f  max %.2f ms, %d stutters", (long long)recent.GetCount(),
+            recent.GetPercentile(50.0), recent.GetPercentile(99.0), recent.GetPercentile(100.0), frameTimeLog.GetStutterCount());
+    DrawText(10, y, szLine);
+
+    glEnable(GL_DEPTH_TEST);
+}
+
+//////////////////////////////////////////////////////////////////
+// Show the time scale and frame pacing in the title bar
+void UpdateWindowTitle(void)
+{
+    const SimulationFrame &frame = simulationFrames.GetReadBuffer();
+    char szTitle[96];
+    if(frame.bPaused)
+        sprintf(szTitle, "Solar System v0.1 - paused - %s", FrameScheduler::GetModeName(frameScheduler.GetMode()));
+    else
+        sprintf(szTitle, "Solar System v0.1 - %.0fx - %s", frame.dScale, FrameScheduler::GetModeName(frameScheduler.GetMode()));
+    glutSetWindowTitle(szTitle);
+}
+
+//////////////////////////////////////////////////////////////////
+// Switch frame pacing. Only vsync mode lets the swap wait for the display.
+void SetFramePacing(FRAME_PACING eMode)
+{
+    frameTimeLog.Note("frame pacing changed");
+    frameScheduler.SetMode(eMode);
+    int nInterval = (eMode == FRAME_PACING_VSYNC) ? 1 : 0;
+
+#if !defined(WIN32) && !defined(__APPLE__)
+    if(GLXEW_EXT_swap_control)
+        glXSwapIntervalEXT(glXGetCurrentDisplay(), glXGetCurrentDrawable(), nInterval);
+    else if(GLXEW_SGI_swap_control && nInterval > 0)
+        glXSwapIntervalSGI(nInterval);
+#endif
+
+    RequestRedraw();
+}
+
+//////////////////////////////////////////////////////////////////
+// The Sun and bodies a draw at a time, sized and culled on the CPU
+void RenderBodies(void)
+{
+    GLT_PROFILE_FUNCTION();
 
     /****************************
      *           SUN            *
      ****************************/
-    modelViewMatrix.PushMatrix();
+    gpuTimer.BeginPass(GPU_PASS_SUN);
+    if(cullVisible[CULL_SUN] && !AddImpostor(nodeModelViews[sunNode], sunRadius, sunRadius, sunColor, false)) {
+        modelViewMatrix.PushMatrix();
     
-        // Apply a rotation and draw the Sun
-        modelViewMatrix.Rotate(90.0, 1.0f, 0.0f, 0.0f);
-        modelViewMatrix.Rotate(sunRot, 0.0f, 0.0f, 1.0f);
-        glBindTexture(GL_TEXTURE_2D, uiTextures[0]);
-        shaderManager.UseStockShader(GLT_SHADER_TEXTURE_REPLACE,
-                                     transformPipeline.GetModelViewProjectionMatrix(),
-                                     0);
+            // Apply a rotation and draw the Sun
+            modelViewMatrix.LoadMatrix(nodeModelViews[sunNode]);
+            BindTexture(uiTextures[0]);
+            if(!rayCastingEnabled ||
+               !rayCaster.Draw(nodeModelViews[sunNode], transformPipeline.GetProjectionMatrix(),
+                               sunRadius, vLightTransformed, lightOn, false)) {
+                shaderManager.UseStockShader(GLT_SHADER_TEXTURE_REPLACE,
+                                             transformPipeline.GetModelViewProjectionMatrix(),
+                                             0);
+                gltCountStateChange();
+
+                SelectLod(sunLod, nodeModelViews[sunNode]);
+                sunLod.Draw();
+            }
+        modelViewMatrix.PopMatrix();
+    }
+    gpuTimer.EndPass(GPU_PASS_SUN);
 
-        sunBatch.Draw();
-    modelViewMatrix.PopMatrix();
+    gpuTimer.BeginPass(GPU_PASS_PLANETS);
 
     /****************************
      *         MERCURY          *
      ****************************/
     
-    RenderPlanet(mercuryBatch, mercuryOrbitBatch, mercuryOrbitInclination, mercuryOrb, mercuryOrbitRadius, mercuryAxialTilt, mercuryRot, uiTextures[1], vWhite);
+    RenderPlanet(BODY_MERCURY, mercuryLod, uiTextures[1]);
 
     /****************************
      *          VENUS           *
      ****************************/
     
-    RenderPlanet(venusBatch, venusOrbitBatch, venusOrbitInclination, venusOrb, venusOrbitRadius, venusAxialTilt, venusRot, uiTextures[2], vWhite);
+    RenderPlanet(BODY_VENUS, venusLod, uiTextures[2]);
 
     /****************************
      *          EARTH           *
      ****************************/
-    modelViewMatrix.PushMatrix();
-
-        modelViewMatrix.Rotate(earthOrbitInclination, 0.0f, 0.0f, 1.0f);
-        if(orbitsVisible){
-            glUseProgram(simpleShader);
-            glUniform4fv(locSimpleColor, 1, vWhite);
-            glUniformMatrix4fv(locSimpleMVP, 1, GL_FALSE, transformPipeline.GetModelViewProjectionMatrix());
-            earthOrbitBatch.Draw();
-        }
-
-        modelViewMatrix.Rotate(90.0, 1.0f, 0.0f, 0.0f);
-        modelViewMatrix.Rotate(earthOrb, 0.0f, 0.0f, 1.0f);
-        modelViewMatrix.Translate(earthOrbitRadius, 0.0f, 0.0f);
-        modelViewMatrix.Rotate(earthOrb * (-1.0), 0.0f, 0.0f, 1.0f);
-        modelViewMatrix.Rotate(earthOrbitInclination * (-1.0), 0.0f, 1.0f, 0.0f);
-
-        modelViewMatrix.PushMatrix();
-            modelViewMatrix.Rotate(earthAxialTilt, 0.0f, 1.0f, 0.0f);
-            modelViewMatrix.Rotate(earthRot, 0.0f, 0.0f, 1.0f);
-            glBindTexture(GL_TEXTURE_2D, uiTextures[3]);
-
-            glUseProgram(solarShader);
-            glUniform1i(glGetUniformLocation(solarShader, "colorMap"), 0);
-            glUniform1i(locDoubleLayer, GL_FALSE);
-            glUniform1i(locObserverLight, lightOn);
-            glUniform3fv(locLight, 1, vLightTransformed);
-            glUniformMatrix4fv(locMVP, 1, GL_FALSE, transformPipeline.GetModelViewProjectionMatrix());
-            glUniformMatrix4fv(locMV, 1, GL_FALSE, transformPipeline.GetModelViewMatrix());
-            glUniformMatrix3fv(locNM, 1, GL_FALSE, transformPipeline.GetNormalMatrix());
-
-            earthBatch.Draw();
-        modelViewMatrix.PopMatrix();
-
-        /****************************
-         *          MOON            *
-         ****************************/
-        modelViewMatrix.Rotate(-90.0, 1.0f, 0.0f, 0.0f);
-        modelViewMatrix.Rotate(moonOrbitInclination, 0.0f, 1.0f, 0.0f);
-        if(orbitsVisible){
-            glUseProgram(simpleShader);
-            glUniform4fv(locSimpleColor, 1, vWhite);
-            glUniformMatrix4fv(locSimpleMVP, 1, GL_FALSE, transformPipeline.GetModelViewProjectionMatrix());
-            moonOrbitBatch.Draw();
-        }
-        modelViewMatrix.Rotate(90.0, 1.0f, 0.0f, 0.0f);
-
-        modelViewMatrix.Rotate(moonOrb, 0.0f, 0.0f, 1.0f);
-        modelViewMatrix.Translate(moonOrbitRadius, 0.0f, 0.0f);
-        modelViewMatrix.Rotate(moonOrb * (-1.0), 0.0f, 0.0f, 1.0f);
-        modelViewMatrix.Rotate(moonOrbitInclination * (-1.0), 0.0f, 1.0f, 0.0f);
-        modelViewMatrix.Rotate(moonAxialTilt, 0.0f, 1.0f, 0.0f);
-        glBindTexture(GL_TEXTURE_2D, uiTextures[4]);
-
-        glUseProgram(solarShader);
-        glUniform3fv(locLight, 1, vLightTransformed);
-        glUniform1i(locDoubleLayer, GL_FALSE);
-        glUniform1i(locObserverLight, lightOn);
-        glUniformMatrix4fv(locMVP, 1, GL_FALSE, transformPipeline.GetModelViewProjectionMatrix());
-        glUniformMatrix4fv(locMV, 1, GL_FALSE, transformPipeline.GetModelViewMatrix());
-        glUniformMatrix3fv(locNM, 1, GL_FALSE, transformPipeline.GetNormalMatrix());
-
-        moonBatch.Draw();
+    
+    RenderPlanet(BODY_EARTH, earthLod, uiTextures[3]);
 
-    modelViewMatrix.PopMatrix();
+    /****************************
+     *          MOON            *
+     ****************************/
+    
+    RenderPlanet(BODY_MOON, moonLod, uiTextures[4]);
 
     /****************************
      *          MARS            *
      ****************************/
     
-    RenderPlanet(marsBatch, marsOrbitBatch, marsOrbitInclination, marsOrb, marsOrbitRadius, marsAxialTilt, marsRot, uiTextures[5], vWhite);
+    RenderPlanet(BODY_MARS, marsLod, uiTextures[5]);
 
     /****************************
      *         JUPITER          *
      ****************************/
     
-    RenderPlanet(jupiterBatch, jupiterOrbitBatch, jupiterOrbitInclination, jupiterOrb, jupiterOrbitRadius, jupiterAxialTilt, jupiterRot, uiTextures[6], vWhite);
+    RenderPlanet(BODY_JUPITER, jupiterLod, uiTextures[6]);
 
     /****************************
      *          SATURN          *
      ****************************/
     
-    RenderPlanet(saturnBatch, saturnOrbitBatch, saturnOrbitInclination, saturnOrb, saturnOrbitRadius, saturnAxialTilt, saturnRot, uiTextures[7], vWhite, &saturnRingBatch, uiTextures[8]);
+    RenderPlanet(BODY_SATURN, saturnLod, uiTextures[7], &saturnRingBatch, uiTextures[8]);
 
     /****************************
      *          URANUS          *
      ****************************/
     
-    RenderPlanet(uranusBatch, uranusOrbitBatch, uranusOrbitInclination, uranusOrb, uranusOrbitRadius, uranusAxialTilt, uranusRot, uiTextures[9], vWhite, &uranusRingBatch, uiTextures[8]);
+    RenderPlanet(BODY_URANUS, uranusLod, uiTextures[9], &uranusRingBatch, uiTextures[8]);
 
     /****************************
      *         NEPTUNE          *
      ****************************/
     
-    RenderPlanet(neptuneBatch, neptuneOrbitBatch, neptuneOrbitInclination, neptuneOrb, neptuneOrbitRadius, neptuneAxialTilt, neptuneRot, uiTextures[10], vWhite);
+    RenderPlanet(BODY_NEPTUNE, neptuneLod, uiTextures[10]);
 
     /****************************
      *          PLUTO           *
      ****************************/
     
-    RenderPlanet(plutoBatch, plutoOrbitBatch, plutoOrbitInclination, plutoOrb, plutoOrbitRadius, plutoAxialTilt, plutoRot, uiTextures[11], vWhite);
+    RenderPlanet(BODY_PLUTO, plutoLod, uiTextures[11]);
+    impostors.Draw(transformPipeline.GetProjectionMatrix(), lodPixelScale, vLightTransformed, lightOn);
+    gpuTimer.EndPass(GPU_PASS_PLANETS);
+}
+
+// Called to draw scene
+void RenderScene(void)
+{
+    GLT_PROFILE_FUNCTION();
+
+    // Color values
+    static GLfloat vSunColor[] = { 0.94f, 1.0f, 0.17f, 1.0f };
+    static GLfloat vEarthColor[] = { 0.17f, 0.54f, 1.0f, 1.0f };
+    static GLfloat vMoonColor[] = { 0.8f, 0.8f, 0.8f, 1.0f };
+
+    static GLfloat vLightPos[] = { 0.0f, 0.0f, -11.0f, 1.0f };
+
+    // Time Based animation
+	static CStopWatch	frameTimer;
+    double dRealDelta = frameTimer.Lap();
+    frameMilliseconds += (dRealDelta * 1000.0 - frameMilliseconds) * 0.1;
+
+    // Without the simulation thread, step it here. Headless runs step a fixed
+    // 60th of a second so every run draws the same frames.
+    if(!simulationThread.IsRunning())
+        SimulationStep(headlessMode ? 1.0 / 60.0 : dRealDelta);
+
+    simulationFrames.Update();
+    const SimulationFrame &frame = simulationFrames.GetReadBuffer();
+    latencyMeter.Poll();
+
+    static double dTitleScale = 0.0;
+    static bool bTitlePaused = false;
+    if(!headlessMode && (frame.dScale != dTitleScale || frame.bPaused != bTitlePaused)) {
+        dTitleScale = frame.dScale;
+        bTitlePaused = frame.bPaused;
+        UpdateWindowTitle();
+    }
+
+    gltResetDrawStats();
+    gpuTimer.BeginFrame();
+
+	// Clear the color and depth buffers
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    
+    modelViewMatrix.PushMatrix();   
+
+    // The simulation placed the camera a little while ago. Carry it on to
+    // now, so turning answers at the frame rate rather than the step rate.
+    GLFrame camera = frame.camera;
+    if(simulationThread.IsRunning() && cameraPath == NULL) {
+        double dAhead = double(CStopWatch::GetTimeNanoseconds() - frame.nCameraTime) * 1e-9;
+        if(dAhead > 0.0)
+            CameraController::Predict(camera, frame.cameraMotion, float(dAhead < CAMERA_MAX_PREDICTION ? dAhead : CAMERA_MAX_PREDICTION));
+    }
+
+    CullBodies(camera, &frame.worldMatrices[0]);
+
+    M3DMatrix44f mCamera;
+    camera.GetCameraMatrix(mCamera);
+    m3dTransformVector4(vLightTransformed, vLightPos, mCamera);
+    modelViewMatrix.MultMatrix(mCamera);
+    
+    // Start position
+    modelViewMatrix.Translate(0.0f, 0.0f, -11.0f);
+
+    // Every body's modelview in one go
+    m3dMatrixMultiply44Batch(nodeModelViews, modelViewMatrix.GetMatrix(), (const M3DMatrix44f *)&frame.worldMatrices[0], transforms.GetNodeCount());
+
+    gpuTimer.BeginPass(GPU_PASS_SKYBOX);
+    RenderSkybox();
+    gpuTimer.EndPass(GPU_PASS_SKYBOX);
+    
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    impostors.Begin();
+    if(gpuDriven) {
+        gpuTimer.BeginPass(GPU_PASS_INDIRECT);
+        indirectBatch.Draw((const M3DMatrix44f *)&frame.worldMatrices[0], transforms.GetNodeCount(), modelViewMatrix.GetMatrix(),
+                           eyeFrustum, transformPipeline.GetProjectionMatrix(), lodPixelScale, vLightTransformed, lightOn,
+                           cullingEnabled, impostorsEnabled, impostors);
+        gpuTimer.EndPass(GPU_PASS_INDIRECT);
+    }
+    else
+        RenderBodies();
+
+    /****************************
+     *          ORBITS          *
+     ****************************/
+    
+    if(orbitsVisible){
+        gpuTimer.BeginPass(GPU_PASS_ORBITS);
+        RenderOrbits();
+        gpuTimer.EndPass(GPU_PASS_ORBITS);
+    }
+
+    if(statsVisible && !headlessMode){
+        gpuTimer.BeginPass(GPU_PASS_OVERLAY);
+        RenderStats();
+        gpuTimer.EndPass(GPU_PASS_OVERLAY);
+    }
+    gpuTimer.EndFrame();
 
 	// Restore the previous modleview matrix (the identity matrix)
 	// modelViewMatrix.PopMatrix();
     modelViewMatrix.PopMatrix();    
     // Do the buffer Swap
-    glutSwapBuffers();
-        
-    // Tell GLUT to do it again
-    glutPostRedisplay();
+    {
+        GLT_PROFILE_SCOPE("SwapBuffers");
+        if(headlessMode)
+            headlessContext.SwapBuffers();
+        else
+            glutSwapBuffers();
+    }
+    latencyMeter.FrameSwapped(frame.nCameraTime);
+    frameTimeLog.FrameDone();
+    frameScheduler.FrameDone();
 }
 
 
 
 
+#ifndef SOLAR_NO_MAIN
+
+//////////////////////////////////////////////////////////////////
+// Draw nFrames as fast as possible with no window, then print the timings
+// and optionally save the last frame
+int RunHeadless(int nWidth, int nHeight, int nFrames, const char *szImage)
+{
+    if(!headlessContext.Create(nWidth, nHeight))
+        return 1;
+
+    CStopWatch setupTimer;
+    SetupRC();
+    double dSetupSeconds = setupTimer.GetElapsedSeconds();
+    SetupViewport(nWidth, nHeight);
+    printf("%s, %d x %d, %d frames\n", (const char *)glGetString(GL_RENDERER), nWidth, nHeight, nFrames);
+
+    CStopWatch runTimer;
+    for(int i = 0; i < nFrames; i++)
+        RenderScene();
+    glFinish();
+    double dSeconds = runTimer.GetElapsedSeconds();
+
+    printf("%.3f s, %.3f ms per frame, %.1f fps\n", dSeconds, dSeconds * 1000.0 / nFrames, nFrames / dSeconds);
+    printf("draws %u  triangles %u  state changes %u per frame\n",
+           gltDrawStats.nDrawCalls, gltDrawStats.nTriangles, gltDrawStats.nStateChanges);
+    printf("setup %.3f s, shader cache %s: %u loaded, %u rejected, %u stored\n", dSetupSeconds,
+           gltProgramCacheIsEnabled() ? "on" : "off", gltProgramCacheStats.nLoaded,
+           gltProgramCacheStats.nRejected, gltProgramCacheStats.nStored);
+
+    gpuTimer.CollectAll();
+    int nCollected = gpuTimer.GetCollectedFrames();
+    if(nCollected > 0) {
+        printf("gpu      %.3f ms\n", gpuTimer.GetFrameTotal() / nCollected);
+        for(int i = 0; i < GPU_PASS_LAST; i++)
+            if(gpuTimer.GetPassFrames(GPU_PASS(i)) > 0)
+                printf("  %-8s %.3f ms\n", GpuTimer::GetPassName(GPU_PASS(i)), gpuTimer.GetPassTotal(GPU_PASS(i)) / nCollected);
+    }
+
+    int nResult = 0;
+    if(szImage != NULL && !headlessContext.SaveImage(szImage)) {
+        fprintf(stderr, "Cannot write %s\n", szImage);
+        nResult = 1;
+    }
+
+    ShutdownRC();
+    headlessContext.Destroy();
+    return nResult;
+}
+
 int main(int argc, char* argv[])
 {
 	gltSetWorkingDirectory(argv[0]);
+    gltProfileSetThreadName("main");
 		
-    glutInit(&argc, argv);
+    // GLUT would insist on an X display
+    for(int i = 1; i < argc; i++)
+        if(strcmp(argv[i], "--headless") == 0)
+            headlessMode = true;
+    if(!headlessMode)
+        glutInit(&argc, argv);
+
+    // What is left after GLUT took its own options
+    const char *szEphemeris = NULL;
+    const char *szSnapshots = NULL;
+    double dEpoch = 0.0;
+    FRAME_PACING ePacing = FRAME_PACING_TARGET_FPS;
+    int nWidth = 800, nHeight = 600;
+    int nFrames = 300;
+    const char *szImage = NULL;
+    const char *szCameraPath = NULL;
+    const char *szRecording = NULL;
+    const char *szShaderCache = NULL;
+    bool bShaderCache = true;
+    bool bLatency = false;
+    const char *szFrameLog = NULL;
+    double dFrameLogPeriod = FRAME_LOG_PERIOD;
+    double dStutterFactor = 0.0;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--ephemeris") == 0 && i + 1 < argc)
+            szEphemeris = argv[++i];
+        else if(strcmp(argv[i], "--epoch") == 0 && i + 1 < argc)
+            dEpoch = atof(argv[++i]);
+        else if(strcmp(argv[i], "--snapshots") == 0 && i + 1 < argc)
+            szSnapshots = argv[++i];
+        else if(strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            frameScheduler.SetTargetFPS(atof(argv[++i]));
+        else if(strcmp(argv[i], "--vsync") == 0)
+            ePacing = FRAME_PACING_VSYNC;
+        else if(strcmp(argv[i], "--on-demand") == 0)
+            ePacing = FRAME_PACING_ON_DEMAND;
+        else if(strcmp(argv[i], "--stats") == 0)
+            statsVisible = true;
+        else if(strcmp(argv[i], "--latency") == 0)
+            bLatency = true;
+        else if(strcmp(argv[i], "--no-cull") == 0)
+            cullingEnabled = false;
+        else if(strcmp(argv[i], "--no-impostors") == 0)
+            impostorsEnabled = false;
+        else if(strcmp(argv[i], "--ray-cast") == 0)
+            rayCastingEnabled = true;
+        else if(strcmp(argv[i], "--no-shadows") == 0)
+            shadowsEnabled = false;
+        else if(strcmp(argv[i], "--per-vertex") == 0)
+            perPixelLighting = false;
+        else if(strcmp(argv[i], "--shader-cache") == 0 && i + 1 < argc)
+            szShaderCache = argv[++i];
+        else if(strcmp(argv[i], "--no-shader-cache") == 0)
+            bShaderCache = false;
+        else if(strcmp(argv[i], "--orbits") == 0)
+            orbitsVisible = true;
+        else if(strcmp(argv[i], "--gpu-driven") == 0)
+            gpuDriven = true;
+        else if(strcmp(argv[i], "--frame-log") == 0 && i + 1 < argc)
+            szFrameLog = argv[++i];
+        else if(strcmp(argv[i], "--frame-log-period") == 0 && i + 1 < argc && (dFrameLogPeriod = atof(argv[i + 1])) > 0.0)
+            i++;
+        else if(strcmp(argv[i], "--stutter-factor") == 0 && i + 1 < argc && (dStutterFactor = atof(argv[i + 1])) > 1.0)
+            i++;
+        else if(strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc && (simulationRate = atof(argv[i + 1])) >= 0.0)
+            i++;
+        else if(strcmp(argv[i], "--headless") == 0)
+            ;
+        else if(strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &nWidth, &nHeight) == 2 && nWidth > 0 && nHeight > 0)
+            i++;
+        else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc && (nFrames = atoi(argv[i + 1])) > 0)
+            i++;
+        else if(strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            szImage = argv[++i];
+        else if(strcmp(argv[i], "--camera-path") == 0 && i + 1 < argc)
+            szCameraPath = argv[++i];
+        else if(strcmp(argv[i], "--record-camera") == 0 && i + 1 < argc)
+            szRecording = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--ephemeris file.bin [--epoch JD]] [--snapshots file] [--fps N] [--vsync | --on-demand] [--stats] [--latency] [--no-cull] [--no-impostors] [--no-shadows] [--per-vertex] [--ray-cast] [--gpu-driven] [--orbits]\n"
+                            "       [--sim-rate N] [--frame-log file.json|file.csv [--frame-log-period s]] [--stutter-factor k]\n"
+                            "       [--shader-cache dir | --no-shader-cache]\n"
+                            "       [--camera-path file | --record-camera file] [--headless [--size WxH] [--frames N] [--output file.tga]]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if(!bShaderCache)
+        shaderCacheDirectory = NULL;
+    else if(szShaderCache == NULL)
+        shaderCacheDirectory = MakeShaderCacheDirectory();
+    else if(MakeDirectory(szShaderCache))
+        shaderCacheDirectory = szShaderCache;
+    else
+        fprintf(stderr, "Cannot keep the shader cache in %s\n", szShaderCache);
+
+    if(szSnapshots != NULL && !snapshots.OpenFile(szSnapshots)) {
+        fprintf(stderr, "Cannot write snapshots to %s\n", szSnapshots);
+        return 1;
+    }
+
+    if(szEphemeris != NULL && !OpenEphemeris(szEphemeris, dEpoch))
+        return 1;
+
+    if(szCameraPath != NULL) {
+        if(!loadedCameraPath.Load(szCameraPath)) {
+            fprintf(stderr, "Cannot read a camera path from %s\n", szCameraPath);
+            return 1;
+        }
+        cameraPath = &loadedCameraPath;
+    }
+
+    if(szRecording != NULL && (cameraRecording = fopen(szRecording, "w")) == NULL) {
+        fprintf(stderr, "Cannot write the camera path to %s\n", szRecording);
+        return 1;
+    }
+
+    if(dStutterFactor > 0.0)
+        frameTimeLog.SetStutterFactor(dStutterFactor);
+    if(szFrameLog != NULL) {
+        frameTimeLog.SetOutput(szFrameLog, dFrameLogPeriod);
+        gltProfileKeepRecent(true);     // Stutters list the scopes they overlapped
+        atexit(WriteFrameLog);
+    }
+
+    if(headlessMode)
+        return RunHeadless(nWidth, nHeight, nFrames, szImage);
+
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
-    glutInitWindowSize(800,600);
+    glutInitWindowSize(nWidth, nHeight);
   
     glutCreateWindow("Solar System v0.1");
     
     glutIdleFunc(IdleFunc); 
+    glutIgnoreKeyRepeat(1);     // Key events are timed; auto-repeat would fake releases
     glutKeyboardFunc(KeyDown);
     glutKeyboardUpFunc(KeyUp);
     glutSpecialFunc(SpecialKeyDown);
@@ -770,11 +1937,22 @@ int main(int argc, char* argv[])
     }
 
     SetupRC();
+    SetFramePacing(ePacing);
+    UpdateWindowTitle();
+    if(simulationRate > 0.0)
+        simulationThread.Start(SimulationStep, simulationRate);
+    if(bLatency) {
+        ToggleLatencyMeter();
+        atexit(ReportLatencyAtExit);    // GLUT leaves by exit()
+    }
     glutMainLoop();    
+    simulationThread.Stop();
     ShutdownRC();
     return 0;
 }
 
+#endif
+
 void gltMakeSkyboxTop(GLBatch& cubeBatch, GLfloat fRadius )
 {
     cubeBatch.Begin(GL_TRIANGLES, 6, 1);
@@ -961,17 +2139,3 @@ void gltMakeSkyboxBack(GLBatch& cubeBatch, GLfloat fRadius )
 
     cubeBatch.End();
 }   
-
-void gltMakeCircle(GLBatch& circleBatch, GLfloat fRadius, int points )
-{
-    circleBatch.Begin(GL_LINES, points);
-
-    float alpha = 0.0f;
-    for(int i = 0; i < points; i++){
-        circleBatch.Normal3f(0.0f, 1.0f, 0.0f);
-        circleBatch.Vertex3f(fRadius * cos(alpha), 0.0f, fRadius * sin(alpha));
-        alpha += 2.0f * PI / points;
-    }
-
-    circleBatch.End();
-}
@@ -0,0 +1,35 @@
+// solar.h
+// The parts of solar.cpp that the tools built around it (solar_bench) drive.
+// Build solar.cpp with SOLAR_NO_MAIN to link it into another program.
+
+#ifndef __SOLAR_SOLAR
+#define __SOLAR_SOLAR
+
+#include "GpuTimer.h"
+#include "HeadlessContext.h"
+#include "CameraPath.h"
+
+extern bool             headlessMode;
+extern HeadlessContext  headlessContext;
+extern GpuTimer         gpuTimer;
+
+extern CameraPath       *cameraPath;        // Flies the camera when not NULL, instead of the keys
+extern double           cameraPathTime;     // Seconds along cameraPath
+
+extern bool             cullingEnabled;
+extern int              cullVisibleCount;   // Sun, bodies and orbits that passed the frustum test last frame
+extern bool             impostorsEnabled;
+extern bool             shadowsEnabled;     // Eclipses and ring shadows
+extern bool             perPixelLighting;   // Else SolarShader lights per vertex
+extern bool             rayCastingEnabled;  // Spheres ray cast on quads instead of meshes
+extern bool             gpuDriven;          // The Sun and bodies culled and submitted by a compute pass
+extern bool             orbitsVisible;
+extern const char       *shaderCacheDirectory;  // Linked programs kept between runs, NULL for none
+
+const char *MakeShaderCacheDirectory(void);
+void SetupRC(void);
+void ShutdownRC(void);
+void SetupViewport(int nWidth, int nHeight);
+void RenderScene(void);
+
+#endif
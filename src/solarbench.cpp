@@ -0,0 +1,181 @@
+// solarbench.cpp
+// Renders solar headless along a camera path with fixed simulation steps and
+// reports frame time statistics as JSON. The same arguments draw the same
+// frames every run, so results can be compared between builds.
+//
+// Usage: solar_bench [--camera-path file] [--frames N] [--warmup N] [--size WxH]
+//                    [--output results.json] [--max-p99 ms] [--no-cull] [--no-impostors] [--no-shadows]
+//                    [--per-vertex] [--ray-cast] [--gpu-driven] [--orbits] [--no-shader-cache]
+//
+// Without --camera-path the built-in loop around the Sun is flown. With
+// --max-p99 the exit status is 2 when the 99th percentile frame time is over
+// the limit. setup_ms is the time to set up the context; linked shaders come
+// from the same cache as solar's, so a first run is slower than the rest
+// unless --no-shader-cache compiles everything every time.
+
+#include "solar.h"
+
+#include <GLProfiler.h>
+#include <GLProgramCache.h>
+#include <StopWatch.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Nearest-rank percentile of sorted times
+static double Percentile(const std::vector<double> &times, double dPercent)
+{
+    size_t iRank = size_t(dPercent / 100.0 * times.size() + 0.999999);
+    if(iRank < 1)
+        iRank = 1;
+    if(iRank > times.size())
+        iRank = times.size();
+    return times[iRank - 1];
+}
+
+static void WriteReport(FILE *pFile, int nWidth, int nHeight, const std::vector<double> &times, double dSeconds,
+                        double dSetupSeconds)
+{
+    double dTotal = 0.0;
+    for(size_t i = 0; i < times.size(); i++)
+        dTotal += times[i];
+
+    fprintf(pFile, "{\n");
+    fprintf(pFile, "  \"renderer\": \"%s\",\n", (const char *)glGetString(GL_RENDERER));
+    fprintf(pFile, "  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %d,\n", nWidth, nHeight, int(times.size()));
+    fprintf(pFile, "  \"frame_ms\": { \"min\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f },\n",
+            times.front(), Percentile(times, 50.0), Percentile(times, 99.0), times.back(), dTotal / times.size());
+    fprintf(pFile, "  \"fps\": %.2f,\n", times.size() / dSeconds);
+    fprintf(pFile, "  \"setup_ms\": %.2f,\n  \"shader_cache\": { \"enabled\": %s, \"loaded\": %u, \"rejected\": %u, \"stored\": %u },\n",
+            dSetupSeconds * 1000.0, gltProgramCacheIsEnabled() ? "true" : "false", gltProgramCacheStats.nLoaded,
+            gltProgramCacheStats.nRejected, gltProgramCacheStats.nStored);
+
+    int nCollected = gpuTimer.GetCollectedFrames();
+    if(nCollected > 0) {
+        fprintf(pFile, "  \"gpu_ms\": { \"frame\": %.4f", gpuTimer.GetFrameTotal() / nCollected);
+        for(int i = 0; i < GPU_PASS_LAST; i++)
+            if(gpuTimer.GetPassFrames(GPU_PASS(i)) > 0)
+                fprintf(pFile, ", \"%s\": %.4f", GpuTimer::GetPassName(GPU_PASS(i)), gpuTimer.GetPassTotal(GPU_PASS(i)) / nCollected);
+        fprintf(pFile, " },\n");
+    }
+
+    fprintf(pFile, "  \"culling\": %s,\n  \"visible\": %d,\n", cullingEnabled ? "true" : "false", cullVisibleCount);
+    fprintf(pFile, "  \"impostors\": %s,\n  \"shadows\": %s,\n  \"per_pixel\": %s,\n  \"ray_cast\": %s,\n  \"gpu_driven\": %s,\n",
+            impostorsEnabled ? "true" : "false", shadowsEnabled ? "true" : "false", perPixelLighting ? "true" : "false",
+            rayCastingEnabled ? "true" : "false", gpuDriven ? "true" : "false");
+    fprintf(pFile, "  \"draws\": %u,\n  \"triangles\": %u,\n  \"state_changes\": %u\n",
+            gltDrawStats.nDrawCalls, gltDrawStats.nTriangles, gltDrawStats.nStateChanges);
+    fprintf(pFile, "}\n");
+}
+
+int main(int argc, char* argv[])
+{
+    gltSetWorkingDirectory(argv[0]);
+
+    const char *szCameraPath = NULL;
+    const char *szOutput = NULL;
+    int nFrames = 600;
+    int nWarmup = 30;
+    int nWidth = 800, nHeight = 600;
+    double dMaxP99 = 0.0;
+    bool bShaderCache = true;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--camera-path") == 0 && i + 1 < argc)
+            szCameraPath = argv[++i];
+        else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc && (nFrames = atoi(argv[i + 1])) > 0)
+            i++;
+        else if(strcmp(argv[i], "--warmup") == 0 && i + 1 < argc && (nWarmup = atoi(argv[i + 1])) >= 0)
+            i++;
+        else if(strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &nWidth, &nHeight) == 2 && nWidth > 0 && nHeight > 0)
+            i++;
+        else if(strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            szOutput = argv[++i];
+        else if(strcmp(argv[i], "--max-p99") == 0 && i + 1 < argc && (dMaxP99 = atof(argv[i + 1])) > 0.0)
+            i++;
+        else if(strcmp(argv[i], "--no-cull") == 0)
+            cullingEnabled = false;
+        else if(strcmp(argv[i], "--no-impostors") == 0)
+            impostorsEnabled = false;
+        else if(strcmp(argv[i], "--no-shadows") == 0)
+            shadowsEnabled = false;
+        else if(strcmp(argv[i], "--per-vertex") == 0)
+            perPixelLighting = false;
+        else if(strcmp(argv[i], "--ray-cast") == 0)
+            rayCastingEnabled = true;
+        else if(strcmp(argv[i], "--gpu-driven") == 0)
+            gpuDriven = true;
+        else if(strcmp(argv[i], "--orbits") == 0)
+            orbitsVisible = true;
+        else if(strcmp(argv[i], "--no-shader-cache") == 0)
+            bShaderCache = false;
+        else {
+            fprintf(stderr, "Usage: %s [--camera-path file] [--frames N] [--warmup N] [--size WxH] [--output results.json] [--max-p99 ms] [--no-cull] [--no-impostors] [--no-shadows] [--per-vertex] [--ray-cast] [--gpu-driven] [--orbits] [--no-shader-cache]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    CameraPath path;
+    if(szCameraPath == NULL)
+        path.MakeDefault();
+    else if(!path.Load(szCameraPath)) {
+        fprintf(stderr, "Cannot read a camera path from %s\n", szCameraPath);
+        return 1;
+    }
+
+    headlessMode = true;
+    if(!headlessContext.Create(nWidth, nHeight))
+        return 1;
+
+    if(bShaderCache)
+        shaderCacheDirectory = MakeShaderCacheDirectory();
+    CStopWatch setupTimer;
+    SetupRC();
+    double dSetupSeconds = setupTimer.GetElapsedSeconds();
+    SetupViewport(nWidth, nHeight);
+    cameraPath = &path;
+
+    // Shaders compile and textures upload lazily in some drivers
+    for(int i = 0; i < nWarmup; i++)
+        RenderScene();
+    glFinish();
+    gpuTimer.CollectAll();
+    gpuTimer.ResetTotals();
+
+    // Each frame is timed through glFinish, so it is the whole cost of that
+    // frame and not however much the driver chose to queue
+    std::vector<double> times(nFrames);
+    CStopWatch runTimer;
+    for(int i = 0; i < nFrames; i++) {
+        CStopWatch frameTimer;
+        RenderScene();
+        glFinish();
+        times[i] = frameTimer.GetElapsedSeconds() * 1000.0;
+    }
+    double dSeconds = runTimer.GetElapsedSeconds();
+    gpuTimer.CollectAll();
+
+    std::sort(times.begin(), times.end());
+
+    FILE *pFile = stdout;
+    if(szOutput != NULL && (pFile = fopen(szOutput, "w")) == NULL) {
+        fprintf(stderr, "Cannot write %s\n", szOutput);
+        pFile = stdout;
+    }
+    WriteReport(pFile, nWidth, nHeight, times, dSeconds, dSetupSeconds);
+    if(pFile != stdout)
+        fclose(pFile);
+
+    double dP99 = Percentile(times, 99.0);
+
+    ShutdownRC();
+    headlessContext.Destroy();
+
+    if(dMaxP99 > 0.0 && dP99 > dMaxP99) {
+        fprintf(stderr, "p99 frame time %.3f ms is over the %.3f ms limit\n", dP99, dMaxP99);
+        return 2;
+    }
+    return 0;
+}